@@ -0,0 +1,171 @@
+// Compare FileTarget with MMapTarget on a regular file: single checked
+// accesses through ITarget, where FileTarget makes a pread() or pwrite() per
+// access, and range reads and writes of the whole file, which FileTarget does
+// one by one or batched with io_uring. Uses a file in /dev/shm by default, so
+// that the numbers are for the access path, not for a device.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "filetarget.h"
+#include "mmaptarget.h"
+
+using namespace std;
+
+static const uint64_t file_len = 1024 * 1024;
+
+static double ns_per_access(chrono::steady_clock::time_point start, uint64_t accesses)
+{
+	auto end = chrono::steady_clock::now();
+	return chrono::duration<double, nano>(end - start).count() / accesses;
+}
+
+static double checked_reads(ITarget& target, uint8_t nbytes, unsigned iters)
+{
+	const uint64_t count = file_len / nbytes;
+	uint64_t sum = 0;
+
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		for (uint64_t addr = 0; addr + nbytes <= file_len; addr += nbytes)
+			sum += target.read(addr, nbytes, Endianness::Little);
+	}
+
+	double ns = ns_per_access(start, count * iters);
+
+	// Keep the reads from being optimized away
+	if (sum == 1)
+		abort();
+
+	return ns;
+}
+
+static double checked_writes(ITarget& target, uint8_t nbytes, unsigned iters)
+{
+	const uint64_t count = file_len / nbytes;
+
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		for (uint64_t addr = 0; addr + nbytes <= file_len; addr += nbytes)
+			target.write(addr, addr, nbytes, Endianness::Little);
+	}
+
+	return ns_per_access(start, count * iters);
+}
+
+static void measure(const string& filename, uint8_t nbytes, unsigned iters)
+{
+	MMapTarget mmap(filename);
+	mmap.map(0, file_len, Endianness::Default, 4, Endianness::Little, nbytes, MapMode::ReadWrite);
+
+	FileTarget file(filename, false);
+	file.map(0, file_len, Endianness::Default, 4, Endianness::Little, nbytes, MapMode::ReadWrite);
+
+	printf("  %u bytes  read %7.2f / %7.2f ns  write %7.2f / %7.2f ns\n", nbytes,
+	       checked_reads(mmap, nbytes, iters), checked_reads(file, nbytes, iters),
+	       checked_writes(mmap, nbytes, iters), checked_writes(file, nbytes, iters));
+}
+
+// Range reads and writes of the whole file, as load and save do them
+static void measure_ranges(const string& filename, uint8_t nbytes, unsigned iters)
+{
+	vector<uint8_t> buf(file_len);
+	const uint64_t count = file_len / nbytes;
+
+	MMapTarget mmap(filename);
+	mmap.map(0, file_len, Endianness::Default, 4, Endianness::Little, nbytes, MapMode::ReadWrite);
+
+	MMapAccessor acc = mmap.accessor();
+
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		mmap.validate_range(0, file_len);
+
+		for (uint64_t off = 0; off < file_len; off += nbytes) {
+			uint64_t v = mmap.read_unchecked(acc, off);
+			memcpy(&buf[off], &v, nbytes);
+		}
+	}
+
+	printf("  %u bytes  mmap     read %7.2f ns", nbytes, ns_per_access(start, count * iters));
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		mmap.validate_range(0, file_len, true);
+
+		for (uint64_t off = 0; off < file_len; off += nbytes) {
+			uint64_t v = 0;
+			memcpy(&v, &buf[off], nbytes);
+			mmap.write_unchecked(acc, off, v);
+		}
+	}
+
+	printf("  write %7.2f ns\n", ns_per_access(start, count * iters));
+
+	for (bool use_io_uring : { false, true }) {
+		FileTarget file(filename, use_io_uring);
+		file.map(0, file_len, Endianness::Default, 4, Endianness::Little, nbytes, MapMode::ReadWrite);
+
+		if (use_io_uring && !file.batched()) {
+			printf("  %u bytes  io_uring not available\n", nbytes);
+			continue;
+		}
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned i = 0; i < iters; ++i)
+			file.read_range(0, buf.data(), file_len);
+
+		double read_ns = ns_per_access(start, count * iters);
+		uint64_t syscalls = file.range_syscalls();
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned i = 0; i < iters; ++i)
+			file.write_range(0, buf.data(), file_len);
+
+		double write_ns = ns_per_access(start, count * iters);
+
+		printf("  %u bytes  %-8s read %7.2f ns  write %7.2f ns  %6.3f syscalls per access\n", nbytes,
+		       use_io_uring ? "io_uring" : "pread", read_ns, write_ns, (double)syscalls / (count * iters));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const string filename = argc > 1 ? argv[1] : "/dev/shm/rwmem-bench-file";
+	const unsigned iters = argc > 2 ? strtoul(argv[2], nullptr, 0) : 3;
+
+	int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0600);
+	if (fd < 0 || ftruncate(fd, file_len) != 0) {
+		perror(filename.c_str());
+		return 1;
+	}
+	close(fd);
+
+	printf("%s, %llu KiB, ns per checked access, mmap / pread and pwrite:\n", filename.c_str(),
+	       (unsigned long long)file_len / 1024);
+
+	for (uint8_t nbytes : { 1, 4, 8 })
+		measure(filename, nbytes, iters);
+
+	printf("range accesses, ns per access:\n");
+
+	for (uint8_t nbytes : { 1, 4, 8 })
+		measure_ranges(filename, nbytes, iters);
+
+	if (argc < 2)
+		unlink(filename.c_str());
+
+	return 0;
+}
@@ -0,0 +1,242 @@
+// Measure MMapTarget access costs per data width: checked accesses through
+// ITarget, like the rwmem tool does, and unchecked accesses with an accessor
+// resolved once, like the array accesses do. Then measure the read bandwidth
+// with each mapping type, the range write throughput of RwmemSession with
+// per-access reporting versus in bulk, and the cost of moving the window of a
+// windowed mapping. Uses a file in /dev/shm by default, so that the
+// numbers are for the access path, not for a device. For page cache backed
+// files the mapping types differ only by the cache flushes of the cached one.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mmaptarget.h"
+#include "session.h"
+
+using namespace std;
+
+static const uint64_t map_len = 1024 * 1024;
+
+static double ns_per_access(chrono::steady_clock::time_point start, uint64_t accesses)
+{
+	auto end = chrono::steady_clock::now();
+	return chrono::duration<double, nano>(end - start).count() / accesses;
+}
+
+static void measure(MMapTarget& target, uint8_t nbytes, Endianness endianness, unsigned iters)
+{
+	ITarget& itarget = target;
+	const uint64_t count = map_len / nbytes;
+	uint64_t sum = 0;
+
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		for (uint64_t addr = 0; addr + nbytes <= map_len; addr += nbytes)
+			sum += itarget.read(addr, nbytes, endianness);
+	}
+
+	double checked_read = ns_per_access(start, count * iters);
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		MMapAccessor acc = target.accessor(nbytes, endianness);
+		target.validate_range(0, count * nbytes);
+
+		for (uint64_t addr = 0; addr + nbytes <= map_len; addr += nbytes)
+			sum += target.read_unchecked(acc, addr);
+	}
+
+	double unchecked_read = ns_per_access(start, count * iters);
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		for (uint64_t addr = 0; addr + nbytes <= map_len; addr += nbytes)
+			itarget.write(addr, addr, nbytes, endianness);
+	}
+
+	double checked_write = ns_per_access(start, count * iters);
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		MMapAccessor acc = target.accessor(nbytes, endianness);
+		target.validate_range(0, count * nbytes, true);
+
+		for (uint64_t addr = 0; addr + nbytes <= map_len; addr += nbytes)
+			target.write_unchecked(acc, addr, addr);
+	}
+
+	double unchecked_write = ns_per_access(start, count * iters);
+
+	// Keep the reads from being optimized away
+	if (sum == 1)
+		abort();
+
+	printf("  %u bytes %-6s  read %6.2f / %6.2f ns  write %6.2f / %6.2f ns\n", nbytes,
+	       endianness == Endianness::Big ? "big" : "little",
+	       checked_read, unchecked_read, checked_write, unchecked_write);
+}
+
+// Read bandwidth of the whole file with 8 byte unchecked reads, like a dump
+static void measure_bandwidth(const string& filename, MapType type, const char* name, unsigned iters)
+{
+	MMapTarget target(filename, type);
+	target.map(0, map_len, Endianness::Default, 4, Endianness::Little, 8, MapMode::Read);
+
+	MMapAccessor acc = target.accessor();
+	uint64_t sum = 0;
+
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		target.validate_range(0, map_len);
+		target.flush_cache(0, map_len);
+
+		for (uint64_t addr = 0; addr < map_len; addr += 8)
+			sum += target.read_unchecked(acc, addr);
+	}
+
+	auto end = chrono::steady_clock::now();
+
+	if (sum == 1)
+		abort();
+
+	double secs = chrono::duration<double>(end - start).count();
+
+	printf("  %-7s %8.1f MiB/s\n", name, (double)map_len * iters / secs / (1024 * 1024));
+}
+
+// Range writes of the whole file as the rwmem tool does them, with each
+// access reported, and in bulk, as with -p q
+static void measure_range_writes(const string& filename, MapType type, const char* name, unsigned iters)
+{
+	class Observer : public RwmemObserver
+	{
+	public:
+		explicit Observer(bool report) : m_report(report) {}
+
+		bool wants_accesses() const override { return m_report; }
+
+	private:
+		bool m_report;
+	};
+
+	RwmemSessionOptions opts;
+	opts.mmap_target = filename;
+	opts.user_map_type = true;
+	opts.map_type = type;
+
+	for (const char* op_str : { "0x0+0x100000=0xff0000", "0x0+0x100000:7:0=0x55" }) {
+		double mibs[2];
+
+		for (bool report : { true, false }) {
+			RwmemSession session(opts);
+			RwmemOp op = session.parse_op(op_str);
+			Observer observer(report);
+
+			auto start = chrono::steady_clock::now();
+
+			for (unsigned i = 0; i < iters; ++i)
+				session.execute(op, observer);
+
+			double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			mibs[report ? 0 : 1] = (double)map_len * iters / secs / (1024 * 1024);
+		}
+
+		printf("  %-7s %-24s %8.1f / %8.1f MiB/s\n", name, op_str, mibs[0], mibs[1]);
+	}
+}
+
+// Sequential checked reads of the whole file with windows of different
+// sizes, like a dump of a large range on a 32-bit system. The cost of a move
+// is the time over that of the whole mapping, per move.
+static void measure_windows(const string& filename, unsigned iters)
+{
+	double whole_secs = 0;
+
+	for (uint64_t window : { (uint64_t)0, map_len / 4, map_len / 16, map_len / 64 }) {
+		MMapTarget target(filename);
+		target.set_window_size(window);
+
+		uint64_t sum = 0;
+		uint64_t moves = 0;
+
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned i = 0; i < iters; ++i) {
+			target.map(0, map_len, Endianness::Default, 4, Endianness::Little, 8, MapMode::Read);
+
+			for (uint64_t addr = 0; addr < map_len; addr += 8)
+				sum += target.read(addr, 8, Endianness::Little);
+
+			moves += target.window_moves();
+		}
+
+		double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		if (sum == 1)
+			abort();
+
+		if (!window) {
+			whole_secs = secs;
+			printf("  whole    %8.1f MiB/s\n", (double)map_len * iters / secs / (1024 * 1024));
+			continue;
+		}
+
+		printf("  %4llu KiB %8.1f MiB/s  %6.2f us per move\n", (unsigned long long)window / 1024,
+		       (double)map_len * iters / secs / (1024 * 1024), (secs - whole_secs) * 1e6 / moves);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const string filename = argc > 1 ? argv[1] : "/dev/shm/rwmem-bench-mmap";
+	const unsigned iters = argc > 2 ? strtoul(argv[2], nullptr, 0) : 10;
+
+	int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0600);
+	if (fd < 0 || ftruncate(fd, map_len) != 0) {
+		perror(filename.c_str());
+		return 1;
+	}
+	close(fd);
+
+	MMapTarget target(filename);
+	target.map(0, map_len, Endianness::Default, 4, Endianness::Little, 4, MapMode::ReadWrite);
+
+	printf("%s, %llu KiB, ns per access, checked / unchecked:\n", filename.c_str(),
+	       (unsigned long long)map_len / 1024);
+
+	for (uint8_t nbytes = 1; nbytes <= 8; ++nbytes) {
+		for (Endianness e : { Endianness::Little, Endianness::Big })
+			measure(target, nbytes, e, iters);
+	}
+
+	printf("read bandwidth per mapping type:\n");
+
+	measure_bandwidth(filename, MapType::Uncached, "uc", iters * 10);
+	measure_bandwidth(filename, MapType::WriteCombine, "wc", iters * 10);
+	measure_bandwidth(filename, MapType::Cached, "cached", iters * 10);
+
+	printf("range writes, reported / bulk:\n");
+
+	measure_range_writes(filename, MapType::Uncached, "uc", iters);
+	measure_range_writes(filename, MapType::WriteCombine, "wc", iters);
+	measure_range_writes(filename, MapType::Cached, "cached", iters);
+
+	printf("windowed mapping, checked 8 byte reads:\n");
+
+	measure_windows(filename, iters);
+
+	if (argc < 2)
+		unlink(filename.c_str());
+
+	return 0;
+}
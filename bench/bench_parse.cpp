@@ -0,0 +1,101 @@
+// Measure the op parsing throughput of RwmemSession, for batch use with
+// thousands of ops: numeric ops, and symbolic ops for every register of
+// the register file, with and without fields and wildcards
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "session.h"
+
+using namespace std;
+
+static vector<string> numeric_ops(size_t count)
+{
+	vector<string> ops;
+
+	for (size_t i = 0; i < count; ++i)
+		ops.push_back(std::format("{:#x}+0x10:7:4=0x{:x}", i * 4, i & 0xf));
+
+	return ops;
+}
+
+static vector<string> symbolic_ops(const RegisterFileSet& regfiles, bool fields, bool wildcards)
+{
+	vector<string> ops;
+
+	for (const RegisterBlockRef& rb : regfiles.blocks()) {
+		string block = rb.rbd->name(rb.rfd);
+
+		if (wildcards) {
+			ops.push_back(block + ".*");
+			continue;
+		}
+
+		for (uint32_t ridx = 0; ridx < rb.rbd->num_regs(); ++ridx) {
+			const RegisterData* rd = rb.rbd->register_at(rb.rfd, ridx);
+			string op = block + "." + rd->name(rb.rfd);
+
+			if (fields && rd->num_fields())
+				op += string(":") + rd->field_at(rb.rfd, 0)->name(rb.rfd);
+
+			ops.push_back(op);
+		}
+	}
+
+	return ops;
+}
+
+static void measure(RwmemSession& session, const char* name, const vector<string>& ops, unsigned iters)
+{
+	if (ops.empty())
+		return;
+
+	size_t sum = 0;
+
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		for (const string& str : ops) {
+			RwmemOp op = session.parse_op(str);
+			sum += op.rds.size() + op.low;
+		}
+
+		session.clear_ops();
+	}
+
+	auto end = chrono::steady_clock::now();
+
+	// Keep the parsing from being optimized away
+	if (sum == ~0ULL)
+		abort();
+
+	double ns = chrono::duration<double, nano>(end - start).count() / ((double)iters * ops.size());
+
+	printf("  %-12s %6zu ops  %8.1f ns/op  %8.2f Mops/s\n", name, ops.size(), ns, 1000.0 / ns);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <regdb> [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	const unsigned iters = argc > 2 ? strtoul(argv[2], nullptr, 0) : 100;
+
+	RwmemSession session(RwmemSessionOptions{});
+	session.load_regfile(argv[1]);
+
+	printf("parse_op:\n");
+
+	measure(session, "numeric", numeric_ops(10000), iters);
+	measure(session, "register", symbolic_ops(session.regfiles(), false, false), iters);
+	measure(session, "field", symbolic_ops(session.regfiles(), true, false), iters);
+	measure(session, "wildcard", symbolic_ops(session.regfiles(), false, true), iters);
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+// Measure the cost of loading a register file: validation, and the page
+// faults taken with each RegisterFileAccess mode for a full scan (like
+// 'rwmem list') and for a single lookup (like a register op)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "regs.h"
+
+using namespace std;
+
+static double load_us(const string& filename, bool validate, unsigned iters)
+{
+	auto start = chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < iters; ++i) {
+		RegisterFile rf(filename, validate);
+		// Touch the header so that the mapping is used
+		if (rf.num_blocks() == 0xffffffff)
+			abort();
+	}
+
+	auto end = chrono::steady_clock::now();
+
+	return chrono::duration<double, micro>(end - start).count() / iters;
+}
+
+// Drop the file from the page cache, so that the next load has to read it
+static void evict(const string& filename)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+static size_t scan(const RegisterFile& rf)
+{
+	const RegisterFileData* rfd = rf.data();
+	size_t len = 0;
+
+	for (uint32_t bidx = 0; bidx < rfd->num_blocks(); ++bidx) {
+		const RegisterBlockData* rbd = rfd->block_at(bidx);
+		len += strlen(rbd->name(rfd));
+
+		for (uint32_t ridx = 0; ridx < rbd->num_regs(); ++ridx) {
+			const RegisterData* rd = rbd->register_at(rfd, ridx);
+			len += strlen(rd->name(rfd));
+
+			for (uint32_t fidx = 0; fidx < rd->num_fields(); ++fidx)
+				len += strlen(rd->field_at(rfd, fidx)->name(rfd));
+		}
+	}
+
+	return len;
+}
+
+static size_t lookup(const RegisterFile& rf)
+{
+	// The last register of the last block, the worst case for the linear searches
+	const RegisterFileData* rfd = rf.data();
+	const RegisterBlockData* rbd = rfd->block_at(rfd->num_blocks() - 1);
+	const RegisterData* rd = rbd->register_at(rfd, rbd->num_regs() - 1);
+
+	auto rb = rf.find_register_block(rbd->name(rfd));
+	if (!rb)
+		abort();
+
+	auto reg = rb->get_register(rd->name(rfd));
+	if (!reg)
+		abort();
+
+	return reg->num_fields();
+}
+
+static void measure(const string& filename, const char* mode_name, RegisterFileAccess access,
+		    bool validate, bool cold, bool full_scan)
+{
+	if (cold)
+		evict(filename);
+
+	struct rusage ru_start, ru_end;
+
+	getrusage(RUSAGE_SELF, &ru_start);
+	auto start = chrono::steady_clock::now();
+
+	size_t res;
+	{
+		RegisterFile rf(filename, validate, access);
+		res = full_scan ? scan(rf) : lookup(rf);
+	}
+
+	auto end = chrono::steady_clock::now();
+	getrusage(RUSAGE_SELF, &ru_end);
+
+	if (res == 0)
+		abort();
+
+	printf("  %-10s %-6s %-6s %-8s %10.1f us  minflt %7ld  majflt %5ld\n",
+	       mode_name, full_scan ? "scan" : "lookup", cold ? "cold" : "warm",
+	       validate ? "validate" : "",
+	       chrono::duration<double, micro>(end - start).count(),
+	       ru_end.ru_minflt - ru_start.ru_minflt,
+	       ru_end.ru_majflt - ru_start.ru_majflt);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <regdb> [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	const string filename = argv[1];
+	const unsigned iters = argc > 2 ? strtoul(argv[2], nullptr, 0) : 100;
+
+	RegisterFile rf(filename);
+	printf("%s: %u blocks, %u regs, %u fields\n", rf.name(), rf.num_blocks(), rf.num_regs(), rf.num_fields());
+
+	// Warm up the page cache
+	load_us(filename, true, 1);
+
+	printf("load, no validation: %10.1f us\n", load_us(filename, false, iters));
+	printf("load, validation:    %10.1f us\n", load_us(filename, true, iters));
+
+	static const struct {
+		const char* name;
+		RegisterFileAccess access;
+	} modes[] = {
+		{ "default", RegisterFileAccess::Default },
+		{ "random", RegisterFileAccess::Random },
+		{ "sequential", RegisterFileAccess::Sequential },
+		{ "populate", RegisterFileAccess::Populate },
+		{ "hugepage", RegisterFileAccess::Hugepage },
+	};
+
+	printf("page faults per access mode:\n");
+
+	for (bool full_scan : { true, false }) {
+		for (bool validate : { true, false }) {
+			for (bool cold : { true, false }) {
+				for (const auto& m : modes)
+					measure(filename, m.name, m.access, validate, cold, full_scan);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,466 @@
+#include <exception>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "i2ctarget.h"
+#include "librwmem.h"
+#include "mmaptarget.h"
+#include "regfileset.h"
+
+using namespace std;
+
+// The opaque handles are the C++ objects, or the register file data
+
+struct rwmem_regfile {
+	RegisterFileSet set;
+};
+
+struct rwmem_target {
+	unique_ptr<ITarget> target;
+	// Set for mmap targets, which have unchecked array accesses
+	MMapTarget* mmap = nullptr;
+	uint8_t data_size;
+	// The mmap target is remapped when its window size changes
+	uint64_t offset;
+	uint64_t length;
+	Endianness data_endianness;
+	MapMode mode;
+};
+
+static const RegisterBlockData* to_rbd(const rwmem_block* block)
+{
+	return reinterpret_cast<const RegisterBlockData*>(block);
+}
+
+static const rwmem_block* from_rbd(const RegisterBlockData* rbd)
+{
+	return reinterpret_cast<const rwmem_block*>(rbd);
+}
+
+static const RegisterData* to_rd(const rwmem_register* reg)
+{
+	return reinterpret_cast<const RegisterData*>(reg);
+}
+
+static const rwmem_register* from_rd(const RegisterData* rd)
+{
+	return reinterpret_cast<const rwmem_register*>(rd);
+}
+
+static const FieldData* to_fd(const rwmem_field* field)
+{
+	return reinterpret_cast<const FieldData*>(field);
+}
+
+static const rwmem_field* from_fd(const FieldData* fd)
+{
+	return reinterpret_cast<const rwmem_field*>(fd);
+}
+
+static thread_local string s_last_error;
+
+static void set_error(string msg)
+{
+	s_last_error = std::move(msg);
+}
+
+// Run f, converting exceptions to the last error. Returns f's result, or
+// 'fail' if it threw.
+template<typename T, typename F>
+static T guard(T fail, F&& f)
+{
+	try {
+		return f();
+	} catch (const exception& e) {
+		set_error(e.what());
+	} catch (...) {
+		set_error("Unknown error");
+	}
+
+	return fail;
+}
+
+static const RegisterFileData* rfd_of(const rwmem_regfile* rf)
+{
+	return rf->set.file(0).data();
+}
+
+static const char* description(const RegisterFileData* rfd, uint32_t offset)
+{
+	return offset ? rfd->strings() + offset : nullptr;
+}
+
+uint32_t rwmem_api_version(void)
+{
+	return RWMEM_API_VERSION;
+}
+
+const char* rwmem_last_error(void)
+{
+	return s_last_error.c_str();
+}
+
+rwmem_regfile* rwmem_regfile_open(const char* filename)
+{
+	return guard<rwmem_regfile*>(nullptr, [&] {
+		auto rf = make_unique<rwmem_regfile>();
+		rf->set.load(filename);
+		return rf.release();
+	});
+}
+
+void rwmem_regfile_close(rwmem_regfile* rf)
+{
+	delete rf;
+}
+
+const char* rwmem_regfile_name(const rwmem_regfile* rf)
+{
+	return rfd_of(rf)->name();
+}
+
+uint32_t rwmem_regfile_num_blocks(const rwmem_regfile* rf)
+{
+	return rfd_of(rf)->num_blocks();
+}
+
+const rwmem_block* rwmem_regfile_block_at(const rwmem_regfile* rf, uint32_t idx)
+{
+	const RegisterFileData* rfd = rfd_of(rf);
+
+	if (idx >= rfd->num_blocks()) {
+		set_error(std::format("Block index {} out of range", idx));
+		return nullptr;
+	}
+
+	return from_rbd(rfd->block_at(idx));
+}
+
+const rwmem_block* rwmem_regfile_find_block(const rwmem_regfile* rf, const char* name)
+{
+	return guard<const rwmem_block*>(nullptr, [&]() -> const rwmem_block* {
+		const RegisterBlockRef* rb = rf->set.find_block(name);
+
+		if (!rb) {
+			set_error(std::format("Register block '{}' not found", name));
+			return nullptr;
+		}
+
+		return from_rbd(rb->rbd);
+	});
+}
+
+const rwmem_register* rwmem_regfile_find_register(const rwmem_regfile* rf, uint64_t address,
+						  const rwmem_block** block)
+{
+	return guard<const rwmem_register*>(nullptr, [&]() -> const rwmem_register* {
+		const RegisterBlockRef* rb;
+		const RegisterData* rd = rf->set.find_register(address, &rb);
+
+		if (!rd) {
+			set_error(std::format("No register at {:#x}", address));
+			return nullptr;
+		}
+
+		if (block)
+			*block = from_rbd(rb->rbd);
+
+		return from_rd(rd);
+	});
+}
+
+int rwmem_block_get_info(const rwmem_regfile* rf, const rwmem_block* block, rwmem_block_info* info)
+{
+	const RegisterFileData* rfd = rfd_of(rf);
+	const RegisterBlockData* rbd = to_rbd(block);
+
+	info->name = rbd->name(rfd);
+	info->description = description(rfd, rbd->description_offset());
+	info->offset = rbd->offset();
+	info->size = rbd->size();
+	info->num_regs = rbd->num_regs();
+	info->addr_endianness = (uint8_t)rbd->addr_endianness();
+	info->addr_size = rbd->addr_size();
+	info->data_endianness = (uint8_t)rbd->data_endianness();
+	info->data_size = rbd->data_size();
+
+	return 0;
+}
+
+const rwmem_register* rwmem_block_register_at(const rwmem_regfile* rf, const rwmem_block* block, uint32_t idx)
+{
+	const RegisterData* rd = to_rbd(block)->register_at(rfd_of(rf), idx);
+
+	if (!rd) {
+		set_error(std::format("Register index {} out of range", idx));
+		return nullptr;
+	}
+
+	return from_rd(rd);
+}
+
+const rwmem_register* rwmem_block_find_register(const rwmem_regfile* rf, const rwmem_block* block,
+						const char* name)
+{
+	return guard<const rwmem_register*>(nullptr, [&]() -> const rwmem_register* {
+		const RegisterData* rd = to_rbd(block)->find_register(rfd_of(rf), name);
+
+		if (!rd) {
+			set_error(std::format("Register '{}' not found", name));
+			return nullptr;
+		}
+
+		return from_rd(rd);
+	});
+}
+
+int rwmem_register_get_info(const rwmem_regfile* rf, const rwmem_block* block, const rwmem_register* reg,
+			    rwmem_register_info* info)
+{
+	const RegisterFileData* rfd = rfd_of(rf);
+	const RegisterBlockData* rbd = to_rbd(block);
+	const RegisterData* rd = to_rd(reg);
+
+	info->name = rd->name(rfd);
+	info->description = description(rfd, rd->description_offset());
+	info->offset = rd->offset();
+	info->reset_value = rd->reset_value();
+	info->num_fields = rd->num_fields();
+	info->data_endianness = (uint8_t)rd->effective_data_endianness(rbd);
+	info->data_size = rd->effective_data_size(rbd);
+
+	return 0;
+}
+
+const rwmem_field* rwmem_register_field_at(const rwmem_regfile* rf, const rwmem_register* reg, uint32_t idx)
+{
+	const FieldData* fd = to_rd(reg)->field_at(rfd_of(rf), idx);
+
+	if (!fd) {
+		set_error(std::format("Field index {} out of range", idx));
+		return nullptr;
+	}
+
+	return from_fd(fd);
+}
+
+const rwmem_field* rwmem_register_find_field(const rwmem_regfile* rf, const rwmem_register* reg,
+					     const char* name)
+{
+	return guard<const rwmem_field*>(nullptr, [&]() -> const rwmem_field* {
+		const FieldData* fd = to_rd(reg)->find_field(rfd_of(rf), name);
+
+		if (!fd) {
+			set_error(std::format("Field '{}' not found", name));
+			return nullptr;
+		}
+
+		return from_fd(fd);
+	});
+}
+
+int rwmem_field_get_info(const rwmem_regfile* rf, const rwmem_field* field, rwmem_field_info* info)
+{
+	const RegisterFileData* rfd = rfd_of(rf);
+	const FieldData* fd = to_fd(field);
+
+	info->name = fd->name(rfd);
+	info->description = description(rfd, fd->description_offset());
+	info->high = fd->high();
+	info->low = fd->low();
+
+	return 0;
+}
+
+static uint64_t field_mask(uint8_t high, uint8_t low)
+{
+	if (high > 63 || low > high)
+		return 0;
+
+	return ((~0ULL) << low) & (~0ULL >> (63 - high));
+}
+
+uint64_t rwmem_field_decode(uint64_t reg_value, uint8_t high, uint8_t low)
+{
+	return (reg_value & field_mask(high, low)) >> (low & 63);
+}
+
+uint64_t rwmem_field_encode(uint64_t reg_value, uint8_t high, uint8_t low, uint64_t field_value)
+{
+	const uint64_t mask = field_mask(high, low);
+
+	return (reg_value & ~mask) | ((field_value << (low & 63)) & mask);
+}
+
+rwmem_target* rwmem_target_open_mmap(const char* filename, uint64_t offset, uint64_t length,
+				     rwmem_endianness data_endianness, uint8_t data_size, rwmem_map_mode mode)
+{
+	return guard<rwmem_target*>(nullptr, [&] {
+		auto t = make_unique<rwmem_target>();
+		auto mmap = make_unique<MMapTarget>(filename);
+		t->mmap = mmap.get();
+		t->target = std::move(mmap);
+		t->target->map(offset, length, Endianness::Default, 0, (Endianness)data_endianness, data_size,
+			       (MapMode)mode);
+		t->data_size = data_size;
+		t->offset = offset;
+		t->length = length;
+		t->data_endianness = (Endianness)data_endianness;
+		t->mode = (MapMode)mode;
+		return t.release();
+	});
+}
+
+int rwmem_target_set_window_size(rwmem_target* target, uint64_t size)
+{
+	return guard(-1, [&] {
+		if (!target->mmap)
+			throw invalid_argument("Only mmap targets have a map window");
+
+		target->mmap->set_window_size(size);
+		target->mmap->map(target->offset, target->length, Endianness::Default, 0, target->data_endianness,
+				  target->data_size, target->mode);
+		return 0;
+	});
+}
+
+rwmem_target* rwmem_target_open_i2c(uint16_t adapter, uint16_t dev_addr, uint64_t offset, uint64_t length,
+				    rwmem_endianness addr_endianness, uint8_t addr_size,
+				    rwmem_endianness data_endianness, uint8_t data_size, rwmem_map_mode mode)
+{
+	return guard<rwmem_target*>(nullptr, [&] {
+		auto t = make_unique<rwmem_target>();
+		t->target = make_unique<I2CTarget>(adapter, dev_addr);
+		t->target->map(offset, length, (Endianness)addr_endianness, addr_size, (Endianness)data_endianness,
+			       data_size, (MapMode)mode);
+		t->data_size = data_size;
+		return t.release();
+	});
+}
+
+void rwmem_target_close(rwmem_target* target)
+{
+	delete target;
+}
+
+int rwmem_target_read(rwmem_target* target, uint64_t addr, uint8_t data_size, rwmem_endianness data_endianness,
+		      uint64_t* value)
+{
+	return guard(-1, [&] {
+		*value = target->target->read(addr, data_size, (Endianness)data_endianness);
+		return 0;
+	});
+}
+
+int rwmem_target_write(rwmem_target* target, uint64_t addr, uint64_t value, uint8_t data_size,
+		       rwmem_endianness data_endianness)
+{
+	return guard(-1, [&] {
+		target->target->write(addr, value, data_size, (Endianness)data_endianness);
+		return 0;
+	});
+}
+
+// The length of the array in bytes must fit in 64 bits
+static void validate_array(size_t count, size_t size)
+{
+	if (count > UINT64_MAX / size)
+		throw invalid_argument("Array too large");
+}
+
+template<typename T>
+static void read_elems(rwmem_target* target, uint64_t addr, void* values, size_t count, Endianness endianness)
+{
+	T* dst = static_cast<T*>(values);
+
+	validate_array(count, sizeof(T));
+
+	if (MMapTarget* mmap = target->mmap) {
+		mmap->read_array(addr, dst, count, endianness);
+		return;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+		dst[i] = (T)target->target->read(addr + i * sizeof(T), sizeof(T), endianness);
+}
+
+template<typename T>
+static void write_elems(rwmem_target* target, uint64_t addr, const void* values, size_t count, Endianness endianness)
+{
+	const T* src = static_cast<const T*>(values);
+
+	validate_array(count, sizeof(T));
+
+	if (MMapTarget* mmap = target->mmap) {
+		mmap->write_array(addr, src, count, endianness);
+		return;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+		target->target->write(addr + i * sizeof(T), src[i], sizeof(T), endianness);
+}
+
+static uint8_t array_data_size(const rwmem_target* target, uint8_t data_size)
+{
+	if (!data_size)
+		data_size = target->data_size;
+
+	if (data_size != 1 && data_size != 2 && data_size != 4 && data_size != 8)
+		throw invalid_argument(std::format("Array data size must be 1, 2, 4 or 8, got {}", data_size));
+
+	return data_size;
+}
+
+int rwmem_target_read_array(rwmem_target* target, uint64_t addr, void* values, size_t count, uint8_t data_size,
+			    rwmem_endianness data_endianness)
+{
+	return guard(-1, [&] {
+		rwmem_target* t = target;
+		Endianness e = (Endianness)data_endianness;
+
+		switch (array_data_size(target, data_size)) {
+		case 1:
+			read_elems<uint8_t>(t, addr, values, count, e);
+			break;
+		case 2:
+			read_elems<uint16_t>(t, addr, values, count, e);
+			break;
+		case 4:
+			read_elems<uint32_t>(t, addr, values, count, e);
+			break;
+		case 8:
+			read_elems<uint64_t>(t, addr, values, count, e);
+			break;
+		}
+
+		return 0;
+	});
+}
+
+int rwmem_target_write_array(rwmem_target* target, uint64_t addr, const void* values, size_t count,
+			     uint8_t data_size, rwmem_endianness data_endianness)
+{
+	return guard(-1, [&] {
+		rwmem_target* t = target;
+		Endianness e = (Endianness)data_endianness;
+
+		switch (array_data_size(target, data_size)) {
+		case 1:
+			write_elems<uint8_t>(t, addr, values, count, e);
+			break;
+		case 2:
+			write_elems<uint16_t>(t, addr, values, count, e);
+			break;
+		case 4:
+			write_elems<uint32_t>(t, addr, values, count, e);
+			break;
+		case 8:
+			write_elems<uint64_t>(t, addr, values, count, e);
+			break;
+		}
+
+		return 0;
+	});
+}
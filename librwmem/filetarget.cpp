@@ -0,0 +1,424 @@
+#include "filetarget.h"
+#include "mmaptarget.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+// IORING_OP_READ and IORING_OP_WRITE came with the opcode probe in 5.6
+#if defined(IO_URING_OP_SUPPORTED) && defined(__NR_io_uring_setup)
+#define HAS_IO_URING 1
+#endif
+
+using namespace std;
+
+// Accesses submitted with one io_uring_enter()
+static const unsigned ring_entries = 64;
+
+[[noreturn]] static void throw_access_error(bool write, uint64_t addr, int err)
+{
+	if (!err)
+		throw runtime_error(std::format("Short {} at {:#x}", write ? "write" : "read", addr));
+
+	throw runtime_error(std::format("Failed to {} at {:#x}: {}", write ? "write" : "read", addr, strerror(err)));
+}
+
+static void file_access(int fd, bool write, uint64_t addr, uint8_t* buf, uint8_t nbytes)
+{
+	ssize_t r;
+
+	do {
+		r = write ? pwrite(fd, buf, nbytes, addr) : pread(fd, buf, nbytes, addr);
+	} while (r == -1 && errno == EINTR);
+
+	if (r != nbytes)
+		throw_access_error(write, addr, r == -1 ? errno : 0);
+}
+
+#if HAS_IO_URING
+
+/*
+ * io_uring with the raw system calls, for reads and writes of one element
+ * size at consecutive offsets. Each batch is submitted and waited for with
+ * one io_uring_enter(), as one chain of linked requests.
+ */
+class FileTarget::Ring
+{
+public:
+	// nullptr if io_uring is not available, e.g. disabled with the
+	// kernel.io_uring_disabled sysctl or by seccomp
+	static unique_ptr<Ring> create()
+	{
+		io_uring_params p{};
+
+		int fd = (int)syscall(__NR_io_uring_setup, ring_entries, &p);
+		if (fd < 0)
+			return nullptr;
+
+		unique_ptr<Ring> ring(new Ring(fd));
+
+		if (!ring->setup(p))
+			return nullptr;
+
+		return ring;
+	}
+
+	~Ring()
+	{
+		if (m_sqes != MAP_FAILED)
+			munmap(m_sqes, m_sqes_len);
+		if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+			munmap(m_cq_ptr, m_cq_len);
+		if (m_sq_ptr != MAP_FAILED)
+			munmap(m_sq_ptr, m_sq_len);
+
+		close(m_fd);
+	}
+
+	unsigned entries() const { return m_entries; }
+
+	// Access count elements, at most entries(). Returns the number of
+	// system calls made.
+	unsigned rw(int fd, bool write, uint64_t addr, uint8_t* buf, unsigned count, uint8_t nbytes)
+	{
+		const unsigned tail = *m_sq_tail;
+
+		for (unsigned i = 0; i < count; ++i) {
+			const unsigned idx = (tail + i) & m_sq_mask;
+			io_uring_sqe* sqe = &m_sqes[idx];
+
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+			sqe->fd = fd;
+			sqe->off = addr + (uint64_t)i * nbytes;
+			sqe->addr = (uintptr_t)(buf + (size_t)i * nbytes);
+			sqe->len = nbytes;
+			sqe->user_data = i;
+			// In order, like pread() one by one
+			if (i + 1 < count)
+				sqe->flags = IOSQE_IO_LINK;
+
+			m_sq_array[idx] = idx;
+		}
+
+		__atomic_store_n(m_sq_tail, tail + count, __ATOMIC_RELEASE);
+
+		unsigned submitted = 0;
+		unsigned syscalls = 0;
+
+		while (submitted < count || ready() < count) {
+			int r = (int)syscall(__NR_io_uring_enter, m_fd, count - submitted, count, IORING_ENTER_GETEVENTS,
+					     nullptr, 0);
+			syscalls++;
+
+			if (r < 0) {
+				if (errno == EINTR)
+					continue;
+				throw runtime_error(std::format("io_uring_enter failed: {}", strerror(errno)));
+			}
+
+			submitted += r;
+		}
+
+		// The first failed access, the ones linked after it are canceled
+		unsigned head = *m_cq_head;
+		uint64_t err_idx = count;
+		int err_res = 0;
+
+		for (unsigned i = 0; i < count; ++i, ++head) {
+			const io_uring_cqe* cqe = &m_cqes[head & m_cq_mask];
+
+			if (cqe->res != nbytes && cqe->user_data < err_idx) {
+				err_idx = cqe->user_data;
+				err_res = cqe->res;
+			}
+		}
+
+		__atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+
+		if (err_idx < count)
+			throw_access_error(write, addr + err_idx * nbytes, err_res < 0 ? -err_res : 0);
+
+		return syscalls;
+	}
+
+private:
+	int m_fd;
+	unsigned m_entries = 0;
+
+	void* m_sq_ptr = MAP_FAILED;
+	size_t m_sq_len = 0;
+	void* m_cq_ptr = MAP_FAILED;
+	size_t m_cq_len = 0;
+	io_uring_sqe* m_sqes = (io_uring_sqe*)MAP_FAILED;
+	size_t m_sqes_len = 0;
+
+	unsigned* m_sq_tail = nullptr;
+	unsigned m_sq_mask = 0;
+	unsigned* m_sq_array = nullptr;
+	unsigned* m_cq_head = nullptr;
+	unsigned* m_cq_tail = nullptr;
+	unsigned m_cq_mask = 0;
+	io_uring_cqe* m_cqes = nullptr;
+
+	explicit Ring(int fd) : m_fd(fd) {}
+
+	unsigned ready() const { return __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE) - *m_cq_head; }
+
+	bool setup(const io_uring_params& p)
+	{
+		m_entries = p.sq_entries;
+
+		m_sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		m_cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+		// Both rings in one mapping, since 5.4
+		const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+		if (single_mmap)
+			m_sq_len = m_cq_len = std::max(m_sq_len, m_cq_len);
+
+		m_sq_ptr = mmap(nullptr, m_sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+				IORING_OFF_SQ_RING);
+		if (m_sq_ptr == MAP_FAILED)
+			return false;
+
+		if (single_mmap) {
+			m_cq_ptr = m_sq_ptr;
+		} else {
+			m_cq_ptr = mmap(nullptr, m_cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+					IORING_OFF_CQ_RING);
+			if (m_cq_ptr == MAP_FAILED)
+				return false;
+		}
+
+		m_sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+		m_sqes = (io_uring_sqe*)mmap(nullptr, m_sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+					     m_fd, IORING_OFF_SQES);
+		if (m_sqes == MAP_FAILED)
+			return false;
+
+		uint8_t* sq = (uint8_t*)m_sq_ptr;
+		uint8_t* cq = (uint8_t*)m_cq_ptr;
+
+		m_sq_tail = (unsigned*)(sq + p.sq_off.tail);
+		m_sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+		m_sq_array = (unsigned*)(sq + p.sq_off.array);
+		m_cq_head = (unsigned*)(cq + p.cq_off.head);
+		m_cq_tail = (unsigned*)(cq + p.cq_off.tail);
+		m_cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+		m_cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+		return supports(IORING_OP_READ) && supports(IORING_OP_WRITE);
+	}
+
+	bool supports(unsigned op) const
+	{
+		const unsigned num_ops = 256;
+		vector<uint8_t> buf(sizeof(io_uring_probe) + num_ops * sizeof(io_uring_probe_op));
+		io_uring_probe* probe = (io_uring_probe*)buf.data();
+
+		if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, num_ops) < 0)
+			return false;
+
+		return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+	}
+};
+
+#else
+
+class FileTarget::Ring
+{
+public:
+	static unique_ptr<Ring> create() { return nullptr; }
+
+	unsigned entries() const { return 0; }
+	unsigned rw(int, bool, uint64_t, uint8_t*, unsigned, uint8_t) { return 0; }
+};
+
+#endif
+
+FileTarget::FileTarget(const string& filename, bool use_io_uring)
+	: m_filename(filename), m_use_io_uring(use_io_uring), m_fd(-1),
+	  m_default_data_size(0), m_default_data_endianness(Endianness::Default), m_mode(MapMode::Read),
+	  m_offset(0), m_len(0), m_range_syscalls(0)
+{
+}
+
+FileTarget::~FileTarget()
+{
+	FileTarget::unmap();
+}
+
+void FileTarget::map(uint64_t offset, uint64_t length,
+		     Endianness default_addr_endianness, uint8_t default_addr_size,
+		     Endianness default_data_endianness, uint8_t default_data_size,
+		     MapMode mode)
+{
+	unmap();
+
+	int oflag;
+
+	switch (mode) {
+	case MapMode::Read:
+		oflag = O_RDONLY;
+		break;
+	case MapMode::Write:
+		oflag = O_WRONLY;
+		break;
+	case MapMode::ReadWrite:
+	default:
+		oflag = O_RDWR;
+		break;
+	}
+
+	m_fd = open(m_filename.c_str(), oflag);
+
+	if (m_fd == -1)
+		throw runtime_error(std::format("Failed to open file '{}': {}", m_filename, strerror(errno)));
+
+	struct stat st;
+	int r = fstat(m_fd, &st);
+	if (r != 0)
+		throw runtime_error(std::format("Failed to get file stat: {}", strerror(errno)));
+
+	// Files of pseudo filesystems, e.g. debugfs, may have size 0
+	if (S_ISREG(st.st_mode) && st.st_size && (uint64_t)st.st_size < offset + length)
+		throw runtime_error("Trying to access file past its end");
+
+	m_default_data_size = default_data_size;
+	m_default_data_endianness = default_data_endianness;
+	m_mode = mode;
+	m_offset = offset;
+	m_len = length;
+
+	if (m_use_io_uring && !m_ring)
+		m_ring = Ring::create();
+
+	m_range_syscalls = 0;
+}
+
+void FileTarget::unmap()
+{
+	if (m_fd == -1)
+		return;
+
+	close(m_fd);
+
+	m_fd = -1;
+}
+
+void FileTarget::sync()
+{
+	if (m_fd == -1 || m_mode == MapMode::Read)
+		return;
+
+	// Pseudo files can't be synced
+	if (fdatasync(m_fd) != 0 && errno != EINVAL && errno != EROFS)
+		throw runtime_error(std::format("failed to fdatasync(): {}", strerror(errno)));
+}
+
+uint64_t FileTarget::read(uint64_t addr, uint8_t nbytes, Endianness endianness) const
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	if (endianness == Endianness::Default)
+		endianness = m_default_data_endianness;
+
+	const MMapAccessor acc = select_accessor(nbytes, endianness);
+
+	validate_access(addr, nbytes);
+
+	uint8_t buf[8];
+	file_access(m_fd, false, addr, buf, nbytes);
+
+	return acc.read(buf);
+}
+
+void FileTarget::write(uint64_t addr, uint64_t value, uint8_t nbytes, Endianness endianness)
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	if (endianness == Endianness::Default)
+		endianness = m_default_data_endianness;
+
+	const MMapAccessor acc = select_accessor(nbytes, endianness);
+
+	validate_access(addr, nbytes, true);
+
+	uint8_t buf[8];
+	acc.write(buf, value);
+
+	file_access(m_fd, true, addr, buf, nbytes);
+}
+
+void FileTarget::read_range(uint64_t addr, void* buf, uint64_t len, uint8_t nbytes) const
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	validate_access(addr, len);
+
+	range_access(addr, static_cast<uint8_t*>(buf), len, nbytes, false);
+}
+
+void FileTarget::write_range(uint64_t addr, const void* buf, uint64_t len, uint8_t nbytes)
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	validate_access(addr, len, true);
+
+	// Only read from with writes
+	range_access(addr, const_cast<uint8_t*>(static_cast<const uint8_t*>(buf)), len, nbytes, true);
+}
+
+void FileTarget::range_access(uint64_t addr, uint8_t* buf, uint64_t len, uint8_t nbytes, bool write) const
+{
+	if (nbytes < 1 || nbytes > 8 || len % nbytes)
+		throw runtime_error(std::format("Length {:#x} is not a multiple of the data size {}", len, nbytes));
+
+	const uint64_t count = len / nbytes;
+
+	if (!m_ring) {
+		for (uint64_t i = 0; i < count; ++i)
+			file_access(m_fd, write, addr + i * nbytes, buf + i * nbytes, nbytes);
+
+		m_range_syscalls += count;
+		return;
+	}
+
+	for (uint64_t i = 0; i < count;) {
+		unsigned n = (unsigned)std::min<uint64_t>(count - i, m_ring->entries());
+
+		m_range_syscalls += m_ring->rw(m_fd, write, addr + i * nbytes, buf + i * nbytes, n, nbytes);
+
+		i += n;
+	}
+}
+
+void FileTarget::validate_access(uint64_t addr, uint64_t len, bool write) const
+{
+	if (write && m_mode == MapMode::Read)
+		throw runtime_error("Trying to write to a read-only mapping");
+
+	if (addr < m_offset)
+		throw runtime_error(std::format("address {:#x} below map range {:#x}-{:#x}",
+						addr, m_offset, m_offset + m_len));
+
+	if (len > m_len || addr - m_offset > m_len - len)
+		throw runtime_error("address above map range");
+}
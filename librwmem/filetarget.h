@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "itarget.h"
+
+/*
+ * FileTarget - Accesses a file with pread() and pwrite()
+ *
+ * For files that can't be mmapped, e.g. some sysfs PCI resource files,
+ * debugfs files or files on FUSE. The addresses are file offsets, and every
+ * access is a pread() or pwrite() of the access size, so the kernel sees
+ * the same accesses as with a mapping.
+ *
+ * Range accesses are done one by one, or optionally batched with io_uring
+ * if the kernel supports it: the accesses of up to 64 elements are then
+ * submitted with one system call. They are linked, so they are still done
+ * one at a time in order. Batching saves system calls, but each request
+ * costs more than a pread(), so it only pays off where system calls are
+ * expensive. bench_file compares the two.
+ */
+class FileTarget : public ITarget
+{
+public:
+	explicit FileTarget(const std::string& filename, bool use_io_uring = false);
+	~FileTarget();
+
+	void map(uint64_t offset, uint64_t length,
+		 Endianness default_addr_endianness, uint8_t default_addr_size,
+		 Endianness default_data_endianness, uint8_t default_data_size,
+		 MapMode mode) override;
+	void unmap() override;
+	void sync() override;
+
+	uint64_t read(uint64_t addr, uint8_t nbytes, Endianness endianness) const override;
+	void write(uint64_t addr, uint64_t value, uint8_t nbytes, Endianness endianness) override;
+
+	/*
+	 * Range accesses of len bytes at addr, an element of nbytes (0 meaning
+	 * the map default) at a time. The buffer has the bytes as they are in
+	 * the file.
+	 */
+	void read_range(uint64_t addr, void* buf, uint64_t len, uint8_t nbytes = 0) const;
+	void write_range(uint64_t addr, const void* buf, uint64_t len, uint8_t nbytes = 0);
+
+	/// Whether the range accesses use io_uring, known after map()
+	bool batched() const { return m_ring != nullptr; }
+	/// System calls made for the range accesses since map()
+	uint64_t range_syscalls() const { return m_range_syscalls; }
+
+private:
+	class Ring;
+
+	std::string m_filename;
+	bool m_use_io_uring;
+	int m_fd;
+
+	uint8_t m_default_data_size;
+	Endianness m_default_data_endianness;
+	MapMode m_mode;
+
+	// User requested offset (from the beginning of the file) and length
+	uint64_t m_offset;
+	uint64_t m_len;
+
+	// Created on the first map(), nullptr if io_uring is not used
+	std::unique_ptr<Ring> m_ring;
+	mutable uint64_t m_range_syscalls;
+
+	void validate_access(uint64_t addr, uint64_t len, bool write = false) const;
+	void range_access(uint64_t addr, uint8_t* buf, uint64_t len, uint8_t nbytes, bool write) const;
+};
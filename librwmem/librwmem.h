@@ -0,0 +1,165 @@
+#pragma once
+
+/*
+ * C API for librwmem
+ *
+ * A stable C ABI on top of the C++ library, for use from C and from other
+ * languages via FFI (Python ctypes/cffi, Rust, Lua...).
+ *
+ * All the types are opaque. Block, register and field handles point into the
+ * register file and are valid until the register file is closed.
+ *
+ * Functions returning int return 0 on success and -1 on error. Functions
+ * returning a pointer return NULL on error or if nothing was found. In both
+ * cases rwmem_last_error() describes the error. The error is per thread.
+ *
+ * A rwmem_regfile or a rwmem_target must not be used from several threads
+ * at the same time, but different handles can be used in parallel.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RWMEM_API __attribute__((visibility("default")))
+
+/* Incremented when the API changes in a backwards compatible way */
+#define RWMEM_API_VERSION 1
+
+/* Values match the ones stored in the register file */
+typedef enum rwmem_endianness {
+	RWMEM_ENDIANNESS_DEFAULT = 0,
+	RWMEM_ENDIANNESS_BIG = 1,
+	RWMEM_ENDIANNESS_LITTLE = 2,
+	RWMEM_ENDIANNESS_BIG_SWAPPED = 3, /* Big endian, 16/32 bit words swapped */
+	RWMEM_ENDIANNESS_LITTLE_SWAPPED = 4, /* Little endian, 16/32 bit words swapped */
+} rwmem_endianness;
+
+typedef enum rwmem_map_mode {
+	RWMEM_MAP_READ = 0,
+	RWMEM_MAP_WRITE = 1,
+	RWMEM_MAP_READWRITE = 2,
+} rwmem_map_mode;
+
+typedef struct rwmem_regfile rwmem_regfile;
+typedef struct rwmem_block rwmem_block;
+typedef struct rwmem_register rwmem_register;
+typedef struct rwmem_field rwmem_field;
+typedef struct rwmem_target rwmem_target;
+
+typedef struct rwmem_block_info {
+	const char* name;
+	const char* description; /* NULL if none */
+	uint64_t offset;
+	uint64_t size;
+	uint32_t num_regs;
+	uint8_t addr_endianness;
+	uint8_t addr_size;
+	uint8_t data_endianness;
+	uint8_t data_size;
+} rwmem_block_info;
+
+typedef struct rwmem_register_info {
+	const char* name;
+	const char* description; /* NULL if none */
+	uint64_t offset; /* Relative to the block */
+	uint64_t reset_value;
+	uint32_t num_fields;
+	uint8_t data_endianness; /* Resolved from the block if not set */
+	uint8_t data_size; /* Resolved from the block if not set */
+} rwmem_register_info;
+
+typedef struct rwmem_field_info {
+	const char* name;
+	const char* description; /* NULL if none */
+	uint8_t high;
+	uint8_t low;
+} rwmem_field_info;
+
+RWMEM_API uint32_t rwmem_api_version(void);
+
+/* Description of the last error in this thread */
+RWMEM_API const char* rwmem_last_error(void);
+
+/* Register files */
+
+RWMEM_API rwmem_regfile* rwmem_regfile_open(const char* filename);
+RWMEM_API void rwmem_regfile_close(rwmem_regfile* rf);
+
+RWMEM_API const char* rwmem_regfile_name(const rwmem_regfile* rf);
+RWMEM_API uint32_t rwmem_regfile_num_blocks(const rwmem_regfile* rf);
+RWMEM_API const rwmem_block* rwmem_regfile_block_at(const rwmem_regfile* rf, uint32_t idx);
+/* Case-insensitive */
+RWMEM_API const rwmem_block* rwmem_regfile_find_block(const rwmem_regfile* rf, const char* name);
+/* Find the register at an absolute address, and optionally its block */
+RWMEM_API const rwmem_register* rwmem_regfile_find_register(const rwmem_regfile* rf, uint64_t address,
+							   const rwmem_block** block);
+
+RWMEM_API int rwmem_block_get_info(const rwmem_regfile* rf, const rwmem_block* block, rwmem_block_info* info);
+RWMEM_API const rwmem_register* rwmem_block_register_at(const rwmem_regfile* rf, const rwmem_block* block,
+							uint32_t idx);
+/* Case-insensitive */
+RWMEM_API const rwmem_register* rwmem_block_find_register(const rwmem_regfile* rf, const rwmem_block* block,
+							  const char* name);
+
+RWMEM_API int rwmem_register_get_info(const rwmem_regfile* rf, const rwmem_block* block,
+				      const rwmem_register* reg, rwmem_register_info* info);
+RWMEM_API const rwmem_field* rwmem_register_field_at(const rwmem_regfile* rf, const rwmem_register* reg,
+						     uint32_t idx);
+/* Case-insensitive */
+RWMEM_API const rwmem_field* rwmem_register_find_field(const rwmem_regfile* rf, const rwmem_register* reg,
+						       const char* name);
+
+RWMEM_API int rwmem_field_get_info(const rwmem_regfile* rf, const rwmem_field* field, rwmem_field_info* info);
+
+/* Bits high:low of a register value */
+RWMEM_API uint64_t rwmem_field_decode(uint64_t reg_value, uint8_t high, uint8_t low);
+/* Register value with the bits high:low replaced with field_value */
+RWMEM_API uint64_t rwmem_field_encode(uint64_t reg_value, uint8_t high, uint8_t low, uint64_t field_value);
+
+/* Targets */
+
+/*
+ * Map 'length' bytes at 'offset' of a file, e.g. /dev/mem. The addresses
+ * given to the access functions are file offsets, i.e. 'offset' is not added
+ * to them.
+ */
+RWMEM_API rwmem_target* rwmem_target_open_mmap(const char* filename, uint64_t offset, uint64_t length,
+					       rwmem_endianness data_endianness, uint8_t data_size,
+					       rwmem_map_mode mode);
+/* Access the registers of the device at 'dev_addr' on /dev/i2c-<adapter> */
+RWMEM_API rwmem_target* rwmem_target_open_i2c(uint16_t adapter, uint16_t dev_addr, uint64_t offset,
+					      uint64_t length, rwmem_endianness addr_endianness,
+					      uint8_t addr_size, rwmem_endianness data_endianness,
+					      uint8_t data_size, rwmem_map_mode mode);
+RWMEM_API void rwmem_target_close(rwmem_target* target);
+
+/*
+ * Map at most 'size' bytes of an mmap target at a time, moving the window as
+ * needed, for ranges larger than the address space allows. 0 maps the whole
+ * range. The default is 256 MiB on 32-bit systems and 0 on 64-bit ones.
+ */
+RWMEM_API int rwmem_target_set_window_size(rwmem_target* target, uint64_t size);
+
+/* A data_size of 0 and RWMEM_ENDIANNESS_DEFAULT use the target's defaults */
+RWMEM_API int rwmem_target_read(rwmem_target* target, uint64_t addr, uint8_t data_size,
+				rwmem_endianness data_endianness, uint64_t* value);
+RWMEM_API int rwmem_target_write(rwmem_target* target, uint64_t addr, uint64_t value, uint8_t data_size,
+				 rwmem_endianness data_endianness);
+
+/*
+ * Read or write 'count' consecutive values starting at 'addr', each with a
+ * single access of 'data_size' bytes, which must be 1, 2, 4 or 8. 'values'
+ * is an array of host endian uint8_t, uint16_t, uint32_t or uint64_t.
+ */
+RWMEM_API int rwmem_target_read_array(rwmem_target* target, uint64_t addr, void* values, size_t count,
+				      uint8_t data_size, rwmem_endianness data_endianness);
+RWMEM_API int rwmem_target_write_array(rwmem_target* target, uint64_t addr, const void* values,
+				       size_t count, uint8_t data_size, rwmem_endianness data_endianness);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <cstdio>
+#include <cstdint>
 #include <cstring>
 #include <sys/mman.h>
 #include <sys/types.h>
@@ -9,16 +10,29 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <format>
+#include <array>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
 static const uint64_t pagesize = sysconf(_SC_PAGESIZE);
 static const uint64_t pagemask = pagesize - 1;
 
+// Physical addresses above 4 GiB, and files larger than 2 GiB, need 64-bit
+// file offsets, i.e. _FILE_OFFSET_BITS=64 on 32-bit systems
+static_assert(sizeof(off_t) == 8, "64-bit off_t required");
+
+// The default window size with windowed mapping, 0 for mapping whole ranges.
+// 32-bit systems have 2-3 GiB of address space in all.
+static const uint64_t default_window_size = sizeof(void*) < 8 ? 256 * 1024 * 1024 : 0;
+
 template<typename T>
-static T ioread(void* addr)
+static T ioread(const void* addr)
 {
-	return *static_cast<volatile T*>(addr);
+	return *static_cast<const volatile T*>(addr);
 }
 
 template<typename T>
@@ -27,17 +41,33 @@ static void iowrite(void* addr, T value)
 	*static_cast<volatile T*>(addr) = value;
 }
 
-static uint64_t read_bytes(void* base_addr, uint8_t nbytes, Endianness endianness)
+template<typename T, Endianness E>
+static uint64_t read_value(const void* addr)
 {
-	volatile uint8_t* addr = static_cast<volatile uint8_t*>(base_addr);
+	return to_host(ioread<T>(addr), E);
+}
+
+template<typename T, Endianness E>
+static void write_value(void* addr, uint64_t value)
+{
+	iowrite<T>(addr, from_host((T)value, E));
+}
+
+// 3, 5, 6 and 7 byte accesses are done byte by byte. All endiannesses except
+// little are big endian.
+
+template<unsigned N, bool LE>
+static uint64_t read_bytes(const void* base_addr)
+{
+	const volatile uint8_t* addr = static_cast<const volatile uint8_t*>(base_addr);
 	uint64_t result = 0;
 
-	if (endianness == Endianness::Little) {
-		for (int i = 0; i < nbytes; i++) {
+	if (LE) {
+		for (unsigned i = 0; i < N; i++) {
 			result |= ((uint64_t)addr[i]) << (i * 8);
 		}
 	} else {
-		for (int i = 0; i < nbytes; i++) {
+		for (unsigned i = 0; i < N; i++) {
 			result = (result << 8) | addr[i];
 		}
 	}
@@ -45,28 +75,186 @@ static uint64_t read_bytes(void* base_addr, uint8_t nbytes, Endianness endiannes
 	return result;
 }
 
-static void write_bytes(void* base_addr, uint64_t value, uint8_t nbytes, Endianness endianness)
+template<unsigned N, bool LE>
+static void write_bytes(void* base_addr, uint64_t value)
 {
 	volatile uint8_t* addr = static_cast<volatile uint8_t*>(base_addr);
 
-	if (endianness == Endianness::Little) {
-		for (int i = 0; i < nbytes; i++) {
+	if (LE) {
+		for (unsigned i = 0; i < N; i++) {
 			addr[i] = (value >> (i * 8)) & 0xff;
 		}
 	} else {
-		for (int i = 0; i < nbytes; i++) {
-			addr[i] = (value >> ((nbytes - 1 - i) * 8)) & 0xff;
+		for (unsigned i = 0; i < N; i++) {
+			addr[i] = (value >> ((N - 1 - i) * 8)) & 0xff;
 		}
 	}
 }
 
-MMapTarget::MMapTarget(const string& filename)
-	: m_filename(filename), m_fd(-1),
+template<unsigned N, Endianness E>
+static constexpr MMapAccessor make_accessor()
+{
+	if constexpr (N == 1)
+		return { read_value<uint8_t, E>, write_value<uint8_t, E> };
+	else if constexpr (N == 2)
+		return { read_value<uint16_t, E>, write_value<uint16_t, E> };
+	else if constexpr (N == 4)
+		return { read_value<uint32_t, E>, write_value<uint32_t, E> };
+	else if constexpr (N == 8)
+		return { read_value<uint64_t, E>, write_value<uint64_t, E> };
+	else
+		return { read_bytes<N, E == Endianness::Little>, write_bytes<N, E == Endianness::Little> };
+}
+
+static constexpr unsigned num_endiannesses = 5;
+
+// Indexed with the Endianness value
+template<unsigned N>
+static constexpr array<MMapAccessor, num_endiannesses> make_accessors()
+{
+	return {
+		make_accessor<N, Endianness::Default>(),
+		make_accessor<N, Endianness::Big>(),
+		make_accessor<N, Endianness::Little>(),
+		make_accessor<N, Endianness::BigSwapped>(),
+		make_accessor<N, Endianness::LittleSwapped>(),
+	};
+}
+
+// Indexed with the data size - 1
+static constexpr array<array<MMapAccessor, num_endiannesses>, 8> accessors = {
+	make_accessors<1>(), make_accessors<2>(), make_accessors<3>(), make_accessors<4>(),
+	make_accessors<5>(), make_accessors<6>(), make_accessors<7>(), make_accessors<8>(),
+};
+
+MMapAccessor select_accessor(uint8_t nbytes, Endianness endianness)
+{
+	if (nbytes < 1 || nbytes > 8)
+		throw runtime_error(std::format("Illegal data regsize '{}'", nbytes));
+
+	if ((unsigned)endianness >= num_endiannesses)
+		throw runtime_error(std::format("Illegal endianness '{}'", (unsigned)endianness));
+
+	return accessors[nbytes - 1][(unsigned)endianness];
+}
+
+MapType parse_map_type(string_view str)
+{
+	if (str == "uc")
+		return MapType::Uncached;
+	if (str == "wc")
+		return MapType::WriteCombine;
+	if (str == "cached")
+		return MapType::Cached;
+
+	throw runtime_error(std::format("Unknown mapping type '{}'. Valid types: uc, wc, cached", str));
+}
+
+// Flush and invalidate the data cache lines of a range. Only arm64 and x86
+// allow this from userspace, elsewhere the range is only msync()ed. clflush
+// comes with SSE2, so i386 builds without it msync() too.
+static void flush_dcache(void* start, size_t len)
+{
+#if defined(__aarch64__)
+	uint64_t ctr;
+	asm volatile("mrs %0, ctr_el0" : "=r"(ctr));
+	const uintptr_t line = 4 << ((ctr >> 16) & 0xf);
+
+	for (uintptr_t p = (uintptr_t)start & ~(line - 1); p < (uintptr_t)start + len; p += line)
+		asm volatile("dc civac, %0" : : "r"(p) : "memory");
+
+	asm volatile("dsb sy" : : : "memory");
+#elif defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+	static const uintptr_t line = [] {
+		long l = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+		return l > 0 ? (uintptr_t)l : 64;
+	}();
+
+	for (uintptr_t p = (uintptr_t)start & ~(line - 1); p < (uintptr_t)start + len; p += line)
+		__builtin_ia32_clflush((const void*)p);
+
+	__builtin_ia32_mfence();
+#else
+	uintptr_t page_start = (uintptr_t)start & ~pagemask;
+	msync((void*)page_start, (uintptr_t)start + len - page_start, MS_SYNC | MS_INVALIDATE);
+#endif
+}
+
+// The value of an element repeated to fill 8 bytes, in memory byte order.
+// The element size must divide 8.
+static uint64_t replicate(const MMapAccessor& acc, uint8_t nbytes, uint64_t value)
+{
+	uint8_t buf[8];
+
+	for (unsigned i = 0; i < 8; i += nbytes)
+		acc.write(buf + i, value);
+
+	uint64_t pattern;
+	memcpy(&pattern, buf, 8);
+	return pattern;
+}
+
+// Fill from a 16 byte aligned p with the pattern, up to the last whole 16
+// bytes before end. Returns the first byte not filled.
+static uint8_t* fill_wide(uint8_t* p, const uint8_t* end, uint64_t pattern)
+{
+#if defined(__SSE2__)
+	// The filled memory is not read back, so bypass the cache
+	const __m128i v = _mm_set1_epi64x((long long)pattern);
+
+	for (; end - p >= 16; p += 16)
+		_mm_stream_si128((__m128i*)p, v);
+
+	_mm_sfence();
+#else
+	for (; end - p >= 16; p += 16) {
+		memcpy(p, &pattern, 8);
+		memcpy(p + 8, &pattern, 8);
+	}
+#endif
+
+	return p;
+}
+
+// Update from a 16 byte aligned p, like fill_wide(). Plain loads and stores,
+// which the compiler can vectorize.
+static uint8_t* update_wide(uint8_t* p, const uint8_t* end, uint64_t mask, uint64_t value)
+{
+	for (; end - p >= 16; p += 16) {
+		uint64_t v[2];
+		memcpy(v, p, 16);
+		v[0] = (v[0] & ~mask) | value;
+		v[1] = (v[1] & ~mask) | value;
+		memcpy(p, v, 16);
+	}
+
+	return p;
+}
+
+// The write-combining variant of a PCI sysfs resource file, or an empty string
+static string wc_filename(const string& filename)
+{
+	size_t idx = filename.rfind('/');
+	string_view base = string_view(filename).substr(idx == string::npos ? 0 : idx + 1);
+
+	if (!base.starts_with("resource") || base.size() == 8 ||
+	    base.find_first_not_of("0123456789", 8) != string_view::npos)
+		return "";
+
+	string wc = filename + "_wc";
+
+	return access(wc.c_str(), F_OK) == 0 ? wc : "";
+}
+
+MMapTarget::MMapTarget(const string& filename, MapType type)
+	: m_filename(filename), m_type(type), m_fd(-1),
 	  m_default_addr_endianness(Endianness::Default), m_default_addr_size(0),
 	  m_default_data_endianness(Endianness::Default), m_default_data_size(0),
-	  m_mode(MapMode::ReadWrite), m_offset(0), m_len(0),
-	  m_map_base(MAP_FAILED), m_map_offset(0), m_map_len(0)
+	  m_mode(MapMode::ReadWrite), m_accessor{}, m_offset(0), m_len(0),
+	  m_map_base(MAP_FAILED), m_map_offset(0), m_map_len(0),
+	  m_window_size(0), m_windowed(false), m_prot(0), m_map_end(0), m_window_moves(0)
 {
+	set_window_size(default_window_size);
 }
 
 MMapTarget::~MMapTarget()
@@ -87,6 +275,12 @@ void MMapTarget::map(uint64_t offset, uint64_t length,
 	m_default_data_size = default_data_size;
 	m_mode = mode;
 
+	// An invalid default size is an error only when it is used
+	if (default_data_size >= 1 && default_data_size <= 8)
+		m_accessor = select_accessor(default_data_size, default_data_endianness);
+	else
+		m_accessor = {};
+
 	int oflag;
 	int prot;
 
@@ -106,13 +300,30 @@ void MMapTarget::map(uint64_t offset, uint64_t length,
 		break;
 	}
 
-	m_fd = open(m_filename.c_str(), oflag | O_SYNC);
+	string filename = m_filename;
+
+	switch (m_type) {
+	case MapType::Uncached:
+		oflag |= O_SYNC;
+		break;
+	case MapType::WriteCombine:
+		if (string wc = wc_filename(m_filename); !wc.empty())
+			filename = wc;
+		else
+			oflag |= O_SYNC;
+		break;
+	case MapType::Cached:
+		break;
+	}
+
+	m_fd = open(filename.c_str(), oflag);
 
 	if (m_fd == -1)
-		throw runtime_error(std::format("Failed to open file '{}': {}", m_filename, strerror(errno)));
+		throw runtime_error(std::format("Failed to open file '{}': {}", filename, strerror(errno)));
 
 	const off_t mmap_offset = offset & ~pagemask;
-	const size_t mmap_len = (offset + length - mmap_offset + pagesize - 1) & ~pagemask;
+	// 64-bit, as the range can be larger than the address space with a window
+	const uint64_t mmap_len = (offset + length - mmap_offset + pagesize - 1) & ~pagemask;
 
 	//fmt::print("mmap offset={:#x} length={:#x} mmap_offset={:#x} mmap_len={:#x}\n",
 	//       offset, length, mmap_offset, mmap_len);
@@ -122,10 +333,22 @@ void MMapTarget::map(uint64_t offset, uint64_t length,
 	if (r != 0)
 		throw runtime_error(std::format("Failed to get map file stat: {}", strerror(errno)));
 
-	if (S_ISREG(st.st_mode) && (size_t)st.st_size < offset + length)
+	if (S_ISREG(st.st_mode) && (uint64_t)st.st_size < offset + length)
 		throw runtime_error("Trying to access file past its end");
 
-	m_map_base = mmap(nullptr, mmap_len,
+	// Map the first window of a range larger than the window
+	m_windowed = m_window_size && mmap_len > m_window_size;
+	m_prot = prot;
+	m_map_end = mmap_offset + mmap_len;
+	m_window_moves = 0;
+
+	if (!m_windowed && mmap_len > SIZE_MAX)
+		throw runtime_error(std::format("Range of {:#x} bytes does not fit in the address space, "
+						"use a map window", length));
+
+	const size_t map_len = m_windowed ? m_window_size : mmap_len;
+
+	m_map_base = mmap(nullptr, map_len,
 			  prot,
 			  MAP_SHARED, m_fd, mmap_offset);
 
@@ -135,7 +358,51 @@ void MMapTarget::map(uint64_t offset, uint64_t length,
 	m_offset = offset;
 	m_len = length;
 	m_map_offset = mmap_offset;
-	m_map_len = mmap_len;
+	m_map_len = map_len;
+}
+
+void MMapTarget::set_window_size(uint64_t size)
+{
+	// Two pages at least, so that any element fits in the window of its page
+	if (size)
+		size = std::max((size + pagemask) & ~pagemask, 2 * pagesize);
+
+	m_window_size = size;
+}
+
+uint64_t MMapTarget::window_len(uint64_t addr, uint64_t len) const
+{
+	if (!m_windowed)
+		return len;
+
+	// The window is moved to start at the page of the address
+	return std::min(len, (addr & ~pagemask) + m_window_size - addr);
+}
+
+// Map the window at the page of addr, clipped to the end of the user range
+void MMapTarget::move_window(uint64_t addr, uint64_t len) const
+{
+	if (window_len(addr, len) < len)
+		throw runtime_error(std::format("range {:#x}+{:#x} does not fit in the map window of {:#x} bytes",
+						addr, len, m_window_size));
+
+	const uint64_t map_offset = addr & ~pagemask;
+	const uint64_t map_len = std::min(m_window_size, m_map_end - map_offset);
+
+	if (munmap(m_map_base, m_map_len) == -1)
+		fputs(std::format("Warning: failed to munmap: {}\n", strerror(errno)).c_str(), stderr);
+
+	m_map_base = mmap(nullptr, map_len, m_prot, MAP_SHARED, m_fd, map_offset);
+
+	if (m_map_base == MAP_FAILED) {
+		// Retried on the next access
+		m_map_len = 0;
+		throw runtime_error(std::format("failed to mmap: {}", strerror(errno)));
+	}
+
+	m_map_offset = map_offset;
+	m_map_len = map_len;
+	m_window_moves++;
 }
 
 void MMapTarget::unmap()
@@ -163,7 +430,7 @@ void MMapTarget::sync()
 		throw runtime_error(std::format("failed to msync(): {}", strerror(errno)));
 }
 
-uint64_t MMapTarget::read(uint64_t addr, uint8_t nbytes, Endianness endianness) const
+MMapAccessor MMapTarget::accessor(uint8_t nbytes, Endianness endianness) const
 {
 	if (!nbytes)
 		nbytes = m_default_data_size;
@@ -171,79 +438,165 @@ uint64_t MMapTarget::read(uint64_t addr, uint8_t nbytes, Endianness endianness)
 	if (endianness == Endianness::Default)
 		endianness = m_default_data_endianness;
 
+	if (nbytes == m_default_data_size && endianness == m_default_data_endianness && m_accessor.read)
+		return m_accessor;
+
+	return select_accessor(nbytes, endianness);
+}
+
+uint64_t MMapTarget::read(uint64_t addr, uint8_t nbytes, Endianness endianness) const
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
 	validate_access(addr, nbytes);
 
-	void* base_addr = maddr(addr);
-
-	switch (nbytes) {
-	case 1:
-		return ioread<uint8_t>(base_addr);
-	case 2:
-		return to_host(ioread<uint16_t>(base_addr), endianness);
-	case 4:
-		return to_host(ioread<uint32_t>(base_addr), endianness);
-	case 8:
-		return to_host(ioread<uint64_t>(base_addr), endianness);
-	case 3:
-	case 5:
-	case 6:
-	case 7:
-		return read_bytes(base_addr, nbytes, endianness);
-	default:
-		throw runtime_error(std::format("Illegal data regsize '{}'", nbytes));
-	}
+	if (m_type == MapType::Cached)
+		flush_cache(addr, nbytes);
+
+	return read_unchecked(accessor(nbytes, endianness), addr);
 }
 
 void MMapTarget::write(uint64_t addr, uint64_t value, uint8_t nbytes, Endianness endianness)
 {
-	if (m_mode != MapMode::Write && m_mode != MapMode::ReadWrite)
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	validate_range(addr, nbytes, true);
+
+	write_unchecked(accessor(nbytes, endianness), addr, value);
+
+	// Write back to RAM, for devices
+	if (m_type == MapType::Cached)
+		flush_cache(addr, nbytes);
+}
+
+void MMapTarget::validate_range(uint64_t addr, uint64_t len, bool write) const
+{
+	if (write && m_mode == MapMode::Read)
 		throw runtime_error("Trying to write to a read-only mapping");
 
+	validate_access(addr, len);
+}
+
+void MMapTarget::flush_cache(uint64_t addr, uint64_t len) const
+{
+	if (m_type == MapType::Cached)
+		flush_dcache(maddr(addr), len);
+}
+
+bool MMapTarget::wide_access_ok(const void* p, uint8_t nbytes) const
+{
+	// Device registers need accesses of the register size
+	if (m_type == MapType::Uncached)
+		return false;
+
+	// The elements must tile the wide accesses
+	return 8 % nbytes == 0 && (uintptr_t)p % nbytes == 0;
+}
+
+void MMapTarget::fill(uint64_t addr, uint64_t len, uint64_t value, uint8_t nbytes, Endianness endianness)
+{
 	if (!nbytes)
 		nbytes = m_default_data_size;
 
-	if (endianness == Endianness::Default)
-		endianness = m_default_data_endianness;
+	const MMapAccessor acc = accessor(nbytes, endianness);
 
-	validate_access(addr, nbytes);
+	len -= len % nbytes;
 
-	void* base_addr = maddr(addr);
+	// Whole elements at a time in each window
+	while (len) {
+		uint64_t n = window_len(addr, len);
+		n -= n % nbytes;
 
-	switch (nbytes) {
-	case 1:
-		iowrite<uint8_t>(base_addr, (uint8_t)value);
-		break;
-	case 2:
-		iowrite<uint16_t>(base_addr, from_host((uint16_t)value, endianness));
-		break;
-	case 4:
-		iowrite<uint32_t>(base_addr, from_host((uint32_t)value, endianness));
-		break;
-	case 8:
-		iowrite<uint64_t>(base_addr, from_host(value, endianness));
-		break;
-	case 3:
-	case 5:
-	case 6:
-	case 7:
-		write_bytes(base_addr, value, nbytes, endianness);
-		break;
-	default:
-		throw runtime_error(std::format("Illegal data regsize '{}'", nbytes));
+		fill_window(acc, addr, n, value, nbytes);
+
+		addr += n;
+		len -= n;
+	}
+}
+
+void MMapTarget::fill_window(const MMapAccessor& acc, uint64_t addr, uint64_t len, uint64_t value, uint8_t nbytes)
+{
+	validate_range(addr, len, true);
+
+	uint8_t* p = static_cast<uint8_t*>(maddr(addr));
+	uint8_t* end = p + len;
+
+	if (wide_access_ok(p, nbytes)) {
+		for (; p < end && (uintptr_t)p % 16; p += nbytes)
+			acc.write(p, value);
+
+		p = fill_wide(p, end, replicate(acc, nbytes, value));
+	}
+
+	for (; p < end; p += nbytes)
+		acc.write(p, value);
+
+	// Write back to RAM, for devices
+	flush_cache(addr, len);
+}
+
+void MMapTarget::update(uint64_t addr, uint64_t len, uint64_t mask, uint64_t value, uint8_t nbytes,
+			Endianness endianness)
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	const MMapAccessor acc = accessor(nbytes, endianness);
+
+	len -= len % nbytes;
+	value &= mask;
+
+	while (len) {
+		uint64_t n = window_len(addr, len);
+		n -= n % nbytes;
+
+		update_window(acc, addr, n, mask, value, nbytes);
+
+		addr += n;
+		len -= n;
 	}
 }
 
-void MMapTarget::validate_access(uint64_t addr, uint8_t nbytes) const
+void MMapTarget::update_window(const MMapAccessor& acc, uint64_t addr, uint64_t len, uint64_t mask,
+			       uint64_t value, uint8_t nbytes)
+{
+	validate_range(addr, len, true);
+
+	flush_cache(addr, len);
+
+	uint8_t* p = static_cast<uint8_t*>(maddr(addr));
+	uint8_t* end = p + len;
+
+	auto update_elem = [&](uint8_t* ep) {
+		acc.write(ep, (acc.read(ep) & ~mask) | value);
+	};
+
+	if (wide_access_ok(p, nbytes)) {
+		for (; p < end && (uintptr_t)p % 16; p += nbytes)
+			update_elem(p);
+
+		// Byte swapping commutes with the bitwise ops, so the patterns can be
+		// applied in memory byte order
+		p = update_wide(p, end, replicate(acc, nbytes, mask), replicate(acc, nbytes, value));
+	}
+
+	for (; p < end; p += nbytes)
+		update_elem(p);
+
+	flush_cache(addr, len);
+}
+
+void MMapTarget::validate_access(uint64_t addr, uint64_t len) const
 {
 	if (addr < m_offset)
 		throw runtime_error(std::format("address {:#x} below map range {:#x}-{:#x}",
 						addr, m_offset, m_offset + m_len));
 
-	if (addr + nbytes > m_offset + m_len)
+	if (len > m_len || addr - m_offset > m_len - len)
 		throw runtime_error("address above map range");
-}
 
-void* MMapTarget::maddr(uint64_t addr) const
-{
-	return (uint8_t*)m_map_base + (addr - m_map_offset);
+	if (m_windowed && (addr < m_map_offset || len > m_map_len || addr - m_map_offset > m_map_len - len))
+		move_window(addr, len);
 }
@@ -1,14 +1,64 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include "itarget.h"
 
+/*
+ * How the memory is mapped
+ *
+ * Uncached: opened with O_SYNC, for device registers. This is the default.
+ * WriteCombine: for RAM, e.g. framebuffers. PCI sysfs resource files are
+ *   replaced with their resourceN_wc variant. Other files are opened with
+ *   O_SYNC, which the arm and arm64 kernels map as write-combining for RAM.
+ * Cached: opened without O_SYNC, so RAM is mapped cached. The cache lines are
+ *   flushed before reads, so that data written by devices is seen.
+ */
+enum class MapType {
+	Uncached,
+	WriteCombine,
+	Cached,
+};
+
+/// Parse "uc", "wc" or "cached", throws runtime_error for others
+MapType parse_map_type(std::string_view str);
+
+// Reads or writes a value of one data size and endianness
+struct MMapAccessor {
+	uint64_t (*read)(const void* addr);
+	void (*write)(void* addr, uint64_t value);
+};
+
+/// The accessor of a data size and endianness, for any memory, throws
+/// runtime_error for illegal ones
+MMapAccessor select_accessor(uint8_t nbytes, Endianness endianness);
+
 class MMapTarget : public ITarget
 {
 public:
-	explicit MMapTarget(const std::string& filename);
+	explicit MMapTarget(const std::string& filename, MapType type = MapType::Uncached);
 	~MMapTarget();
 
+	/// Mapping type for the following map() calls
+	void set_map_type(MapType type) { m_type = type; }
+	MapType map_type() const { return m_type; }
+
+	/*
+	 * Windowed mapping, for ranges larger than the address space allows,
+	 * e.g. on 32-bit systems. With a nonzero window size, map() maps at most
+	 * that much of the range at a time, and the window is moved when an
+	 * access is outside it. A range validated with validate_range() must fit
+	 * in a window, window_len() gives how much of a range does. The size is
+	 * rounded up to whole pages, and is 256 MiB by default on 32-bit
+	 * systems, 0 on 64-bit ones. Takes effect on the next map().
+	 */
+	void set_window_size(uint64_t size);
+	uint64_t window_size() const { return m_window_size; }
+	/// The length of the start of the range at addr that fits in a window
+	uint64_t window_len(uint64_t addr, uint64_t len) const;
+	/// How many times the window has been moved since map()
+	uint64_t window_moves() const { return m_window_moves; }
+
 	void map(uint64_t offset, uint64_t length,
 		 Endianness default_addr_endianness, uint8_t default_addr_size,
 		 Endianness default_data_endianness, uint8_t default_data_size,
@@ -19,8 +69,62 @@ public:
 	uint64_t read(uint64_t addr, uint8_t nbytes, Endianness endianness) const override;
 	void write(uint64_t addr, uint64_t value, uint8_t nbytes, Endianness endianness) override;
 
+	/*
+	 * Unchecked accesses, for loops over a range that has been checked once
+	 * with validate_range(). The accessor for the data size and endianness
+	 * (0 and Default meaning the map defaults) is resolved once with
+	 * accessor() instead of on every access. For cached mappings,
+	 * flush_cache() the range before reading it.
+	 */
+	MMapAccessor accessor(uint8_t nbytes = 0, Endianness endianness = Endianness::Default) const;
+	void validate_range(uint64_t addr, uint64_t len, bool write = false) const;
+	void flush_cache(uint64_t addr, uint64_t len) const;
+
+	/*
+	 * Range writes. Every whole element of the data size in the range is set
+	 * to value, or with update() to (old & ~mask) | (value & mask). Uncached
+	 * mappings are accessed an element at a time, like with write(). The
+	 * others are RAM, and are accessed 8 or 16 bytes at a time, with
+	 * non-temporal stores for fills on x86. The range can be larger than
+	 * the window.
+	 */
+	void fill(uint64_t addr, uint64_t len, uint64_t value,
+		  uint8_t nbytes = 0, Endianness endianness = Endianness::Default);
+	void update(uint64_t addr, uint64_t len, uint64_t mask, uint64_t value,
+		    uint8_t nbytes = 0, Endianness endianness = Endianness::Default);
+
+	/*
+	 * Range accesses of count consecutive elements at addr, each a single
+	 * access of nbytes (0 meaning the map default), a window at a time.
+	 * read_elements() passes the index and the value of each element to
+	 * store(i, value), write_elements() gets the values from load(i). The
+	 * range is flushed from the cache before reads and after writes, for
+	 * cached mappings. read_array() and write_array() do the same with an
+	 * array of host endian values.
+	 */
+	template<typename F>
+	void read_elements(uint64_t addr, uint64_t count, uint8_t nbytes, Endianness endianness, F store) const;
+	template<typename F>
+	void write_elements(uint64_t addr, uint64_t count, uint8_t nbytes, Endianness endianness, F load);
+
+	template<typename T>
+	void read_array(uint64_t addr, T* values, uint64_t count, Endianness endianness = Endianness::Default) const
+	{
+		read_elements(addr, count, sizeof(T), endianness, [values](uint64_t i, uint64_t v) { values[i] = (T)v; });
+	}
+
+	template<typename T>
+	void write_array(uint64_t addr, const T* values, uint64_t count, Endianness endianness = Endianness::Default)
+	{
+		write_elements(addr, count, sizeof(T), endianness, [values](uint64_t i) { return (uint64_t)values[i]; });
+	}
+
+	uint64_t read_unchecked(const MMapAccessor& acc, uint64_t addr) const { return acc.read(maddr(addr)); }
+	void write_unchecked(const MMapAccessor& acc, uint64_t addr, uint64_t value) { acc.write(maddr(addr), value); }
+
 private:
 	std::string m_filename;
+	MapType m_type;
 	int m_fd;
 
 	Endianness m_default_addr_endianness;
@@ -29,16 +133,84 @@ private:
 	uint8_t m_default_data_size;
 	MapMode m_mode;
 
+	// Accessor for the default data size and endianness, selected in map()
+	MMapAccessor m_accessor;
+
 	// User requested offset (from the beginning of the file) and length
 	uint64_t m_offset;
 	uint64_t m_len;
 
-	void* m_map_base;
+	// mmapped window, or the whole range if not windowed. Moving the window
+	// does not change what the target maps, so it is done in const accesses.
+	mutable void* m_map_base;
 
 	// mmapped offset (from the beginning of the file) and length
-	uint64_t m_map_offset;
-	uint64_t m_map_len;
+	mutable uint64_t m_map_offset;
+	mutable uint64_t m_map_len;
+
+	// 0 if not windowed. The windows are within the page aligned user range,
+	// which ends at m_map_end.
+	uint64_t m_window_size;
+	bool m_windowed;
+	int m_prot;
+	uint64_t m_map_end;
+	mutable uint64_t m_window_moves;
 
-	void validate_access(uint64_t addr, uint8_t nbytes) const;
-	void* maddr(uint64_t addr) const;
+	void validate_access(uint64_t addr, uint64_t len) const;
+	void move_window(uint64_t addr, uint64_t len) const;
+	void fill_window(const MMapAccessor& acc, uint64_t addr, uint64_t len, uint64_t value, uint8_t nbytes);
+	void update_window(const MMapAccessor& acc, uint64_t addr, uint64_t len, uint64_t mask, uint64_t value,
+			   uint8_t nbytes);
+	bool wide_access_ok(const void* p, uint8_t nbytes) const;
+	void* maddr(uint64_t addr) const { return (uint8_t*)m_map_base + (addr - m_map_offset); }
 };
+
+template<typename F>
+void MMapTarget::read_elements(uint64_t addr, uint64_t count, uint8_t nbytes, Endianness endianness, F store) const
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	const MMapAccessor acc = accessor(nbytes, endianness);
+	const uint64_t len = count * nbytes;
+	uint64_t i = 0;
+
+	for (uint64_t done = 0; done < len;) {
+		uint64_t n = window_len(addr + done, len - done);
+		n -= n % nbytes;
+
+		validate_range(addr + done, n);
+		flush_cache(addr + done, n);
+
+		for (uint64_t off = done; off < done + n; off += nbytes)
+			store(i++, read_unchecked(acc, addr + off));
+
+		done += n;
+	}
+}
+
+template<typename F>
+void MMapTarget::write_elements(uint64_t addr, uint64_t count, uint8_t nbytes, Endianness endianness, F load)
+{
+	if (!nbytes)
+		nbytes = m_default_data_size;
+
+	const MMapAccessor acc = accessor(nbytes, endianness);
+	const uint64_t len = count * nbytes;
+	uint64_t i = 0;
+
+	for (uint64_t done = 0; done < len;) {
+		uint64_t n = window_len(addr + done, len - done);
+		n -= n % nbytes;
+
+		validate_range(addr + done, n, true);
+
+		for (uint64_t off = done; off < done + n; off += nbytes)
+			write_unchecked(acc, addr + off, load(i++));
+
+		// Write back to RAM, for devices
+		flush_cache(addr + done, n);
+
+		done += n;
+	}
+}
@@ -0,0 +1,262 @@
+#include "nameindex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+// Case-insensitive three-way comparison, matching the FNM_CASEFOLD and
+// strcasecmp() based lookups elsewhere
+static int compare_nocase(string_view a, string_view b)
+{
+	const size_t len = min(a.size(), b.size());
+
+	for (size_t i = 0; i < len; ++i) {
+		int ca = tolower((unsigned char)a[i]);
+		int cb = tolower((unsigned char)b[i]);
+
+		if (ca != cb)
+			return ca - cb;
+	}
+
+	if (a.size() == b.size())
+		return 0;
+
+	return a.size() < b.size() ? -1 : 1;
+}
+
+static bool has_prefix_nocase(string_view name, string_view prefix)
+{
+	if (name.size() < prefix.size())
+		return false;
+
+	return compare_nocase(name.substr(0, prefix.size()), prefix) == 0;
+}
+
+// Sort indices by the names returned by get_name
+template<typename F>
+static void sort_by_name(vector<uint32_t>& indices, F get_name)
+{
+	sort(indices.begin(), indices.end(), [&](uint32_t a, uint32_t b) {
+		return compare_nocase(get_name(a), get_name(b)) < 0;
+	});
+}
+
+// Return the range of sorted indices whose names start with prefix
+template<typename F>
+static pair<vector<uint32_t>::const_iterator, vector<uint32_t>::const_iterator>
+prefix_range(const vector<uint32_t>& sorted, string_view prefix, F get_name)
+{
+	auto first = lower_bound(sorted.begin(), sorted.end(), prefix, [&](uint32_t idx, string_view p) {
+		return compare_nocase(get_name(idx), p) < 0;
+	});
+
+	auto last = first;
+	while (last != sorted.end() && has_prefix_nocase(get_name(*last), prefix))
+		++last;
+
+	return { first, last };
+}
+
+static const uint32_t NAMEINDEX_CACHE_MAGIC = 0x4e495752; // "RWIN"
+static const uint32_t NAMEINDEX_CACHE_VERSION = 1;
+
+struct NameIndexCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t stamp;
+	uint32_t num_blocks;
+	uint32_t reserved;
+};
+
+RegisterNameIndex::RegisterNameIndex(const RegisterFileData* rfd)
+	: m_rfd(rfd)
+{
+}
+
+bool RegisterNameIndex::load_cache(const string& filename, uint64_t stamp)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	NameIndexCacheHeader hdr;
+	vector<uint32_t> blocks;
+	bool ok = false;
+
+	if (::read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+	    hdr.magic == NAMEINDEX_CACHE_MAGIC && hdr.version == NAMEINDEX_CACHE_VERSION &&
+	    hdr.stamp == stamp && hdr.num_blocks == m_rfd->num_blocks()) {
+		blocks.resize(hdr.num_blocks);
+
+		const ssize_t len = blocks.size() * sizeof(uint32_t);
+		ok = ::read(fd, blocks.data(), len) == len;
+	}
+
+	close(fd);
+
+	if (!ok)
+		return false;
+
+	for (uint32_t idx : blocks) {
+		if (idx >= m_rfd->num_blocks())
+			return false;
+	}
+
+	m_blocks = std::move(blocks);
+
+	return true;
+}
+
+void RegisterNameIndex::save_cache(const string& filename, uint64_t stamp) const
+{
+	const vector<uint32_t>& blocks = sorted_blocks();
+
+	NameIndexCacheHeader hdr{};
+	hdr.magic = NAMEINDEX_CACHE_MAGIC;
+	hdr.version = NAMEINDEX_CACHE_VERSION;
+	hdr.stamp = stamp;
+	hdr.num_blocks = blocks.size();
+
+	// Write to a temp file and rename, so that concurrent readers never see
+	// a partially written cache
+	const string tmpname = filename + ".tmp";
+
+	int fd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		throw runtime_error(std::format("Failed to create index cache '{}': {}", tmpname, strerror(errno)));
+
+	const ssize_t len = blocks.size() * sizeof(uint32_t);
+
+	bool ok = ::write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+		  ::write(fd, blocks.data(), len) == len;
+
+	close(fd);
+
+	if (!ok || rename(tmpname.c_str(), filename.c_str()) != 0) {
+		unlink(tmpname.c_str());
+		throw runtime_error(std::format("Failed to write index cache '{}'", filename));
+	}
+}
+
+const vector<uint32_t>& RegisterNameIndex::sorted_blocks() const
+{
+	if (m_blocks.size() == m_rfd->num_blocks())
+		return m_blocks;
+
+	m_blocks.resize(m_rfd->num_blocks());
+	for (uint32_t i = 0; i < m_blocks.size(); ++i)
+		m_blocks[i] = i;
+
+	sort_by_name(m_blocks, [this](uint32_t idx) { return m_rfd->block_at(idx)->name(m_rfd); });
+
+	return m_blocks;
+}
+
+const vector<uint32_t>& RegisterNameIndex::sorted_registers(const RegisterBlockData* rbd) const
+{
+	auto it = m_registers.find(rbd);
+	if (it != m_registers.end())
+		return it->second;
+
+	vector<uint32_t> indices(rbd->num_regs());
+	for (uint32_t i = 0; i < indices.size(); ++i)
+		indices[i] = i;
+
+	sort_by_name(indices, [this, rbd](uint32_t idx) { return rbd->register_at(m_rfd, idx)->name(m_rfd); });
+
+	return m_registers.emplace(rbd, std::move(indices)).first->second;
+}
+
+const vector<uint32_t>& RegisterNameIndex::sorted_fields(const RegisterData* rd) const
+{
+	auto it = m_fields.find(rd);
+	if (it != m_fields.end())
+		return it->second;
+
+	vector<uint32_t> indices(rd->num_fields());
+	for (uint32_t i = 0; i < indices.size(); ++i)
+		indices[i] = i;
+
+	sort_by_name(indices, [this, rd](uint32_t idx) { return rd->field_at(m_rfd, idx)->name(m_rfd); });
+
+	return m_fields.emplace(rd, std::move(indices)).first->second;
+}
+
+vector<const RegisterBlockData*> RegisterNameIndex::blocks_with_prefix(string_view prefix) const
+{
+	auto get_name = [this](uint32_t idx) { return m_rfd->block_at(idx)->name(m_rfd); };
+	auto [first, last] = prefix_range(sorted_blocks(), prefix, get_name);
+
+	vector<const RegisterBlockData*> res;
+	for (auto it = first; it != last; ++it)
+		res.push_back(m_rfd->block_at(*it));
+
+	return res;
+}
+
+vector<const RegisterData*> RegisterNameIndex::registers_with_prefix(const RegisterBlockData* rbd, string_view prefix) const
+{
+	auto get_name = [this, rbd](uint32_t idx) { return rbd->register_at(m_rfd, idx)->name(m_rfd); };
+	auto [first, last] = prefix_range(sorted_registers(rbd), prefix, get_name);
+
+	vector<const RegisterData*> res;
+	for (auto it = first; it != last; ++it)
+		res.push_back(rbd->register_at(m_rfd, *it));
+
+	return res;
+}
+
+vector<const FieldData*> RegisterNameIndex::fields_with_prefix(const RegisterData* rd, string_view prefix) const
+{
+	auto get_name = [this, rd](uint32_t idx) { return rd->field_at(m_rfd, idx)->name(m_rfd); };
+	auto [first, last] = prefix_range(sorted_fields(rd), prefix, get_name);
+
+	vector<const FieldData*> res;
+	for (auto it = first; it != last; ++it)
+		res.push_back(rd->field_at(m_rfd, *it));
+
+	return res;
+}
+
+const RegisterBlockData* RegisterNameIndex::find_block(string_view name) const
+{
+	const vector<uint32_t>& sorted = sorted_blocks();
+
+	auto it = lower_bound(sorted.begin(), sorted.end(), name, [this](uint32_t idx, string_view n) {
+		return compare_nocase(m_rfd->block_at(idx)->name(m_rfd), n) < 0;
+	});
+
+	if (it == sorted.end())
+		return nullptr;
+
+	const RegisterBlockData* rbd = m_rfd->block_at(*it);
+	if (compare_nocase(rbd->name(m_rfd), name) != 0)
+		return nullptr;
+
+	return rbd;
+}
+
+const RegisterData* RegisterNameIndex::find_register(const RegisterBlockData* rbd, string_view name) const
+{
+	const vector<uint32_t>& sorted = sorted_registers(rbd);
+
+	auto it = lower_bound(sorted.begin(), sorted.end(), name, [this, rbd](uint32_t idx, string_view n) {
+		return compare_nocase(rbd->register_at(m_rfd, idx)->name(m_rfd), n) < 0;
+	});
+
+	if (it == sorted.end())
+		return nullptr;
+
+	const RegisterData* rd = rbd->register_at(m_rfd, *it);
+	if (compare_nocase(rd->name(m_rfd), name) != 0)
+		return nullptr;
+
+	return rd;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "regfiledata.h"
+
+/**
+ * RegisterNameIndex - Sorted name arrays for prefix lookups
+ *
+ * Keeps the blocks, the registers of each block and the fields of each
+ * register sorted by name (case-insensitively), so that all names starting
+ * with a given prefix can be found with a binary search.
+ *
+ * Each array is sorted the first time it is needed, so a lookup only pays
+ * for the levels it walks through. The block array, which is the only one
+ * that touches every block name in the file, can be saved to a cache file
+ * and loaded back on later runs. Not thread safe.
+ */
+class RegisterNameIndex
+{
+public:
+	explicit RegisterNameIndex(const RegisterFileData* rfd);
+
+	/// Blocks whose name starts with prefix, in name order
+	std::vector<const RegisterBlockData*> blocks_with_prefix(std::string_view prefix) const;
+	/// Registers in the block whose name starts with prefix, in name order
+	std::vector<const RegisterData*> registers_with_prefix(const RegisterBlockData* rbd, std::string_view prefix) const;
+	/// Fields in the register whose name starts with prefix, in name order
+	std::vector<const FieldData*> fields_with_prefix(const RegisterData* rd, std::string_view prefix) const;
+
+	/// Load the sorted block array from a cache written by save_cache().
+	/// Returns false if the cache is missing, corrupt or has a different stamp.
+	bool load_cache(const std::string& filename, uint64_t stamp);
+	/// Save the sorted block array to a cache file
+	void save_cache(const std::string& filename, uint64_t stamp) const;
+
+	/// Find block with the given name
+	const RegisterBlockData* find_block(std::string_view name) const;
+	/// Find register in the block with the given name
+	const RegisterData* find_register(const RegisterBlockData* rbd, std::string_view name) const;
+
+private:
+	const RegisterFileData* m_rfd;
+
+	// Block indices sorted by block name
+	mutable std::vector<uint32_t> m_blocks;
+	// Register indices of a block, sorted by register name
+	mutable std::unordered_map<const RegisterBlockData*, std::vector<uint32_t>> m_registers;
+	// Field indices of a register, sorted by field name
+	mutable std::unordered_map<const RegisterData*, std::vector<uint32_t>> m_fields;
+
+	const std::vector<uint32_t>& sorted_blocks() const;
+	const std::vector<uint32_t>& sorted_registers(const RegisterBlockData* rbd) const;
+	const std::vector<uint32_t>& sorted_fields(const RegisterData* rd) const;
+};
@@ -1,5 +1,7 @@
 #include "regfiledata.h"
 #include <cstring>
+#include <format>
+#include <stdexcept>
 
 using namespace std;
 
@@ -86,6 +88,85 @@ const RegisterData* RegisterFileData::find_register(uint64_t offset, const Regis
 	return nullptr;
 }
 
+size_t RegisterFileData::validate_header(size_t size) const
+{
+	if (size < sizeof(RegisterFileData))
+		throw runtime_error(std::format("Register file too small: {} bytes", size));
+
+	// 64-bit arithmetic, so that huge counts cannot wrap around
+	const uint64_t tables_size = sizeof(RegisterFileData) +
+				     (uint64_t)num_blocks() * sizeof(RegisterBlockData) +
+				     (uint64_t)num_regs() * sizeof(RegisterData) +
+				     (uint64_t)num_fields() * sizeof(FieldData) +
+				     (uint64_t)num_reg_indices() * sizeof(uint32_t) +
+				     (uint64_t)num_field_indices() * sizeof(uint32_t);
+
+	// The string pool has to contain at least the empty string at offset 0
+	if (tables_size >= size)
+		throw runtime_error(std::format("Register file truncated: tables need {} bytes, file has {}",
+						tables_size, size));
+
+	const uint64_t strings_size = size - tables_size;
+
+	// With the last byte of the pool being a NUL, every offset inside the pool
+	// is a terminated string
+	if (strings()[strings_size - 1] != 0)
+		throw runtime_error("Register file string pool not NUL terminated");
+
+	return strings_size;
+}
+
+void RegisterFileData::validate(size_t size) const
+{
+	const uint64_t strings_size = validate_header(size);
+
+	auto check_string = [strings_size](uint32_t offset, const char* what, uint32_t idx) {
+		if (offset >= strings_size)
+			throw runtime_error(std::format("Bad string offset {:#x} in {} {}", offset, what, idx));
+	};
+
+	check_string(name_offset(), "file", 0);
+
+	for (uint32_t i = 0; i < num_blocks(); ++i) {
+		const RegisterBlockData* rbd = &blocks()[i];
+
+		check_string(rbd->name_offset(), "block", i);
+		check_string(rbd->description_offset(), "block", i);
+
+		if ((uint64_t)rbd->first_reg_list_index() + rbd->num_regs() > num_reg_indices())
+			throw runtime_error(std::format("Bad register list in block {}", i));
+	}
+
+	for (uint32_t i = 0; i < num_regs(); ++i) {
+		const RegisterData* rd = &registers()[i];
+
+		check_string(rd->name_offset(), "register", i);
+		check_string(rd->description_offset(), "register", i);
+
+		if ((uint64_t)rd->first_field_index() + rd->num_fields() > num_field_indices())
+			throw runtime_error(std::format("Bad field list in register {}", i));
+	}
+
+	for (uint32_t i = 0; i < num_fields(); ++i) {
+		const FieldData* fd = &fields()[i];
+
+		check_string(fd->name_offset(), "field", i);
+		check_string(fd->description_offset(), "field", i);
+	}
+
+	const uint32_t* reg_indices = register_indices();
+	for (uint32_t i = 0; i < num_reg_indices(); ++i) {
+		if (le32toh(reg_indices[i]) >= num_regs())
+			throw runtime_error(std::format("Bad register index {} at {}", le32toh(reg_indices[i]), i));
+	}
+
+	const uint32_t* fld_indices = field_indices();
+	for (uint32_t i = 0; i < num_field_indices(); ++i) {
+		if (le32toh(fld_indices[i]) >= num_fields())
+			throw runtime_error(std::format("Bad field index {} at {}", le32toh(fld_indices[i]), i));
+	}
+}
+
 const RegisterData* RegisterBlockData::register_at(const RegisterFileData* rfd, uint32_t idx) const
 {
 	if (idx >= num_regs())
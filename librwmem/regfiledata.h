@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <endian.h>
 #include <string>
@@ -74,6 +75,16 @@ struct __attribute__((packed)) RegisterFileData {
 	const RegisterData* find_register(const std::string& name, const RegisterBlockData** rbd) const;
 	const RegisterData* find_register(uint64_t offset, const RegisterBlockData** rbd) const;
 
+	/// Check that the tables fit in 'size' bytes, all indices are in range and all
+	/// string offsets point inside the NUL terminated string pool. The accessors do
+	/// no bounds checking, so this should be done once before using untrusted data.
+	/// Throws runtime_error describing the first problem found.
+	void validate(size_t size) const;
+	/// Like validate(), but only check that the tables fit in 'size' bytes and that
+	/// the string pool is NUL terminated, without reading the tables. Returns the
+	/// size of the string pool.
+	size_t validate_header(size_t size) const;
+
 private:
 	uint32_t m_magic;
 	uint32_t m_version;
@@ -0,0 +1,113 @@
+#include "regfileset.h"
+
+#include <cctype>
+
+using namespace std;
+
+static string upper_name(string_view name)
+{
+	string s(name);
+
+	for (char& c : s)
+		c = toupper((unsigned char)c);
+
+	return s;
+}
+
+void RegisterFileSet::load(const string& filename, bool validate, RegisterFileAccess access)
+{
+	add(make_unique<RegisterFile>(filename, validate, access));
+}
+
+void RegisterFileSet::add(unique_ptr<RegisterFile> regfile)
+{
+	m_files.push_back(std::move(regfile));
+
+	// Rebuild the block index from scratch. There are only a few files, and
+	// the number of blocks is small compared to the number of registers.
+
+	struct BlockPos {
+		uint32_t file;
+		uint32_t block;
+	};
+
+	unordered_map<string, BlockPos> names;
+
+	for (uint32_t fidx = 0; fidx < m_files.size(); ++fidx) {
+		const RegisterFileData* rfd = m_files[fidx]->data();
+
+		for (uint32_t bidx = 0; bidx < rfd->num_blocks(); ++bidx) {
+			auto [it, inserted] = names.try_emplace(upper_name(rfd->block_at(bidx)->name(rfd)),
+								BlockPos{ fidx, bidx });
+
+			// Within a file the first block wins, as in RegisterFileData::find_block()
+			if (!inserted && it->second.file != fidx)
+				it->second = { fidx, bidx };
+		}
+	}
+
+	m_shadowed.assign(m_files.size(), {});
+	m_blocks.clear();
+	m_block_names.clear();
+	m_addresses.clear();
+
+	for (uint32_t fidx = 0; fidx < m_files.size(); ++fidx) {
+		const RegisterFileData* rfd = m_files[fidx]->data();
+
+		m_shadowed[fidx].assign(rfd->num_blocks(), true);
+
+		for (uint32_t bidx = 0; bidx < rfd->num_blocks(); ++bidx) {
+			const RegisterBlockData* rbd = rfd->block_at(bidx);
+			string name = upper_name(rbd->name(rfd));
+			const BlockPos& pos = names.at(name);
+
+			if (pos.file != fidx || pos.block != bidx)
+				continue;
+
+			m_shadowed[fidx][bidx] = false;
+			m_block_names.emplace(std::move(name), m_blocks.size());
+			m_blocks.push_back({ rfd, rbd });
+		}
+	}
+}
+
+const RegisterBlockRef* RegisterFileSet::find_block(string_view name) const
+{
+	auto it = m_block_names.find(upper_name(name));
+	if (it == m_block_names.end())
+		return nullptr;
+
+	return &m_blocks[it->second];
+}
+
+void RegisterFileSet::build_address_index() const
+{
+	for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+		const RegisterBlockRef& rb = m_blocks[i];
+
+		for (uint32_t ridx = 0; ridx < rb.rbd->num_regs(); ++ridx) {
+			const RegisterData* rd = rb.rbd->register_at(rb.rfd, ridx);
+
+			auto [it, inserted] = m_addresses.try_emplace(rb.rbd->offset() + rd->offset(),
+								      AddressEntry{ i, rd });
+
+			// Later files shadow earlier ones, within a file the first register wins
+			if (!inserted && m_blocks[it->second.block].rfd != rb.rfd)
+				it->second = { i, rd };
+		}
+	}
+}
+
+const RegisterData* RegisterFileSet::find_register(uint64_t address, const RegisterBlockRef** rb) const
+{
+	if (m_addresses.empty())
+		build_address_index();
+
+	auto it = m_addresses.find(address);
+	if (it == m_addresses.end())
+		return nullptr;
+
+	*rb = &m_blocks[it->second.block];
+
+	return it->second.rd;
+}
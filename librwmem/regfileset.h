@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "regs.h"
+
+/// A register block and the register file it belongs to
+struct RegisterBlockRef {
+	const RegisterFileData* rfd;
+	const RegisterBlockData* rbd;
+};
+
+/**
+ * RegisterFileSet - Several register files used as one
+ *
+ * Typically a base SoC register file and overlays for board specific
+ * devices. A block in a later file shadows a block with the same name
+ * (case-insensitively) in the earlier files.
+ *
+ * Block names are hashed when a file is added, so that finding a block is
+ * O(1) regardless of the number of files and blocks. The absolute register
+ * addresses are hashed the first time a register is looked up by address.
+ */
+class RegisterFileSet
+{
+public:
+	RegisterFileSet() = default;
+
+	/// Load a register file on top of the previously added ones
+	void load(const std::string& filename, bool validate = true,
+		  RegisterFileAccess access = RegisterFileAccess::Default);
+	/// Add a register file on top of the previously added ones
+	void add(std::unique_ptr<RegisterFile> regfile);
+
+	bool empty() const { return m_files.empty(); }
+	size_t num_files() const { return m_files.size(); }
+	const RegisterFile& file(size_t idx) const { return *m_files[idx]; }
+
+	/// The blocks that are not shadowed, in file order
+	const std::vector<RegisterBlockRef>& blocks() const { return m_blocks; }
+	/// Is the block 'bidx' of the file 'file_idx' shadowed by a later file
+	bool is_shadowed(size_t file_idx, uint32_t bidx) const { return m_shadowed[file_idx][bidx]; }
+
+	/// Find block with the given name
+	const RegisterBlockRef* find_block(std::string_view name) const;
+	/// Find register at the given absolute address
+	const RegisterData* find_register(uint64_t address, const RegisterBlockRef** rb) const;
+
+private:
+	std::vector<std::unique_ptr<RegisterFile>> m_files;
+	std::vector<std::vector<bool>> m_shadowed;
+
+	std::vector<RegisterBlockRef> m_blocks;
+	// Upper case block name -> index to m_blocks
+	std::unordered_map<std::string, uint32_t> m_block_names;
+
+	struct AddressEntry {
+		uint32_t block;
+		const RegisterData* rd;
+	};
+
+	// Absolute register address -> register, built on first use
+	mutable std::unordered_map<uint64_t, AddressEntry> m_addresses;
+
+	void build_address_index() const;
+};
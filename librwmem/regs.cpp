@@ -6,6 +6,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <format>
 
 #include "regs.h"
@@ -72,27 +73,76 @@ unique_ptr<Register> RegisterBlock::get_register(const string& name) const
 	return make_unique<Register>(m_rfd, m_rbd, rd);
 }
 
-RegisterFile::RegisterFile(const std::string& filename)
+RegisterFile::RegisterFile(const std::string& filename, bool validate, RegisterFileAccess access)
 {
 	int fd = open(filename.c_str(), O_RDONLY);
 	if (fd < 0)
 		throw runtime_error(std::format("Open regfile '{}' failed: {}", filename, strerror(errno)));
 
-	off_t len = lseek(fd, (size_t)0, SEEK_END);
-	lseek(fd, 0, SEEK_SET);
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int err = errno;
+		close(fd);
+		throw runtime_error(std::format("Stat regfile '{}' failed: {}", filename, strerror(err)));
+	}
+
+	const size_t len = st.st_size;
+
+	if (len < sizeof(RegisterFileData)) {
+		close(fd);
+		throw runtime_error(std::format("Regfile '{}' too small: {} bytes", filename, len));
+	}
+
+	int flags = MAP_PRIVATE;
+	if (access == RegisterFileAccess::Populate)
+		flags |= MAP_POPULATE;
+
+	void* mmap_data = mmap(nullptr, len, PROT_READ, flags, fd, 0);
+	int mmap_err = errno;
+
+	// The mapping keeps the file referenced
+	close(fd);
 
-	const void* mmap_data = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
 	if (mmap_data == MAP_FAILED)
-		throw runtime_error(std::format("mmap regfile failed: {}", strerror(errno)));
+		throw runtime_error(std::format("mmap regfile failed: {}", strerror(mmap_err)));
+
+	// The advice is only a hint, so errors are ignored
+	switch (access) {
+	case RegisterFileAccess::Random:
+		madvise(mmap_data, len, MADV_RANDOM);
+		break;
+	case RegisterFileAccess::Sequential:
+		madvise(mmap_data, len, MADV_SEQUENTIAL);
+		break;
+	case RegisterFileAccess::Hugepage:
+		// Needs CONFIG_READ_ONLY_THP_FOR_FS for file mappings
+		madvise(mmap_data, len, MADV_HUGEPAGE);
+#ifdef MADV_POPULATE_READ
+		if (madvise(mmap_data, len, MADV_POPULATE_READ) == 0)
+			break;
+#endif
+		madvise(mmap_data, len, MADV_WILLNEED);
+		break;
+	default:
+		break;
+	}
 
 	m_rfd = static_cast<const RegisterFileData*>(mmap_data);
 	m_size = len;
 
-	if (m_rfd->magic() != RWMEM_MAGIC)
-		throw runtime_error("Bad registerfile magic number");
+	try {
+		if (m_rfd->magic() != RWMEM_MAGIC)
+			throw runtime_error("Bad registerfile magic number");
 
-	if (m_rfd->version() != RWMEM_VERSION)
-		throw runtime_error("Bad registerfile version");
+		if (m_rfd->version() != RWMEM_VERSION)
+			throw runtime_error("Bad registerfile version");
+
+		if (validate)
+			m_rfd->validate(m_size);
+	} catch (...) {
+		munmap(mmap_data, m_size);
+		throw;
+	}
 }
 
 RegisterFile::~RegisterFile()
@@ -74,10 +74,23 @@ private:
 	const RegisterBlockData* m_rbd;
 };
 
+/// How the register file is going to be accessed, used to tune the mapping
+enum class RegisterFileAccess {
+	Default,	// Fault pages in on demand
+	Random,		// A few point lookups, no readahead (MADV_RANDOM)
+	Sequential,	// Scan through the whole file (MADV_SEQUENTIAL)
+	Populate,	// Read the whole file in when mapping (MAP_POPULATE)
+	Hugepage,	// Like Populate, but ask for transparent hugepages (MADV_HUGEPAGE)
+};
+
 class RegisterFile
 {
 public:
-	explicit RegisterFile(const std::string& filename);
+	/// Map the register file. The contents are checked once with
+	/// RegisterFileData::validate() unless validate is false, which can be
+	/// used to skip the O(n) pass for trusted files.
+	explicit RegisterFile(const std::string& filename, bool validate = true,
+			      RegisterFileAccess access = RegisterFileAccess::Default);
 	~RegisterFile();
 
 	const char* name() const { return m_rfd->name(); }
@@ -92,6 +105,7 @@ public:
 	std::unique_ptr<Register> find_register(uint64_t offset) const;
 
 	const RegisterFileData* data() const { return m_rfd; }
+	size_t size() const { return m_size; }
 
 private:
 	const RegisterFileData* m_rfd;
@@ -0,0 +1,882 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include <fnmatch.h>
+#include <strings.h>
+#include <time.h>
+
+#include "filetarget.h"
+#include "i2ctarget.h"
+#include "mmaptarget.h"
+#include "session.h"
+#include "utils.h"
+
+using namespace std;
+
+// Bytes read at a time by the numeric reads of file targets
+static const size_t file_read_batch = 4096;
+
+template<typename... Args>
+static void throw_on(bool condition, std::format_string<Args...> format_str, Args&&... args)
+{
+	if (condition)
+		throw runtime_error(std::format(format_str, std::forward<Args>(args)...));
+}
+
+// Append the registers of the block matching the pattern to 'matches'
+static void match_registers(const RegisterFileData* rfd, const RegisterBlockData* rbd, const string& pattern,
+			    vector<const RegisterData*>& matches)
+{
+	for (unsigned ridx = 0; ridx < rbd->num_regs(); ++ridx) {
+		const RegisterData* rd = rbd->register_at(rfd, ridx);
+
+		if (fnmatch(pattern.c_str(), rd->name(rfd), FNM_CASEFOLD) != 0)
+			continue;
+
+		matches.push_back(rd);
+	}
+}
+
+RwmemOptsArg parse_op_arg(string_view str)
+{
+	RwmemOptsArg arg;
+	size_t idx;
+
+	// extract value
+
+	idx = str.find('=');
+
+	if (idx != string_view::npos) {
+		arg.value = str.substr(idx + 1);
+		str = str.substr(0, idx);
+
+		if (arg.value.empty())
+			throw runtime_error("Empty value not allowed");
+	}
+
+	// extract field
+
+	idx = str.find(':');
+
+	if (idx != string_view::npos) {
+		arg.field = str.substr(idx + 1);
+		str = str.substr(0, idx);
+
+		if (arg.field.empty())
+			throw runtime_error("Empty field not allowed");
+	}
+
+	// extract len
+
+	idx = str.find('+');
+
+	if (idx != string_view::npos) {
+		arg.range = str.substr(idx + 1);
+		arg.range_is_offset = true;
+		str = str.substr(0, idx);
+
+		if (arg.range.empty())
+			throw runtime_error("Empty range not allowed");
+	} else {
+		// extract end
+
+		idx = str.find('-');
+
+		if (idx != string_view::npos) {
+			arg.range = str.substr(idx + 1);
+			arg.range_is_offset = false;
+			str = str.substr(0, idx);
+
+			if (arg.range.empty())
+				throw runtime_error("Empty range not allowed");
+		}
+	}
+
+	arg.address = str;
+
+	if (arg.address.empty())
+		throw runtime_error("Empty address not allowed");
+
+	return arg;
+}
+
+// Parse a "high:low" bit range
+static bool parse_bit_range(string_view str, unsigned* high, unsigned* low)
+{
+	size_t idx = str.find(':');
+
+	if (idx == string_view::npos)
+		return false;
+
+	const char* end = str.data() + str.size();
+
+	auto [p, ec] = from_chars(str.data(), str.data() + idx, *high);
+	if (ec != errc() || p != str.data() + idx)
+		return false;
+
+	auto [p2, ec2] = from_chars(str.data() + idx + 1, end, *low);
+	return ec2 == errc() && p2 == end;
+}
+
+span<const RegisterData* const> RegisterListArena::store(span<const RegisterData* const> regs)
+{
+	while (m_chunk_idx < m_chunks.size()) {
+		Chunk& chunk = m_chunks[m_chunk_idx];
+
+		if (chunk.size - m_chunk_used >= regs.size()) {
+			const RegisterData** dst = chunk.data.get() + m_chunk_used;
+			copy(regs.begin(), regs.end(), dst);
+			m_chunk_used += regs.size();
+			return { dst, regs.size() };
+		}
+
+		m_chunk_idx++;
+		m_chunk_used = 0;
+	}
+
+	// Long lists get a chunk of their own
+	size_t size = max(regs.size(), chunk_size);
+
+	m_chunks.push_back({ make_unique<const RegisterData*[]>(size), size });
+	m_chunk_idx = m_chunks.size() - 1;
+	m_chunk_used = 0;
+
+	return store(regs);
+}
+
+void RegisterListArena::reset()
+{
+	m_chunk_idx = 0;
+	m_chunk_used = 0;
+}
+
+RwmemSession::RwmemSession(const RwmemSessionOptions& opts)
+	: m_opts(opts)
+{
+}
+
+RwmemSession::RwmemSession(const RwmemSessionOptions& opts, unique_ptr<ITarget> target)
+	: m_opts(opts), m_target(std::move(target)), m_mmap(dynamic_cast<MMapTarget*>(m_target.get())),
+	  m_file(dynamic_cast<FileTarget*>(m_target.get()))
+{
+}
+
+RwmemSession::~RwmemSession()
+{
+}
+
+void RwmemSession::load_regfile(const string& filename, bool validate, RegisterFileAccess access)
+{
+	m_regfiles.load(filename, validate, access);
+}
+
+ITarget* RwmemSession::target()
+{
+	if (m_target)
+		return m_target.get();
+
+	switch (m_opts.target_type) {
+	case TargetType::MMap: {
+		auto mmap = make_unique<MMapTarget>(m_opts.mmap_target.empty() ? "/dev/mem" : m_opts.mmap_target);
+		if (m_opts.user_map_window)
+			mmap->set_window_size(m_opts.map_window);
+		m_mmap = mmap.get();
+		m_target = std::move(mmap);
+		break;
+	}
+
+	case TargetType::I2C:
+		m_target = make_unique<I2CTarget>(m_opts.i2c_bus, m_opts.i2c_addr);
+		break;
+
+	case TargetType::File: {
+		auto file = make_unique<FileTarget>(m_opts.file_target, m_opts.file_io_uring);
+		m_file = file.get();
+		m_target = std::move(file);
+		break;
+	}
+
+	default:
+		throw runtime_error("No target");
+	}
+
+	return m_target.get();
+}
+
+MMapTarget* RwmemSession::mmap_target()
+{
+	target();
+
+	return m_mmap;
+}
+
+MapType RwmemSession::map_type(const RegisterBlockData* rbd, const RegisterFileData* rfd) const
+{
+	if (m_opts.user_map_type || !rbd)
+		return m_opts.map_type;
+
+	for (const auto& [name, type] : m_opts.block_map_types) {
+		if (strcasecmp(name.c_str(), rbd->name(rfd)) == 0)
+			return type;
+	}
+
+	return m_opts.map_type;
+}
+
+void RwmemSession::map(const RwmemMapping& mapping)
+{
+	ITarget* mm = target();
+
+	if (m_mmap)
+		m_mmap->set_map_type(mapping.type);
+
+	mm->map(mapping.offset, mapping.length, mapping.addr_endianness, mapping.addr_size,
+		mapping.data_endianness, mapping.data_size, mapping.mode);
+}
+
+RwmemOp RwmemSession::parse_op(string_view str)
+{
+	return parse_op(parse_op_arg(str));
+}
+
+void RwmemSession::clear_ops()
+{
+	m_op_regs.reset();
+}
+
+RwmemOp RwmemSession::parse_op(const RwmemOptsArg& arg)
+{
+	const RegisterFileSet& regfiles = m_regfiles;
+
+	RwmemOp op{};
+
+	/* Parse address */
+
+	// first register from the match
+	const RegisterData* rd = nullptr;
+
+	if (parse_u64(arg.address, &op.reg_offset) != 0) {
+		throw_on(regfiles.empty(), "Invalid address '{}'", arg.address);
+
+		// "BLOCK.REG" or "REG"
+		size_t dot = arg.address.find('.');
+		string_view block_name = arg.address.substr(0, dot);
+		string_view reg_name = dot != string_view::npos ? arg.address.substr(dot + 1) : string_view();
+
+		throw_on(dot != string_view::npos && reg_name.find('.') != string_view::npos,
+			 "Invalid address '{}'", arg.address);
+
+		m_matches.clear();
+
+		// First try with block_name meaning the reg block, if that fails
+		// search all regblocks for the block_name register.
+		if (const RegisterBlockRef* rb = regfiles.find_block(block_name)) {
+			op.rfd = rb->rfd;
+			op.rbd = rb->rbd;
+
+			if (dot != string_view::npos) {
+				match_registers(op.rfd, op.rbd, string(reg_name), m_matches);
+				throw_on(m_matches.empty(), "Failed to find register");
+				rd = m_matches[0];
+			} else {
+				rd = op.rbd->register_at(op.rfd, 0);
+				throw_on(!rd, "Failed to figure out first register");
+			}
+		} else if (dot == string_view::npos) {
+			const string pattern(block_name);
+
+			for (const RegisterBlockRef& rb : regfiles.blocks()) {
+				match_registers(rb.rfd, rb.rbd, pattern, m_matches);
+				if (!m_matches.empty()) {
+					op.rfd = rb.rfd;
+					op.rbd = rb.rbd;
+					break;
+				}
+			}
+
+			throw_on(m_matches.empty(), "Failed to find reg by search");
+
+			rd = m_matches[0];
+			throw_on(!rd, "Failed to figure out first register");
+		} else {
+			throw runtime_error("Failed to find register block or register");
+		}
+
+		if (!m_matches.empty())
+			op.rds = m_op_regs.store(m_matches);
+	}
+
+	uint8_t reg_data_size;
+	if (rd && op.rbd)
+		reg_data_size = rd->effective_data_size(op.rbd);
+	else if (op.rbd)
+		reg_data_size = op.rbd->data_size();
+	else
+		reg_data_size = m_opts.data_size;
+
+	/* Parse range */
+
+	if (arg.range.size()) {
+		int r = parse_u64(arg.range, &op.range);
+		throw_on(r, "Invalid range '{}'", arg.range);
+
+		if (!arg.range_is_offset) {
+			throw_on(op.range <= op.reg_offset, "range '{}' is <= 0", arg.range);
+
+			op.range = op.range - op.reg_offset;
+		}
+	} else {
+		op.range = reg_data_size;
+	}
+
+	/* Parse field */
+
+	if (arg.field.size()) {
+		unsigned fl = 0, fh = 0;
+		uint64_t bit;
+
+		bool ok = false;
+
+		if (parse_bit_range(arg.field, &fh, &fl))
+			ok = true;
+
+		if (!ok && parse_u64(arg.field, &bit) == 0) {
+			// Anything over 63 fails the size check below
+			fl = fh = (unsigned)min<uint64_t>(bit, 64);
+			ok = true;
+		}
+
+		if (!ok && rd) {
+			const FieldData* fd = rd->find_field(op.rfd, string(arg.field));
+			if (fd) {
+				fl = fd->low();
+				fh = fd->high();
+				ok = true;
+			}
+		}
+
+		throw_on(!ok, "Field not found '{}'", arg.field);
+
+		throw_on(fl >= reg_data_size * 8u || fh >= reg_data_size * 8u,
+			 "Field bits higher than register size");
+
+		op.custom_field = true;
+		op.low = fl;
+		op.high = fh;
+	} else {
+		op.custom_field = false;
+		op.low = 0;
+		op.high = reg_data_size * 8 - 1;
+	}
+
+	/* Parse value */
+
+	if (arg.value.size()) {
+		uint64_t value;
+		int r = parse_u64(arg.value, &value);
+		throw_on(r, "Invalid value '{}'", arg.value);
+
+		uint64_t regmask = ~0ULL >> (64 - reg_data_size * 8);
+
+		throw_on(value & ~regmask, "Value does not fit into the register size");
+
+		throw_on(value & ~GENMASK(op.high - op.low, 0),
+			 "Value does not fit into the field");
+
+		op.value = value;
+		op.value_valid = true;
+	}
+
+	return op;
+}
+
+// Access latencies are timed with the raw clock, which NTP does not adjust
+static uint64_t monotonic_raw_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Read, and write if the op has a value, a single register
+void RwmemSession::access(const RwmemOp& op, RwmemAccess& a, uint64_t addr, Endianness data_endianness,
+			  RwmemObserver& observer)
+{
+	ITarget* mm = m_target.get();
+
+	// The clock is read only when timing, to keep the overhead out otherwise
+	auto read = [&](Endianness endianness, uint64_t* ns) {
+		if (!m_opts.time_accesses)
+			return mm->read(addr, a.data_size, endianness);
+
+		uint64_t start = monotonic_raw_ns();
+		uint64_t v = mm->read(addr, a.data_size, endianness);
+		*ns = monotonic_raw_ns() - start;
+		return v;
+	};
+
+	observer.access_begin(a);
+
+	if (m_opts.raw) {
+		a.old_value = a.new_value = read(Endianness::Default, &a.read_ns);
+		a.read = true;
+
+		observer.access_end(a);
+		return;
+	}
+
+	if (m_opts.write_mode != WriteMode::Write) {
+		a.old_value = read(data_endianness, &a.read_ns);
+		a.read = true;
+		a.new_value = a.old_value;
+	}
+
+	if (op.value_valid) {
+		uint64_t v;
+
+		v = a.old_value;
+		v &= ~GENMASK(op.high, op.low);
+		v |= op.value << op.low;
+
+		a.written_value = v;
+
+		observer.access_write(a);
+
+		if (m_opts.time_accesses) {
+			uint64_t start = monotonic_raw_ns();
+			mm->write(addr, v, a.data_size, data_endianness);
+			a.write_ns = monotonic_raw_ns() - start;
+		} else {
+			mm->write(addr, v, a.data_size, data_endianness);
+		}
+
+		a.written = true;
+		a.new_value = v;
+
+		if (m_opts.write_mode == WriteMode::ReadWriteRead) {
+			a.new_value = read(data_endianness, &a.read_back_ns);
+			a.read_back = true;
+		}
+	}
+
+	observer.access_end(a);
+}
+
+void RwmemSession::execute_numeric(const RwmemOp& op, RwmemObserver& observer)
+{
+	const uint64_t op_base = op.reg_offset;
+	const uint64_t range = op.range;
+
+	RwmemMapping mapping;
+	mapping.offset = op_base;
+	mapping.length = range;
+	mapping.addr_endianness = m_opts.address_endianness;
+	mapping.addr_size = m_opts.address_size;
+	mapping.data_endianness = m_opts.data_endianness;
+	mapping.data_size = m_opts.data_size;
+	mapping.mode = op.value_valid ? MapMode::ReadWrite : MapMode::Read;
+	mapping.type = map_type(nullptr, nullptr);
+
+	observer.op_begin(op, mapping);
+
+	map(mapping);
+
+	if (!observer.wants_accesses() && !m_opts.time_accesses && execute_bulk(op, mapping))
+		return;
+
+	if (!m_opts.time_accesses && execute_file_reads(op, mapping, observer))
+		return;
+
+	uint64_t op_offset = 0;
+
+	while (op_offset < range) {
+		RwmemAccess a{};
+		a.op_offset = op_offset;
+		a.address = op_base + op_offset;
+		a.data_size = mapping.data_size;
+
+		access(op, a, a.address, Endianness::Default, observer);
+
+		op_offset += mapping.data_size;
+	}
+}
+
+// Reads of a numeric op from a file target batching with io_uring, a batch
+// of range reads at a time. Returns false if the op can't be done in batches.
+bool RwmemSession::execute_file_reads(const RwmemOp& op, const RwmemMapping& mapping, RwmemObserver& observer)
+{
+	if (!m_file || !m_file->batched() || op.value_valid || op.range % mapping.data_size)
+		return false;
+
+	// No accesses at all
+	if (m_opts.write_mode == WriteMode::Write && !m_opts.raw)
+		return false;
+
+	const uint8_t ds = mapping.data_size;
+	const MMapAccessor acc = select_accessor(ds, mapping.data_endianness);
+	const bool report = observer.wants_accesses();
+
+	uint8_t buf[file_read_batch];
+
+	for (uint64_t op_offset = 0; op_offset < op.range;) {
+		uint64_t n = std::min<uint64_t>(op.range - op_offset, sizeof(buf) - sizeof(buf) % ds);
+
+		m_file->read_range(mapping.offset + op_offset, buf, n, ds);
+
+		for (uint64_t off = 0; report && off < n; off += ds) {
+			RwmemAccess a{};
+			a.op_offset = op_offset + off;
+			a.address = mapping.offset + a.op_offset;
+			a.data_size = ds;
+
+			observer.access_begin(a);
+
+			a.old_value = a.new_value = acc.read(buf + off);
+			a.read = true;
+
+			observer.access_end(a);
+		}
+
+		op_offset += n;
+	}
+
+	return true;
+}
+
+// Range writes of a numeric op, with the accesses of access() but without
+// the per-access reporting. Returns false if the op can't be done in bulk.
+bool RwmemSession::execute_bulk(const RwmemOp& op, const RwmemMapping& mapping)
+{
+	if (!m_mmap || !op.value_valid || m_opts.raw || op.range % mapping.data_size)
+		return false;
+
+	const uint64_t base = mapping.offset;
+	const uint64_t range = mapping.length;
+	const uint64_t mask = GENMASK(op.high, op.low);
+	const uint64_t value = op.value << op.low;
+
+	if (mapping.type == MapType::Uncached) {
+		// The accessor loop needs the range mapped at once
+		if (m_mmap->window_len(base, range) < range)
+			return false;
+
+		// Device registers, so keep every read, write and read back
+		const MMapAccessor acc = m_mmap->accessor();
+
+		m_mmap->validate_range(base, range, true);
+
+		for (uint64_t addr = base; addr < base + range; addr += mapping.data_size) {
+			uint64_t v = 0;
+
+			if (m_opts.write_mode != WriteMode::Write)
+				v = m_mmap->read_unchecked(acc, addr);
+
+			m_mmap->write_unchecked(acc, addr, (v & ~mask) | value);
+
+			if (m_opts.write_mode == WriteMode::ReadWriteRead)
+				m_mmap->read_unchecked(acc, addr);
+		}
+
+		return true;
+	}
+
+	// RAM, so the reads have no side effects. Skip the read backs, and the
+	// reads when the whole element is written.
+	const uint64_t elem_mask = GENMASK(mapping.data_size * 8 - 1, 0);
+
+	if (m_opts.write_mode == WriteMode::Write || (mask & elem_mask) == elem_mask)
+		m_mmap->fill(base, range, value);
+	else
+		m_mmap->update(base, range, mask, value);
+
+	return true;
+}
+
+void RwmemSession::execute_symbolic(const RwmemOp& op, RwmemObserver& observer)
+{
+	const RegisterFileData* rfd = op.rfd;
+	const RegisterBlockData* rbd = op.rbd;
+
+	const uint64_t rb_base = rbd->offset();
+	const uint64_t rb_access_base = m_opts.ignore_base ? 0 : rbd->offset();
+	const uint64_t range = rbd->size();
+
+	RwmemMapping mapping;
+	mapping.offset = rb_access_base;
+	mapping.length = range;
+
+	if (m_opts.user_address_size) {
+		mapping.addr_endianness = m_opts.address_endianness;
+		mapping.addr_size = m_opts.address_size;
+	} else {
+		mapping.addr_endianness = rbd->addr_endianness();
+		mapping.addr_size = rbd->addr_size();
+	}
+
+	if (m_opts.user_data_size) {
+		mapping.data_endianness = m_opts.data_endianness;
+		mapping.data_size = m_opts.data_size;
+	} else {
+		mapping.data_endianness = rbd->data_endianness();
+		mapping.data_size = rbd->data_size();
+	}
+
+	mapping.mode = op.value_valid ? MapMode::ReadWrite : MapMode::Read;
+	mapping.type = map_type(rbd, rfd);
+
+	observer.op_begin(op, mapping);
+
+	map(mapping);
+
+	auto access_reg = [&](const RegisterData* rd, uint64_t op_offset, uint8_t size) {
+		RwmemAccess a{};
+		a.rfd = rfd;
+		a.rbd = rbd;
+		a.rd = rd;
+		a.op_offset = op_offset;
+		a.address = rb_base + op_offset;
+		a.data_size = size;
+
+		// Accessing addresses not defined in regfile may cause problems. So skip those.
+		if (!rd) {
+			a.skipped = true;
+			observer.access_begin(a);
+			observer.access_end(a);
+			return;
+		}
+
+		access(op, a, rb_access_base + op_offset, rd->effective_data_endianness(rbd), observer);
+	};
+
+	if (op.rds.empty()) {
+		uint64_t op_offset = 0;
+
+		while (op_offset < range) {
+			const RegisterData* rd = rbd->find_register(rfd, op_offset);
+
+			// Step with the register size, or the block default size for gaps
+			uint8_t step_size = rd ? rd->effective_data_size(rbd) : mapping.data_size;
+
+			access_reg(rd, op_offset, step_size);
+
+			op_offset += step_size;
+		}
+	} else {
+		for (const RegisterData* rd : op.rds)
+			access_reg(rd, rd->offset(), rd->effective_data_size(rbd));
+	}
+}
+
+void RwmemSession::execute(const RwmemOp& op, RwmemObserver& observer)
+{
+	if (op.rbd)
+		execute_symbolic(op, observer);
+	else
+		execute_numeric(op, observer);
+}
+
+RwmemOpResult RwmemSession::execute(const RwmemOp& op)
+{
+	class Collector : public RwmemObserver
+	{
+	public:
+		explicit Collector(RwmemOpResult& result) : m_result(result) {}
+
+		void op_begin(const RwmemOp& op, const RwmemMapping& mapping) override { m_result.mapping = mapping; }
+		void access_end(const RwmemAccess& access) override { m_result.accesses.push_back(access); }
+
+	private:
+		RwmemOpResult& m_result;
+	};
+
+	RwmemOpResult result;
+	Collector collector(result);
+
+	execute(op, collector);
+
+	return result;
+}
+
+size_t RwmemSession::estimate_accesses(const RwmemOp& op) const
+{
+	if (!op.rbd)
+		return op.range / m_opts.data_size + 1;
+
+	if (!op.rds.empty())
+		return op.rds.size();
+
+	return op.rbd->size() / op.rbd->data_size() + 1;
+}
+
+RwmemCapture RwmemSession::capture(span<const RwmemOp> ops)
+{
+	class Capturer : public RwmemObserver
+	{
+	public:
+		explicit Capturer(RwmemCapture& capture) : m_capture(capture) {}
+
+		void op_begin(const RwmemOp& op, const RwmemMapping& mapping) override
+		{
+			m_capture.ops.push_back({ mapping, m_capture.accesses.size(), 0 });
+		}
+
+		void access_end(const RwmemAccess& access) override
+		{
+			m_capture.accesses.push_back(access);
+			m_capture.ops.back().num_accesses++;
+		}
+
+	private:
+		RwmemCapture& m_capture;
+	};
+
+	RwmemCapture capture;
+
+	size_t num_accesses = 0;
+	for (const RwmemOp& op : ops)
+		num_accesses += estimate_accesses(op);
+
+	// Allocate up front, to keep the accesses close together
+	capture.ops.reserve(ops.size());
+	capture.accesses.reserve(num_accesses);
+
+	Capturer capturer(capture);
+
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	capture.time_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+	uint64_t start = monotonic_raw_ns();
+
+	for (const RwmemOp& op : ops)
+		execute(op, capturer);
+
+	capture.duration_ns = monotonic_raw_ns() - start;
+
+	return capture;
+}
+
+void replay_capture(span<const RwmemOp> ops, const RwmemCapture& capture, RwmemObserver& observer)
+{
+	for (size_t i = 0; i < capture.ops.size(); ++i) {
+		const RwmemCapture::Op& cop = capture.ops[i];
+
+		observer.op_begin(ops[i], cop.mapping);
+
+		for (size_t j = cop.first_access; j < cop.first_access + cop.num_accesses; ++j) {
+			const RwmemAccess& a = capture.accesses[j];
+
+			observer.access_begin(a);
+
+			if (a.written)
+				observer.access_write(a);
+
+			observer.access_end(a);
+		}
+	}
+}
+
+RwmemMapping RwmemSession::map_range(const RwmemOp& op, uint64_t length, MapMode mode)
+{
+	RwmemMapping mapping;
+
+	if (op.rbd) {
+		throw_on(!op.rds.empty(), "Only numeric ranges and whole register blocks can be transferred");
+		throw_on(length > op.rbd->size(), "Length {:#x} is over the register block size {:#x}", length,
+			 op.rbd->size());
+
+		mapping.offset = m_opts.ignore_base ? 0 : op.rbd->offset();
+		mapping.length = length ? length : op.rbd->size();
+		mapping.addr_endianness = m_opts.user_address_size ? m_opts.address_endianness :
+								     op.rbd->addr_endianness();
+		mapping.addr_size = m_opts.user_address_size ? m_opts.address_size : op.rbd->addr_size();
+		mapping.data_size = m_opts.user_data_size ? m_opts.data_size : op.rbd->data_size();
+	} else {
+		mapping.offset = op.reg_offset;
+		mapping.length = length ? length : op.range;
+		mapping.addr_endianness = m_opts.address_endianness;
+		mapping.addr_size = m_opts.address_size;
+		mapping.data_size = m_opts.data_size;
+	}
+
+	throw_on(mapping.length % mapping.data_size, "Length {:#x} is not a multiple of the data size {}",
+		 mapping.length, mapping.data_size);
+
+	mapping.data_endianness = Endianness::Little;
+	mapping.mode = mode;
+	mapping.type = map_type(op.rbd, op.rfd);
+
+	map(mapping);
+
+	m_range = mapping;
+
+	return mapping;
+}
+
+static void store_le(uint8_t* p, uint64_t v, uint8_t nbytes)
+{
+	if constexpr (std::endian::native == std::endian::little) {
+		memcpy(p, &v, nbytes);
+	} else {
+		for (unsigned i = 0; i < nbytes; ++i)
+			p[i] = v >> (i * 8);
+	}
+}
+
+static uint64_t load_le(const uint8_t* p, uint8_t nbytes)
+{
+	uint64_t v = 0;
+
+	if constexpr (std::endian::native == std::endian::little) {
+		memcpy(&v, p, nbytes);
+	} else {
+		for (unsigned i = 0; i < nbytes; ++i)
+			v |= (uint64_t)p[i] << (i * 8);
+	}
+
+	return v;
+}
+
+void RwmemSession::read_range(uint64_t addr, void* buf, uint64_t len)
+{
+	const uint8_t ds = m_range.data_size;
+	uint8_t* p = static_cast<uint8_t*>(buf);
+
+	throw_on(!ds || len % ds, "Length {:#x} is not a multiple of the data size {}", len, ds);
+
+	if (m_mmap) {
+		m_mmap->read_elements(addr, len / ds, ds, Endianness::Default,
+				      [p, ds](uint64_t i, uint64_t v) { store_le(p + i * ds, v, ds); });
+	} else if (m_file) {
+		m_file->read_range(addr, p, len, ds);
+	} else {
+		ITarget* mm = target();
+
+		for (uint64_t off = 0; off < len; off += ds)
+			store_le(p + off, mm->read(addr + off, ds, Endianness::Little), ds);
+	}
+}
+
+void RwmemSession::write_range(uint64_t addr, const void* buf, uint64_t len)
+{
+	const uint8_t ds = m_range.data_size;
+	const uint8_t* p = static_cast<const uint8_t*>(buf);
+
+	throw_on(!ds || len % ds, "Length {:#x} is not a multiple of the data size {}", len, ds);
+
+	if (m_mmap) {
+		m_mmap->write_elements(addr, len / ds, ds, Endianness::Default,
+				       [p, ds](uint64_t i) { return load_le(p + i * ds, ds); });
+	} else if (m_file) {
+		m_file->write_range(addr, p, len, ds);
+	} else {
+		ITarget* mm = target();
+
+		for (uint64_t off = 0; off < len; off += ds)
+			mm->write(addr + off, load_le(p + off, ds), ds, Endianness::Little);
+	}
+}
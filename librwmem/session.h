@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "filetarget.h"
+#include "itarget.h"
+#include "mmaptarget.h"
+#include "regfileset.h"
+
+enum class WriteMode {
+	Write,
+	ReadWrite,
+	ReadWriteRead,
+};
+
+enum class TargetType {
+	None,
+	MMap,
+	I2C,
+	File,
+};
+
+/// An op as given by the user, e.g. "BLOCK.REG:FIELD=value" split into parts.
+/// The parts refer to the op string.
+struct RwmemOptsArg {
+	std::string_view address;
+	bool range_is_offset = false;
+	std::string_view range;
+	std::string_view field;
+	std::string_view value;
+};
+
+/// An op resolved against the register files
+struct RwmemOp {
+	const RegisterFileData* rfd;
+	const RegisterBlockData* rbd;
+	/// The matched registers, owned by the session that parsed the op
+	std::span<const RegisterData* const> rds;
+
+	uint64_t reg_offset;
+
+	uint64_t range;
+
+	bool custom_field;
+	unsigned low, high;
+
+	bool value_valid;
+	uint64_t value;
+};
+
+/// How an op maps the target
+struct RwmemMapping {
+	uint64_t offset;
+	uint64_t length;
+	Endianness addr_endianness;
+	uint8_t addr_size;
+	Endianness data_endianness;
+	uint8_t data_size;
+	MapMode mode;
+	/// Only used for mmap targets
+	MapType type;
+};
+
+/// A single register access done by an op
+struct RwmemAccess {
+	// The register, if the op is symbolic and the address has one
+	const RegisterFileData* rfd;
+	const RegisterBlockData* rbd;
+	const RegisterData* rd;
+
+	/// Offset from the start of the op, or of the block for symbolic ops
+	uint64_t op_offset;
+	/// Address including the block base, for showing to the user
+	uint64_t address;
+	/// Access size in bytes
+	uint8_t data_size;
+
+	/// Not accessed, as there is no register at the address
+	bool skipped;
+
+	bool read;
+	uint64_t old_value;
+
+	bool written;
+	uint64_t written_value;
+
+	bool read_back;
+	uint64_t new_value;
+
+	/// Durations of the target accesses in ns, if time_accesses is set
+	uint64_t read_ns;
+	uint64_t write_ns;
+	uint64_t read_back_ns;
+};
+
+/**
+ * RwmemObserver - Progress of executing an op
+ *
+ * The callbacks are called in order while the op is executed, so that the
+ * user can be shown what is being done before something like a bus hang.
+ */
+class RwmemObserver
+{
+public:
+	virtual ~RwmemObserver() {}
+
+	/// Whether the access callbacks are needed. If not, numeric range writes
+	/// to mmap targets are done in bulk, without calling them.
+	virtual bool wants_accesses() const { return true; }
+
+	/// Before mapping the target for the op
+	virtual void op_begin(const RwmemOp& op, const RwmemMapping& mapping) {}
+	/// Before accessing the target, with only the address fields set.
+	/// Numeric reads of file targets batching with io_uring are done a
+	/// batch at a time, before the callbacks of the batch.
+	virtual void access_begin(const RwmemAccess& access) {}
+	/// After reading the old value, just before writing
+	virtual void access_write(const RwmemAccess& access) {}
+	/// After the access is done
+	virtual void access_end(const RwmemAccess& access) {}
+};
+
+/**
+ * RegisterListArena - Storage for the register lists of parsed ops
+ *
+ * Lists are bump allocated from chunks which are never moved, so the lists
+ * stay valid until the arena is reset. Reset keeps the chunks for reuse.
+ */
+class RegisterListArena
+{
+public:
+	/// Copy the registers to the arena
+	std::span<const RegisterData* const> store(std::span<const RegisterData* const> regs);
+	/// Forget all the lists
+	void reset();
+
+private:
+	struct Chunk {
+		std::unique_ptr<const RegisterData*[]> data;
+		size_t size;
+	};
+
+	static constexpr size_t chunk_size = 256;
+
+	std::vector<Chunk> m_chunks;
+	size_t m_chunk_idx = 0;
+	size_t m_chunk_used = 0;
+};
+
+struct RwmemOpResult {
+	RwmemMapping mapping;
+	std::vector<RwmemAccess> accesses;
+};
+
+/// The accesses of several ops, captured back-to-back
+struct RwmemCapture {
+	struct Op {
+		RwmemMapping mapping;
+		/// The accesses of the op in 'accesses'
+		size_t first_access;
+		size_t num_accesses;
+	};
+
+	std::vector<Op> ops;
+	std::vector<RwmemAccess> accesses;
+
+	/// When the capture started, CLOCK_REALTIME
+	uint64_t time_ns;
+	/// How long it took, CLOCK_MONOTONIC_RAW
+	uint64_t duration_ns;
+};
+
+struct RwmemSessionOptions {
+	TargetType target_type = TargetType::MMap;
+	std::string mmap_target = "/dev/mem";
+	uint16_t i2c_bus = 0;
+	uint16_t i2c_addr = 0;
+	/// The file to access with pread() and pwrite(), for files that can't
+	/// be mmapped
+	std::string file_target;
+	/// Batch the range accesses of the file target with io_uring
+	bool file_io_uring = false;
+
+	/// Use the address and data sizes below instead of the register file ones
+	bool user_address_size = false;
+	uint8_t address_size = 1; // bytes
+	Endianness address_endianness = Endianness::Little;
+
+	bool user_data_size = false;
+	uint8_t data_size = 4; // bytes
+	Endianness data_endianness = Endianness::Little;
+
+	WriteMode write_mode = WriteMode::ReadWriteRead;
+
+	/// Use map_type instead of the block_map_types entry of the op's block
+	bool user_map_type = false;
+	MapType map_type = MapType::Uncached;
+	/// Mapping types of register blocks, by case-insensitive block name
+	std::vector<std::pair<std::string, MapType>> block_map_types;
+
+	/// Use map_window as the MMapTarget window size instead of its default,
+	/// 0 mapping whole ranges
+	bool user_map_window = false;
+	uint64_t map_window = 0;
+
+	/// Only read, ignoring the op values, with the data endianness of the
+	/// mapping, i.e. the values are the memory contents
+	bool raw = false;
+
+	/// Access the blocks at offset 0 instead of their base address
+	bool ignore_base = false;
+
+	/// Time every target access, with CLOCK_MONOTONIC_RAW. Ops are then not
+	/// done in bulk.
+	bool time_accesses = false;
+};
+
+/**
+ * RwmemSession - Parses and executes rwmem ops
+ *
+ * A session has its own options, register files and target, so several
+ * sessions can be used independently, e.g. one per thread. A single session
+ * is not thread safe.
+ *
+ * Errors are reported by throwing runtime_error.
+ */
+class RwmemSession
+{
+public:
+	explicit RwmemSession(const RwmemSessionOptions& opts);
+	/// Use the given target instead of opening one based on the options
+	RwmemSession(const RwmemSessionOptions& opts, std::unique_ptr<ITarget> target);
+	~RwmemSession();
+
+	const RwmemSessionOptions& options() const { return m_opts; }
+
+	/// The mmap target, opening it if needed, or nullptr for other targets
+	MMapTarget* mmap_target();
+
+	/// Load a register file on top of the previously loaded ones
+	void load_regfile(const std::string& filename, bool validate = true,
+			  RegisterFileAccess access = RegisterFileAccess::Default);
+	const RegisterFileSet& regfiles() const { return m_regfiles; }
+
+	/// Resolve an op against the loaded register files. The op is valid
+	/// until clear_ops() is called or the session is destroyed.
+	RwmemOp parse_op(const RwmemOptsArg& arg);
+	/// Resolve an op string, e.g. "BLOCK.REG:FIELD=value"
+	RwmemOp parse_op(std::string_view str);
+	/// Free the memory used by the ops parsed so far, invalidating them
+	void clear_ops();
+
+	/// Execute the op, reporting the progress to the observer
+	void execute(const RwmemOp& op, RwmemObserver& observer);
+	/// Execute the op, returning all the accesses
+	RwmemOpResult execute(const RwmemOp& op);
+
+	/// An upper estimate of the number of accesses of the op, for
+	/// reserving space
+	size_t estimate_accesses(const RwmemOp& op) const;
+
+	/// Execute the ops back-to-back, without reporting the accesses until
+	/// all are done, for a coherent snapshot of the registers
+	RwmemCapture capture(std::span<const RwmemOp> ops);
+
+	/*
+	 * Bulk transfers of memory contents, e.g. for loading firmware.
+	 * map_range() maps the range of a numeric op, or a whole register block,
+	 * with a nonzero length overriding the op's length. read_range() and
+	 * write_range() then copy between the mapping and a buffer with
+	 * accesses of the mapping data size. The values are stored little
+	 * endian in the buffer, so it has the bytes as they are in memory.
+	 * File targets can batch the accesses, see FileTarget.
+	 */
+	RwmemMapping map_range(const RwmemOp& op, uint64_t length, MapMode mode);
+	void read_range(uint64_t addr, void* buf, uint64_t len);
+	void write_range(uint64_t addr, const void* buf, uint64_t len);
+
+private:
+	RwmemSessionOptions m_opts;
+	RegisterFileSet m_regfiles;
+	// Opened on first use
+	std::unique_ptr<ITarget> m_target;
+	// m_target, if it is an mmap target
+	MMapTarget* m_mmap = nullptr;
+	// m_target, if it is a file target
+	FileTarget* m_file = nullptr;
+
+	RegisterListArena m_op_regs;
+	// Reused for matching the registers of an op
+	std::vector<const RegisterData*> m_matches;
+
+	// The last map_range() mapping
+	RwmemMapping m_range{};
+
+	ITarget* target();
+	MapType map_type(const RegisterBlockData* rbd, const RegisterFileData* rfd) const;
+	void map(const RwmemMapping& mapping);
+
+	void execute_numeric(const RwmemOp& op, RwmemObserver& observer);
+	bool execute_bulk(const RwmemOp& op, const RwmemMapping& mapping);
+	bool execute_file_reads(const RwmemOp& op, const RwmemMapping& mapping, RwmemObserver& observer);
+	void execute_symbolic(const RwmemOp& op, RwmemObserver& observer);
+	void access(const RwmemOp& op, RwmemAccess& a, uint64_t addr, Endianness data_endianness,
+		    RwmemObserver& observer);
+};
+
+/// Report the captured accesses of the ops to the observer, in the order
+/// execute() would have reported them
+void replay_capture(std::span<const RwmemOp> ops, const RwmemCapture& capture, RwmemObserver& observer);
+
+/// Split an op string, e.g. "BLOCK.REG:FIELD=value", into its parts
+RwmemOptsArg parse_op_arg(std::string_view str);
@@ -0,0 +1,46 @@
+#include <cerrno>
+#include <charconv>
+#include <sstream>
+
+#include "utils.h"
+
+using namespace std;
+
+void split(const string& s, char delim, vector<string>& elems)
+{
+	stringstream ss(s);
+	string item;
+
+	while (getline(ss, item, delim))
+		elems.push_back(item);
+}
+
+vector<string> split(const string& s, char delim)
+{
+	vector<string> elems;
+	split(s, delim, elems);
+	return elems;
+}
+
+int parse_u64(string_view str, uint64_t* value)
+{
+	int base = 10;
+
+	if (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+		base = 16;
+		str.remove_prefix(2);
+	} else if (str.size() > 1 && str[0] == '0') {
+		base = 8;
+		str.remove_prefix(1);
+	}
+
+	const char* end = str.data() + str.size();
+	uint64_t v;
+
+	auto [p, ec] = from_chars(str.data(), end, v, base);
+	if (ec != errc() || p != end)
+		return -EINVAL;
+
+	*value = v;
+	return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define GENMASK(h, l) (((~0ULL) << (l)) & (~0ULL >> (64 - 1 - (h))))
+
+void split(const std::string& s, char delim, std::vector<std::string>& elems);
+std::vector<std::string> split(const std::string& s, char delim);
+
+/// Parse a whole string as a hex (0x prefix), octal (0 prefix) or decimal
+/// number. Returns -EINVAL if the string is not a number or it overflows.
+int parse_u64(std::string_view str, uint64_t* value);
@@ -0,0 +1,825 @@
+// Optional native accelerator for the rwmem Python package, built on librwmem.
+//
+// The pure Python classes in py/rwmem use this module when it is available.
+// It only provides the hot paths: register accesses through MMapTarget, and
+// name and index lookups in the register file. Everything else stays in
+// Python.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "mmaptarget.h"
+#include "regfiledata.h"
+
+using namespace std;
+
+// Fast call argument parsing: fill 'slots' from positional args and keyword
+// names. Missing args are left as nullptr.
+static bool parse_fastcall_args(const char* func, PyObject* const* args, Py_ssize_t nargs,
+				PyObject* kwnames, const char* const* names, size_t num_names,
+				size_t num_required, PyObject** slots)
+{
+	if ((size_t)nargs > num_names) {
+		PyErr_Format(PyExc_TypeError, "%s() takes at most %zu arguments (%zd given)",
+			     func, num_names, nargs);
+		return false;
+	}
+
+	for (size_t i = 0; i < num_names; ++i)
+		slots[i] = i < (size_t)nargs ? args[i] : nullptr;
+
+	if (kwnames) {
+		Py_ssize_t nkw = PyTuple_GET_SIZE(kwnames);
+
+		for (Py_ssize_t k = 0; k < nkw; ++k) {
+			PyObject* kw = PyTuple_GET_ITEM(kwnames, k);
+			size_t i;
+
+			for (i = 0; i < num_names; ++i) {
+				if (PyUnicode_CompareWithASCIIString(kw, names[i]) == 0)
+					break;
+			}
+
+			if (i == num_names) {
+				PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument '%U'",
+					     func, kw);
+				return false;
+			}
+
+			if (slots[i]) {
+				PyErr_Format(PyExc_TypeError, "%s() got multiple values for argument '%s'",
+					     func, names[i]);
+				return false;
+			}
+
+			slots[i] = args[nargs + k];
+		}
+	}
+
+	for (size_t i = 0; i < num_required; ++i) {
+		if (!slots[i]) {
+			PyErr_Format(PyExc_TypeError, "%s() missing required argument '%s'",
+				     func, names[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Accepts an rwmem.Endianness or a plain int. Returns false on error.
+static bool parse_endianness(PyObject* obj, Endianness* endianness)
+{
+	if (!obj || obj == Py_None) {
+		*endianness = Endianness::Default;
+		return true;
+	}
+
+	long v;
+
+	if (PyLong_Check(obj)) {
+		v = PyLong_AsLong(obj);
+	} else {
+		PyObject* value = PyObject_GetAttrString(obj, "value");
+		if (!value)
+			return false;
+		v = PyLong_AsLong(value);
+		Py_DECREF(value);
+	}
+
+	if (v == -1 && PyErr_Occurred())
+		return false;
+
+	if (v < (long)Endianness::Default || v > (long)Endianness::LittleSwapped) {
+		PyErr_Format(PyExc_ValueError, "Invalid endianness %ld", v);
+		return false;
+	}
+
+	*endianness = (Endianness)v;
+	return true;
+}
+
+// Data size argument: None means the default of the mapping (0)
+static bool parse_data_size(PyObject* obj, uint8_t* data_size)
+{
+	if (!obj || obj == Py_None) {
+		*data_size = 0;
+		return true;
+	}
+
+	long v = PyLong_AsLong(obj);
+	if (v == -1 && PyErr_Occurred())
+		return false;
+
+	if (v <= 0) {
+		PyErr_Format(PyExc_ValueError, "Data size must be positive, got %ld", v);
+		return false;
+	}
+
+	if (v > 8) {
+		PyErr_Format(PyExc_ValueError, "Data size must be at most 8, got %ld", v);
+		return false;
+	}
+
+	*data_size = v;
+	return true;
+}
+
+// Only the defaults are valid for mmap targets
+static bool check_addr_args(PyObject* addr_size, PyObject* addr_endianness)
+{
+	if (addr_size && addr_size != Py_None) {
+		long v = PyLong_AsLong(addr_size);
+		if (v == -1 && PyErr_Occurred())
+			return false;
+
+		if (v != 0) {
+			PyErr_SetString(PyExc_RuntimeError, "Address size must be 0");
+			return false;
+		}
+	}
+
+	Endianness e;
+	if (!parse_endianness(addr_endianness, &e))
+		return false;
+
+	if (e != Endianness::Default) {
+		PyErr_SetString(PyExc_RuntimeError, "Address endianness must be Default");
+		return false;
+	}
+
+	return true;
+}
+
+static bool parse_addr(PyObject* obj, uint64_t* addr)
+{
+	long long v = PyLong_AsLongLong(obj);
+	if (v == -1 && PyErr_Occurred())
+		return false;
+
+	if (v < 0) {
+		PyErr_Format(PyExc_RuntimeError, "Access outside mmap area: %lld", v);
+		return false;
+	}
+
+	*addr = v;
+	return true;
+}
+
+/*
+ * MMapTarget
+ */
+
+struct MMapTargetObject {
+	PyObject_HEAD
+	MMapTarget* target;
+	uint64_t offset;
+	uint64_t length;
+	uint8_t data_size;
+	MapMode mode;
+};
+
+static int MMapTarget_init(MMapTargetObject* self, PyObject* args, PyObject* kwds)
+{
+	static const char* kwlist[] = { "file", "offset", "length", "data_endianness", "data_size", "mode",
+					"window_size", nullptr };
+
+	const char* file;
+	PyObject* offset_obj;
+	PyObject* length_obj;
+	PyObject* data_endianness_obj;
+	int data_size;
+	int mode;
+	PyObject* window_size_obj = nullptr;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "sOOOii|O", const_cast<char**>(kwlist),
+					 &file, &offset_obj, &length_obj, &data_endianness_obj, &data_size, &mode,
+					 &window_size_obj))
+		return -1;
+
+	// Raises OverflowError for negative values, like mmap.mmap()
+	unsigned long long offset = PyLong_AsUnsignedLongLong(offset_obj);
+	if (offset == (unsigned long long)-1 && PyErr_Occurred())
+		return -1;
+
+	unsigned long long length = PyLong_AsUnsignedLongLong(length_obj);
+	if (length == (unsigned long long)-1 && PyErr_Occurred())
+		return -1;
+
+	// None or missing uses the default of the platform
+	unsigned long long window_size = 0;
+	if (window_size_obj && window_size_obj != Py_None) {
+		window_size = PyLong_AsUnsignedLongLong(window_size_obj);
+		if (window_size == (unsigned long long)-1 && PyErr_Occurred())
+			return -1;
+	}
+
+	Endianness data_endianness;
+	if (!parse_endianness(data_endianness_obj, &data_endianness))
+		return -1;
+
+	if (data_size <= 0 || data_size > 8) {
+		PyErr_Format(PyExc_ValueError, "Invalid data size %d", data_size);
+		return -1;
+	}
+
+	if (mode < (int)MapMode::Read || mode > (int)MapMode::ReadWrite) {
+		PyErr_Format(PyExc_ValueError, "Invalid map mode %d", mode);
+		return -1;
+	}
+
+	delete self->target;
+	self->target = nullptr;
+
+	try {
+		auto target = make_unique<MMapTarget>(file);
+		if (window_size_obj && window_size_obj != Py_None)
+			target->set_window_size(window_size);
+		target->map(offset, length, Endianness::Default, 0, data_endianness, data_size, (MapMode)mode);
+		self->target = target.release();
+		self->offset = offset;
+		self->length = length;
+		self->data_size = data_size;
+		self->mode = (MapMode)mode;
+	} catch (const exception& e) {
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return -1;
+	}
+
+	return 0;
+}
+
+static void MMapTarget_dealloc(MMapTargetObject* self)
+{
+	PyTypeObject* type = Py_TYPE(self);
+
+	delete self->target;
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
+}
+
+static bool check_open(MMapTargetObject* self)
+{
+	if (!self->target) {
+		PyErr_SetString(PyExc_ValueError, "mmap closed or invalid");
+		return false;
+	}
+
+	return true;
+}
+
+static bool check_range(MMapTargetObject* self, uint64_t addr, uint64_t len)
+{
+	if (addr < self->offset || len > self->length || addr - self->offset > self->length - len) {
+		PyErr_Format(PyExc_RuntimeError, "Access outside mmap area: %llu-%llu",
+			     (unsigned long long)addr, (unsigned long long)(addr + len));
+		return false;
+	}
+
+	return true;
+}
+
+static PyObject* MMapTarget_read(MMapTargetObject* self, PyObject* const* args, Py_ssize_t nargs,
+				 PyObject* kwnames)
+{
+	static const char* const names[] = { "addr", "data_size", "data_endianness", "addr_size", "addr_endianness" };
+	PyObject* slots[5];
+
+	if (!parse_fastcall_args("read", args, nargs, kwnames, names, 5, 1, slots))
+		return nullptr;
+
+	uint64_t addr;
+	uint8_t data_size;
+	Endianness data_endianness;
+
+	if (!parse_addr(slots[0], &addr) || !parse_data_size(slots[1], &data_size) ||
+	    !parse_endianness(slots[2], &data_endianness) || !check_addr_args(slots[3], slots[4]) ||
+	    !check_open(self))
+		return nullptr;
+
+	uint64_t v;
+
+	try {
+		v = self->target->read(addr, data_size, data_endianness);
+	} catch (const exception& e) {
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return nullptr;
+	}
+
+	return PyLong_FromUnsignedLongLong(v);
+}
+
+static PyObject* MMapTarget_write(MMapTargetObject* self, PyObject* const* args, Py_ssize_t nargs,
+				  PyObject* kwnames)
+{
+	static const char* const names[] = { "addr", "value", "data_size", "data_endianness", "addr_size", "addr_endianness" };
+	PyObject* slots[6];
+
+	if (!parse_fastcall_args("write", args, nargs, kwnames, names, 6, 2, slots))
+		return nullptr;
+
+	uint64_t addr;
+	uint8_t data_size;
+	Endianness data_endianness;
+
+	if (!parse_addr(slots[0], &addr) || !parse_data_size(slots[2], &data_size) ||
+	    !parse_endianness(slots[3], &data_endianness) || !check_addr_args(slots[4], slots[5]) ||
+	    !check_open(self))
+		return nullptr;
+
+	// Raises OverflowError for negative values and values over 64 bits
+	unsigned long long value = PyLong_AsUnsignedLongLong(slots[1]);
+	if (value == (unsigned long long)-1 && PyErr_Occurred())
+		return nullptr;
+
+	const uint8_t nbytes = data_size ? data_size : self->data_size;
+
+	// Check the mode and the range before the value, to raise the same
+	// errors as the pure Python implementation
+
+	if (self->mode == MapMode::Read) {
+		PyErr_SetString(PyExc_RuntimeError, "Trying to write to a read-only mapping");
+		return nullptr;
+	}
+
+	if (!check_range(self, addr, nbytes))
+		return nullptr;
+
+	if (nbytes < 8 && (value >> (nbytes * 8)) != 0) {
+		PyErr_SetString(PyExc_OverflowError, "int too big to convert");
+		return nullptr;
+	}
+
+	try {
+		self->target->write(addr, value, data_size, data_endianness);
+	} catch (const exception& e) {
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return nullptr;
+	}
+
+	Py_RETURN_NONE;
+}
+
+// Arguments of read_into() and write_from(). Returns the element size, or 0 on error.
+static uint8_t parse_array_args(MMapTargetObject* self, PyObject* addr_obj, const Py_buffer& buf,
+				PyObject* data_size_obj, PyObject* data_endianness_obj,
+				uint64_t* addr, Endianness* data_endianness)
+{
+	uint8_t data_size;
+
+	if (!parse_addr(addr_obj, addr) || !parse_data_size(data_size_obj, &data_size) ||
+	    !parse_endianness(data_endianness_obj, data_endianness) || !check_open(self))
+		return 0;
+
+	if (!data_size)
+		data_size = self->data_size;
+
+	if (data_size != 1 && data_size != 2 && data_size != 4 && data_size != 8) {
+		PyErr_Format(PyExc_ValueError, "Array data size must be 1, 2, 4 or 8, got %u", data_size);
+		return 0;
+	}
+
+	if (buf.len % data_size) {
+		PyErr_Format(PyExc_ValueError, "Buffer size %zd is not a multiple of data size %u",
+			     buf.len, data_size);
+		return 0;
+	}
+
+	if (!check_range(self, *addr, buf.len))
+		return 0;
+
+	return data_size;
+}
+
+static PyObject* MMapTarget_read_into(MMapTargetObject* self, PyObject* args, PyObject* kwds)
+{
+	static const char* kwlist[] = { "addr", "buffer", "data_size", "data_endianness", nullptr };
+
+	PyObject* addr_obj;
+	Py_buffer buf;
+	PyObject* data_size_obj = nullptr;
+	PyObject* data_endianness_obj = nullptr;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "Ow*|OO", const_cast<char**>(kwlist),
+					 &addr_obj, &buf, &data_size_obj, &data_endianness_obj))
+		return nullptr;
+
+	uint64_t addr;
+	Endianness data_endianness;
+
+	uint8_t data_size = parse_array_args(self, addr_obj, buf, data_size_obj, data_endianness_obj,
+					     &addr, &data_endianness);
+	if (!data_size) {
+		PyBuffer_Release(&buf);
+		return nullptr;
+	}
+
+	const size_t count = buf.len / data_size;
+
+	try {
+		switch (data_size) {
+		case 1:
+			self->target->read_array(addr, static_cast<uint8_t*>(buf.buf), count, data_endianness);
+			break;
+		case 2:
+			self->target->read_array(addr, static_cast<uint16_t*>(buf.buf), count, data_endianness);
+			break;
+		case 4:
+			self->target->read_array(addr, static_cast<uint32_t*>(buf.buf), count, data_endianness);
+			break;
+		case 8:
+			self->target->read_array(addr, static_cast<uint64_t*>(buf.buf), count, data_endianness);
+			break;
+		}
+	} catch (const exception& e) {
+		PyBuffer_Release(&buf);
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return nullptr;
+	}
+
+	PyBuffer_Release(&buf);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject* MMapTarget_write_from(MMapTargetObject* self, PyObject* args, PyObject* kwds)
+{
+	static const char* kwlist[] = { "addr", "buffer", "data_size", "data_endianness", nullptr };
+
+	PyObject* addr_obj;
+	Py_buffer buf;
+	PyObject* data_size_obj = nullptr;
+	PyObject* data_endianness_obj = nullptr;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oy*|OO", const_cast<char**>(kwlist),
+					 &addr_obj, &buf, &data_size_obj, &data_endianness_obj))
+		return nullptr;
+
+	if (self->target && self->mode == MapMode::Read) {
+		PyBuffer_Release(&buf);
+		PyErr_SetString(PyExc_RuntimeError, "Trying to write to a read-only mapping");
+		return nullptr;
+	}
+
+	uint64_t addr;
+	Endianness data_endianness;
+
+	uint8_t data_size = parse_array_args(self, addr_obj, buf, data_size_obj, data_endianness_obj,
+					     &addr, &data_endianness);
+	if (!data_size) {
+		PyBuffer_Release(&buf);
+		return nullptr;
+	}
+
+	const size_t count = buf.len / data_size;
+
+	try {
+		switch (data_size) {
+		case 1:
+			self->target->write_array(addr, static_cast<const uint8_t*>(buf.buf), count, data_endianness);
+			break;
+		case 2:
+			self->target->write_array(addr, static_cast<const uint16_t*>(buf.buf), count, data_endianness);
+			break;
+		case 4:
+			self->target->write_array(addr, static_cast<const uint32_t*>(buf.buf), count, data_endianness);
+			break;
+		case 8:
+			self->target->write_array(addr, static_cast<const uint64_t*>(buf.buf), count, data_endianness);
+			break;
+		}
+	} catch (const exception& e) {
+		PyBuffer_Release(&buf);
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return nullptr;
+	}
+
+	PyBuffer_Release(&buf);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject* MMapTarget_close(MMapTargetObject* self, PyObject* Py_UNUSED(args))
+{
+	delete self->target;
+	self->target = nullptr;
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef MMapTarget_methods[] = {
+	{ "read", (PyCFunction)(void (*)(void))MMapTarget_read, METH_FASTCALL | METH_KEYWORDS,
+	  "read(addr, data_size=None, data_endianness=Endianness.Default, addr_size=None, addr_endianness=Endianness.Default)" },
+	{ "write", (PyCFunction)(void (*)(void))MMapTarget_write, METH_FASTCALL | METH_KEYWORDS,
+	  "write(addr, value, data_size=None, data_endianness=Endianness.Default, addr_size=None, addr_endianness=Endianness.Default)" },
+	{ "read_into", (PyCFunction)(void (*)(void))MMapTarget_read_into, METH_VARARGS | METH_KEYWORDS,
+	  "read_into(addr, buffer, data_size=None, data_endianness=Endianness.Default): fill the buffer with host endian values" },
+	{ "write_from", (PyCFunction)(void (*)(void))MMapTarget_write_from, METH_VARARGS | METH_KEYWORDS,
+	  "write_from(addr, buffer, data_size=None, data_endianness=Endianness.Default): write host endian values from the buffer" },
+	{ "close", (PyCFunction)MMapTarget_close, METH_NOARGS, "Unmap the target" },
+	{ nullptr, nullptr, 0, nullptr },
+};
+
+static PyType_Slot MMapTarget_slots[] = {
+	{ Py_tp_doc, (void*)"MMapTarget(file, offset, length, data_endianness, data_size, mode)" },
+	{ Py_tp_new, (void*)PyType_GenericNew },
+	{ Py_tp_init, (void*)MMapTarget_init },
+	{ Py_tp_dealloc, (void*)MMapTarget_dealloc },
+	{ Py_tp_methods, MMapTarget_methods },
+	{ 0, nullptr },
+};
+
+static PyType_Spec MMapTarget_spec = {
+	"rwmem._rwmem.MMapTarget",
+	sizeof(MMapTargetObject),
+	0,
+	Py_TPFLAGS_DEFAULT,
+	MMapTarget_slots,
+};
+
+/*
+ * RegisterFileData
+ */
+
+struct RegisterFileDataObject {
+	PyObject_HEAD
+	Py_buffer view;
+	const RegisterFileData* rfd;
+	size_t strings_size;
+};
+
+static int RegisterFileData_init(RegisterFileDataObject* self, PyObject* args, PyObject* kwds)
+{
+	static const char* kwlist[] = { "buffer", nullptr };
+	PyObject* buffer;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", const_cast<char**>(kwlist), &buffer))
+		return -1;
+
+	if (self->rfd) {
+		PyBuffer_Release(&self->view);
+		self->rfd = nullptr;
+	}
+
+	if (PyObject_GetBuffer(buffer, &self->view, PyBUF_SIMPLE) != 0)
+		return -1;
+
+	const RegisterFileData* rfd = static_cast<const RegisterFileData*>(self->view.buf);
+	const size_t size = self->view.len;
+
+	try {
+		if (size < sizeof(RegisterFileData))
+			throw runtime_error("Register file too small");
+
+		if (rfd->magic() != RWMEM_MAGIC)
+			throw runtime_error("Bad registerfile magic number");
+
+		if (rfd->version() != RWMEM_VERSION)
+			throw runtime_error("Bad registerfile version");
+
+		// Only the header is validated here, as validating all the tables
+		// would touch every page of the file. The lookups check the
+		// entries they use.
+		self->strings_size = rfd->validate_header(size);
+	} catch (const exception& e) {
+		PyBuffer_Release(&self->view);
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return -1;
+	}
+
+	self->rfd = rfd;
+
+	return 0;
+}
+
+static void RegisterFileData_dealloc(RegisterFileDataObject* self)
+{
+	PyTypeObject* type = Py_TYPE(self);
+
+	if (self->rfd)
+		PyBuffer_Release(&self->view);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
+}
+
+static bool check_valid(RegisterFileDataObject* self)
+{
+	if (!self->rfd) {
+		PyErr_SetString(PyExc_ValueError, "RegisterFileData released");
+		return false;
+	}
+
+	return true;
+}
+
+// String at 'offset' in the string pool, as a Python str
+static PyObject* pool_str(RegisterFileDataObject* self, uint32_t offset)
+{
+	if (offset >= self->strings_size) {
+		PyErr_Format(PyExc_RuntimeError, "Bad string offset %#x", offset);
+		return nullptr;
+	}
+
+	const char* str = self->rfd->strings() + offset;
+
+	// Names are never empty, matching RegisterFile._get_str()
+	if (!str[0]) {
+		PyErr_SetString(PyExc_RuntimeError, "Empty name");
+		return nullptr;
+	}
+
+	return PyUnicode_DecodeASCII(str, strlen(str), nullptr);
+}
+
+static PyObject* RegisterFileData_block_names(RegisterFileDataObject* self, PyObject* Py_UNUSED(args))
+{
+	if (!check_valid(self))
+		return nullptr;
+
+	const RegisterFileData* rfd = self->rfd;
+
+	PyObject* list = PyList_New(rfd->num_blocks());
+	if (!list)
+		return nullptr;
+
+	for (uint32_t i = 0; i < rfd->num_blocks(); ++i) {
+		PyObject* name = pool_str(self, rfd->block_at(i)->name_offset());
+		if (!name) {
+			Py_DECREF(list);
+			return nullptr;
+		}
+		PyList_SET_ITEM(list, i, name);
+	}
+
+	return list;
+}
+
+// Build a list of (name, index) for 'count' entries of an index array
+// pointing to 'num_items' items
+template<typename F>
+static PyObject* name_index_list(RegisterFileDataObject* self, const uint32_t* indices,
+				 uint32_t num_indices, uint32_t num_items,
+				 unsigned long first, unsigned long count, F get_name_offset)
+{
+	if (first > num_indices || count > num_indices - first) {
+		PyErr_SetString(PyExc_IndexError, "index list out of range");
+		return nullptr;
+	}
+
+	PyObject* list = PyList_New(count);
+	if (!list)
+		return nullptr;
+
+	for (unsigned long i = 0; i < count; ++i) {
+		const uint32_t idx = le32toh(indices[first + i]);
+
+		if (idx >= num_items) {
+			PyErr_Format(PyExc_RuntimeError, "Bad index %u at %lu", idx, first + i);
+			Py_DECREF(list);
+			return nullptr;
+		}
+
+		PyObject* name = pool_str(self, get_name_offset(idx));
+		PyObject* item = name ? Py_BuildValue("(NI)", name, idx) : nullptr;
+		if (!item) {
+			Py_DECREF(list);
+			return nullptr;
+		}
+		PyList_SET_ITEM(list, i, item);
+	}
+
+	return list;
+}
+
+static PyObject* RegisterFileData_register_list(RegisterFileDataObject* self, PyObject* args)
+{
+	unsigned long first, count;
+
+	if (!PyArg_ParseTuple(args, "kk", &first, &count) || !check_valid(self))
+		return nullptr;
+
+	const RegisterFileData* rfd = self->rfd;
+
+	return name_index_list(self, rfd->register_indices(), rfd->num_reg_indices(), rfd->num_regs(),
+			       first, count,
+			       [rfd](uint32_t idx) { return rfd->registers()[idx].name_offset(); });
+}
+
+static PyObject* RegisterFileData_field_list(RegisterFileDataObject* self, PyObject* args)
+{
+	unsigned long first, count;
+
+	if (!PyArg_ParseTuple(args, "kk", &first, &count) || !check_valid(self))
+		return nullptr;
+
+	const RegisterFileData* rfd = self->rfd;
+
+	return name_index_list(self, rfd->field_indices(), rfd->num_field_indices(), rfd->num_fields(),
+			       first, count,
+			       [rfd](uint32_t idx) { return rfd->fields()[idx].name_offset(); });
+}
+
+static PyObject* RegisterFileData_string(RegisterFileDataObject* self, PyObject* arg)
+{
+	if (!check_valid(self))
+		return nullptr;
+
+	unsigned long offset = PyLong_AsUnsignedLong(arg);
+	if (offset == (unsigned long)-1 && PyErr_Occurred())
+		return nullptr;
+
+	if (offset > UINT32_MAX) {
+		PyErr_SetString(PyExc_RuntimeError, "Bad string offset");
+		return nullptr;
+	}
+
+	return pool_str(self, offset);
+}
+
+static PyObject* RegisterFileData_release(RegisterFileDataObject* self, PyObject* Py_UNUSED(args))
+{
+	if (self->rfd) {
+		PyBuffer_Release(&self->view);
+		self->rfd = nullptr;
+	}
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef RegisterFileData_methods[] = {
+	{ "block_names", (PyCFunction)RegisterFileData_block_names, METH_NOARGS,
+	  "Names of all blocks, in file order" },
+	{ "register_list", (PyCFunction)RegisterFileData_register_list, METH_VARARGS,
+	  "register_list(first, count): (name, register index) for the register index list entries" },
+	{ "field_list", (PyCFunction)RegisterFileData_field_list, METH_VARARGS,
+	  "field_list(first, count): (name, field index) for the field index list entries" },
+	{ "string", (PyCFunction)RegisterFileData_string, METH_O,
+	  "string(offset): string at the offset in the string pool" },
+	{ "release", (PyCFunction)RegisterFileData_release, METH_NOARGS,
+	  "Release the buffer, so that the underlying mmap can be closed" },
+	{ nullptr, nullptr, 0, nullptr },
+};
+
+static PyType_Slot RegisterFileData_slots[] = {
+	{ Py_tp_doc, (void*)"RegisterFileData(buffer)" },
+	{ Py_tp_new, (void*)PyType_GenericNew },
+	{ Py_tp_init, (void*)RegisterFileData_init },
+	{ Py_tp_dealloc, (void*)RegisterFileData_dealloc },
+	{ Py_tp_methods, RegisterFileData_methods },
+	{ 0, nullptr },
+};
+
+static PyType_Spec RegisterFileData_spec = {
+	"rwmem._rwmem.RegisterFileData",
+	sizeof(RegisterFileDataObject),
+	0,
+	Py_TPFLAGS_DEFAULT,
+	RegisterFileData_slots,
+};
+
+/*
+ * Module
+ */
+
+static int rwmem_exec(PyObject* m)
+{
+	PyObject* type = PyType_FromSpec(&MMapTarget_spec);
+	if (PyModule_AddObject(m, "MMapTarget", type) < 0) {
+		Py_XDECREF(type);
+		return -1;
+	}
+
+	type = PyType_FromSpec(&RegisterFileData_spec);
+	if (PyModule_AddObject(m, "RegisterFileData", type) < 0) {
+		Py_XDECREF(type);
+		return -1;
+	}
+
+	return 0;
+}
+
+static PyModuleDef_Slot rwmem_slots[] = {
+	{ Py_mod_exec, (void*)rwmem_exec },
+	{ 0, nullptr },
+};
+
+static PyModuleDef rwmem_module = {
+	PyModuleDef_HEAD_INIT,
+	"_rwmem",
+	"Native accelerator for rwmem",
+	0,
+	nullptr,
+	rwmem_slots,
+	nullptr,
+	nullptr,
+	nullptr,
+};
+
+PyMODINIT_FUNC PyInit__rwmem(void)
+{
+	return PyModuleDef_Init(&rwmem_module);
+}
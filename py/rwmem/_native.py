@@ -0,0 +1,17 @@
+from __future__ import annotations
+
+import os
+
+__all__ = ['native']
+
+# The optional native accelerator (py/ext/_rwmem.cpp). It is used
+# transparently when available. Set RWMEM_NO_NATIVE=1 to use the pure Python
+# implementation.
+
+native = None
+
+if not os.environ.get('RWMEM_NO_NATIVE'):
+    try:
+        from . import _rwmem as native  # type: ignore[no-redef]
+    except ImportError:
+        pass
@@ -1,6 +1,10 @@
 from __future__ import annotations
 
+import array
+import ctypes
 import io
+import struct
+import sys
 from dataclasses import dataclass
 
 from .enums import Endianness
@@ -34,6 +38,7 @@ class PackedRegister:
     reset_value: int = 0
     data_endianness: Endianness | None = None
     data_size: int | None = None
+    index: int = 0  # Index in PackedRegFile.all_registers
 
 
 @dataclass
@@ -63,6 +68,8 @@ class PackedRegFile:
 class RegFilePacker:
     def __init__(self, regfile):
         self.regfile = regfile
+        self._reg_signatures = {}  # register signature -> small int id
+        self._reg_signature_cache = {}  # id(register) -> (register, signature id)
 
     def prepare(self) -> PackedRegFile:
         # Create strings_map with an empty string
@@ -151,6 +158,7 @@ class RegFilePacker:
                         reset_value=reg.reset_value,
                         data_endianness=reg.data_endianness,
                         data_size=reg.data_size,
+                        index=len(all_packed_regs),
                     )
                     packed_regs.append(packed_reg)
                     all_packed_regs.append(packed_reg)
@@ -190,9 +198,19 @@ class RegFilePacker:
         )
 
     def _compute_register_signature(self, regs):
-        """Compute a signature for a set of registers to enable deduplication."""
+        """Compute a signature for a set of registers to enable deduplication.
+
+        Each distinct register is interned to a small int, so the signature of
+        a block is a tuple of ints, cheap to hash and compare. Register objects
+        shared between blocks are only looked at once.
+        """
         signature_parts = []
         for reg in regs:
+            cached = self._reg_signature_cache.get(id(reg))
+            if cached is not None:
+                signature_parts.append(cached[1])
+                continue
+
             # Sort fields for consistent signature
             sorted_fields = sorted(reg.fields, key=lambda f: (f.name, f.high, f.low))
             field_sig = tuple((f.name, f.high, f.low, f.description) for f in sorted_fields)
@@ -205,52 +223,67 @@ class RegFilePacker:
                 reg.data_endianness,
                 reg.data_size,
             )
-            signature_parts.append(reg_sig)
+            sig_id = self._reg_signatures.setdefault(reg_sig, len(self._reg_signatures))
+            # Keep a reference to the register, so that its id stays unique
+            self._reg_signature_cache[id(reg)] = (reg, sig_id)
+            signature_parts.append(sig_id)
         return tuple(signature_parts)
 
     def pack_to(self, out: io.IOBase, packed: PackedRegFile | None = None):
+        """Write the register file to 'out'
+
+        The output is written sequentially in chunks of about WRITE_CHUNK
+        bytes, so 'out' does not need to be seekable and the packed file is
+        never held in memory as a whole.
+        """
         if packed is None:
             packed = self.prepare()
 
+        strings = packed.strings
+        buf = bytearray()
+
+        def emit(data):
+            buf.extend(data)
+            if len(buf) >= WRITE_CHUNK:
+                out.write(buf)
+                buf.clear()
+
         # Write regfile header
-        out.write(pack_regfile(packed))
+        emit(pack_regfile(packed))
 
         # Write all blocks
         for block in packed.blocks:
-            out.write(pack_block(block, packed.strings))
+            emit(pack_block(block, strings))
 
         # Write all unique registers (deduplicated)
         for reg in packed.all_registers:
-            out.write(pack_register(reg, packed.strings))
+            emit(pack_register(reg, strings))
 
         # Write all unique fields (deduplicated)
         for field in packed.all_fields:
-            out.write(pack_field(field, packed.strings))
+            emit(pack_field(field, strings))
 
         # Write register index arrays
-        for block in packed.blocks:
-            for reg in block.regs:
-                # Find the index of this register in the global all_registers array
-                reg_index = None
-                for i, global_reg in enumerate(packed.all_registers):
-                    if global_reg is reg:
-                        reg_index = i
-                        break
-                if reg_index is None:
-                    raise RuntimeError(f'Register {reg.name} not found in global register array')
-                out.write(pack_register_index(reg_index))
+        emit(_pack_indices(reg.index for block in packed.blocks for reg in block.regs))
 
         # Write field index arrays (1:1 mapping for now)
-        for reg in packed.all_registers:
-            for i in range(len(reg.fields)):
-                out.write(pack_field_index(reg.first_field_index + i))
+        emit(
+            _pack_indices(
+                idx
+                for reg in packed.all_registers
+                for idx in range(reg.first_field_index, reg.first_field_index + len(reg.fields))
+            )
+        )
 
         # Write strings table
-        first_pos = out.tell()
-        for s, idx in packed.strings.items():
-            assert idx == out.tell() - first_pos
-            out.write(bytes(s, 'ascii'))
-            out.write(b'\0')
+        pos = 0
+        for s, idx in strings.items():
+            assert idx == pos
+            data = s.encode('ascii') + b'\0'
+            emit(data)
+            pos += len(data)
+
+        out.write(buf)
 
     def pack_to_bytes(self) -> bytes:
         with io.BytesIO() as f:
@@ -258,39 +291,65 @@ class RegFilePacker:
             return f.getvalue()
 
 
+# pack_to() collects the output into chunks of this size before writing
+WRITE_CHUNK = 1 << 20
+
+# struct formats matching the ctypes structures in _structs.py. ctypes is
+# slow for creating millions of small structures.
+_REGFILE = struct.Struct('<8I')
+_BLOCK = struct.Struct('<IIQQIIBBBB')
+_REGISTER = struct.Struct('<IIQQIIBB')
+_FIELD = struct.Struct('<IIBB')
+
+assert _REGFILE.size == ctypes.sizeof(RegisterFileDataV3)
+assert _BLOCK.size == ctypes.sizeof(RegisterBlockDataV3)
+assert _REGISTER.size == ctypes.sizeof(RegisterDataV3)
+assert _FIELD.size == ctypes.sizeof(FieldDataV3)
+assert ctypes.sizeof(RegisterIndexV3) == ctypes.sizeof(FieldIndexV3) == 4
+
+
+_U32_TYPECODE = next(tc for tc in 'IL' if array.array(tc).itemsize == 4)
+
+
+def _pack_indices(indices) -> bytes:
+    """Pack a sequence of uint32 indices"""
+    arr = array.array(_U32_TYPECODE, indices)
+    if sys.byteorder != 'little':
+        arr.byteswap()
+    return arr.tobytes()
+
+
 def pack_regfile(regfile: PackedRegFile):
     # Calculate indirection array sizes
     num_reg_indices = sum(len(block.regs) for block in regfile.blocks)
     num_field_indices = sum(len(reg.fields) for reg in regfile.all_registers)
 
-    data = RegisterFileDataV3(
-        magic=RWMEM_MAGIC_V3,
-        version=RWMEM_VERSION_V3,
-        name_offset=regfile.strings[regfile.name],
-        num_blocks=len(regfile.blocks),
-        num_regs=len(regfile.all_registers),
-        num_fields=len(regfile.all_fields),
-        num_reg_indices=num_reg_indices,
-        num_field_indices=num_field_indices,
+    return _REGFILE.pack(
+        RWMEM_MAGIC_V3,
+        RWMEM_VERSION_V3,
+        regfile.strings[regfile.name],
+        len(regfile.blocks),
+        len(regfile.all_registers),
+        len(regfile.all_fields),
+        num_reg_indices,
+        num_field_indices,
     )
-    return bytes(data)
 
 
 def pack_block(block: PackedBlock, strings: dict[str, int]):
     description_offset = strings.get(block.description, 0) if block.description else 0
-    data = RegisterBlockDataV3(
-        name_offset=strings[block.name],
-        description_offset=description_offset,
-        offset=block.offset,
-        size=block.size,
-        num_regs=len(block.regs),
-        first_reg_list_index=block.first_reg_index,
-        default_addr_endianness=block.addr_endianness.value,
-        default_addr_size=block.addr_size,
-        default_data_endianness=block.data_endianness.value,
-        default_data_size=block.data_size,
+    return _BLOCK.pack(
+        strings[block.name],
+        description_offset,
+        block.offset,
+        block.size,
+        len(block.regs),
+        block.first_reg_index,
+        block.addr_endianness.value,
+        block.addr_size,
+        block.data_endianness.value,
+        block.data_size,
     )
-    return bytes(data)
 
 
 def pack_register(reg: PackedRegister, strings: dict[str, int]):
@@ -299,35 +358,31 @@ def pack_register(reg: PackedRegister, strings: dict[str, int]):
     data_endianness = reg.data_endianness.value if reg.data_endianness is not None else 0
     data_size = reg.data_size if reg.data_size is not None else 0
 
-    data = RegisterDataV3(
-        name_offset=strings[reg.name],
-        description_offset=description_offset,
-        offset=reg.offset,
-        reset_value=reg.reset_value,
-        num_fields=len(reg.fields),
-        first_field_list_index=reg.first_field_index,
-        data_endianness=data_endianness,
-        data_size=data_size,
+    return _REGISTER.pack(
+        strings[reg.name],
+        description_offset,
+        reg.offset,
+        reg.reset_value,
+        len(reg.fields),
+        reg.first_field_index,
+        data_endianness,
+        data_size,
     )
-    return bytes(data)
 
 
 def pack_field(field: PackedField, strings: dict[str, int]):
     description_offset = strings.get(field.description, 0) if field.description else 0
-    data = FieldDataV3(
-        name_offset=strings[field.name],
-        description_offset=description_offset,
-        high=field.high,
-        low=field.low,
+    return _FIELD.pack(
+        strings[field.name],
+        description_offset,
+        field.high,
+        field.low,
     )
-    return bytes(data)
 
 
 def pack_register_index(register_index):
-    data = RegisterIndexV3(register_index=register_index)
-    return bytes(data)
+    return _pack_indices((register_index,))
 
 
 def pack_field_index(field_index):
-    data = FieldIndexV3(field_index=field_index)
-    return bytes(data)
+    return _pack_indices((field_index,))
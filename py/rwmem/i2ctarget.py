@@ -4,6 +4,7 @@ import ctypes
 import fcntl
 import os
 import weakref
+from collections.abc import Iterable
 
 from .enums import Endianness, MapMode
 from .target import Target
@@ -17,6 +18,10 @@ I2C_RDWR = 0x0707
 I2C_FUNC_I2C = 0x00000001
 I2C_M_RD = 0x0001
 
+# Limits of the i2c-dev I2C_RDWR ioctl
+I2C_RDWR_IOCTL_MAX_MSGS = 42
+I2C_RDWR_MAX_MSG_LEN = 8192
+
 
 class i2c_msg(ctypes.Structure):
     _fields_ = [
@@ -70,18 +75,23 @@ class I2CTarget(Target):
         if (i2c_funcs.value & I2C_FUNC_I2C) == 0:
             raise RuntimeError('no i2c functionality')
 
+        # Reused by the batched transfers
+        self._msgs = (i2c_msg * I2C_RDWR_IOCTL_MAX_MSGS)()
+        self._ioctl_data = i2c_rdwr_ioctl_data(self._msgs, 0)
+        self._buf = (ctypes.c_uint8 * 0)()
+
     def close(self):
         if self._finalizer.detach():
             os.close(self.fd)
 
-    def read(
+    def _resolve_sizes(
         self,
-        addr: int,
-        data_size: int | None = None,
-        data_endianness: Endianness = Endianness.Default,
-        addr_size: int | None = None,
-        addr_endianness: Endianness = Endianness.Default,
-    ) -> int:
+        data_size: int | None,
+        data_endianness: Endianness,
+        addr_size: int | None,
+        addr_endianness: Endianness,
+    ) -> tuple[int, str, int, str]:
+        """Resolve the defaults, returning (data_size, data_bo, addr_size, addr_bo)"""
         if addr_size is None:
             addr_size = self.addr_size
         elif addr_size <= 0:
@@ -98,16 +108,35 @@ class I2CTarget(Target):
         if data_endianness == Endianness.Default:
             data_endianness = self.data_endianness
 
+        return (
+            data_size,
+            self._endianness_to_bo(data_endianness),
+            addr_size,
+            self._endianness_to_bo(addr_endianness),
+        )
+
+    def _check_range(self, addr: int, nbytes: int):
         if addr < self.offset:
-            raise RuntimeError()
+            raise RuntimeError(f'register {addr:#x} before block start {self.offset:#x}')
 
-        if addr + data_size > self.offset + self.length:
+        if addr + nbytes > self.offset + self.length:
             raise RuntimeError(
-                f'register {addr:#x} end {addr + data_size:#x} over block end {self.offset + self.length:#x}'
+                f'register {addr:#x} end {addr + nbytes:#x} over block end {self.offset + self.length:#x}'
             )
 
-        addr_bo = self._endianness_to_bo(addr_endianness)
-        data_bo = self._endianness_to_bo(data_endianness)
+    def read(
+        self,
+        addr: int,
+        data_size: int | None = None,
+        data_endianness: Endianness = Endianness.Default,
+        addr_size: int | None = None,
+        addr_endianness: Endianness = Endianness.Default,
+    ) -> int:
+        data_size, data_bo, addr_size, addr_bo = self._resolve_sizes(
+            data_size, data_endianness, addr_size, addr_endianness
+        )
+
+        self._check_range(addr, data_size)
 
         # print(f'READ {self.mmap_offset:#x}+{addr:#x} (nbytes {nbytes}, bo {endianness})')
 
@@ -154,30 +183,11 @@ class I2CTarget(Target):
         if self.mode == MapMode.Read:
             raise RuntimeError()
 
-        if addr_size is None:
-            addr_size = self.addr_size
-        elif addr_size <= 0:
-            raise ValueError(f'Address size must be positive, got {addr_size}')
-
-        if data_size is None:
-            data_size = self.data_size
-        elif data_size <= 0:
-            raise ValueError(f'Data size must be positive, got {data_size}')
-
-        if addr_endianness == Endianness.Default:
-            addr_endianness = self.addr_endianness
-
-        if data_endianness == Endianness.Default:
-            data_endianness = self.data_endianness
-
-        if addr < self.offset:
-            raise RuntimeError()
-
-        if addr + data_size > self.offset + self.length:
-            raise RuntimeError()
+        data_size, data_bo, addr_size, addr_bo = self._resolve_sizes(
+            data_size, data_endianness, addr_size, addr_endianness
+        )
 
-        addr_bo = self._endianness_to_bo(addr_endianness)
-        data_bo = self._endianness_to_bo(data_endianness)
+        self._check_range(addr, data_size)
 
         # ctypes requires a writeable buffer...
         data = bytearray()
@@ -202,3 +212,168 @@ class I2CTarget(Target):
         # print(f'WRITE {addr:#x} (nbytes {nbytes}, bo {endianness}) = {value:#x}')
 
         # self._map[addr:addr + nbytes] = value.to_bytes(nbytes, bo, signed=False)
+
+    def _get_buf(self, size: int):
+        if len(self._buf) < size:
+            self._buf = (ctypes.c_uint8 * size)()
+        return self._buf
+
+    def _transfer(self, nmsgs: int):
+        self._ioctl_data.nmsgs = nmsgs
+
+        r = fcntl.ioctl(self.fd, I2C_RDWR, self._ioctl_data, True)
+
+        if r != nmsgs:
+            raise RuntimeError(f'I2C transfer of {nmsgs} messages returned {r}')
+
+    def _read_batched(self, reads: list[tuple[int, int]], addr_size: int, addr_bo: str) -> bytes:
+        """Do the (addr, nbytes) reads, as many per ioctl as the kernel allows
+
+        Each read is an address write followed by a data read. Returns the
+        data of all the reads concatenated.
+        """
+        out = bytearray()
+        msgs = self._msgs
+        per_ioctl = I2C_RDWR_IOCTL_MAX_MSGS // 2
+
+        for start in range(0, len(reads), per_ioctl):
+            chunk = reads[start : start + per_ioctl]
+
+            addr_data = b''.join(addr.to_bytes(addr_size, addr_bo) for addr, _ in chunk)
+            data_len = sum(nbytes for _, nbytes in chunk)
+
+            buf = self._get_buf(len(addr_data) + data_len)
+            ctypes.memmove(buf, addr_data, len(addr_data))
+
+            addr_ptr = ctypes.addressof(buf)
+            data_ptr = addr_ptr + len(addr_data)
+
+            for i, (_, nbytes) in enumerate(chunk):
+                m = msgs[2 * i]
+                m.addr = self.i2c_dev_addr
+                m.flags = 0
+                m.len = addr_size
+                m.buf = ctypes.cast(addr_ptr + i * addr_size, ctypes.POINTER(ctypes.c_uint8))
+
+                m = msgs[2 * i + 1]
+                m.addr = self.i2c_dev_addr
+                m.flags = I2C_M_RD
+                m.len = nbytes
+                m.buf = ctypes.cast(data_ptr, ctypes.POINTER(ctypes.c_uint8))
+
+                data_ptr += nbytes
+
+            self._transfer(2 * len(chunk))
+
+            out += ctypes.string_at(ctypes.addressof(buf) + len(addr_data), data_len)
+
+        return bytes(out)
+
+    def read_many(
+        self,
+        addrs: Iterable[int],
+        data_size: int | None = None,
+        data_endianness: Endianness = Endianness.Default,
+        addr_size: int | None = None,
+        addr_endianness: Endianness = Endianness.Default,
+    ) -> list[int]:
+        """Read the registers at 'addrs'
+
+        The reads are packed into as few I2C_RDWR ioctls as possible.
+        """
+        data_size, data_bo, addr_size, addr_bo = self._resolve_sizes(
+            data_size, data_endianness, addr_size, addr_endianness
+        )
+
+        addrs = list(addrs)
+        for addr in addrs:
+            self._check_range(addr, data_size)
+
+        data = self._read_batched([(addr, data_size) for addr in addrs], addr_size, addr_bo)
+
+        return [
+            int.from_bytes(data[i : i + data_size], data_bo)
+            for i in range(0, len(data), data_size)
+        ]
+
+    def read_range(
+        self,
+        addr: int,
+        count: int,
+        data_size: int | None = None,
+        data_endianness: Endianness = Endianness.Default,
+        addr_size: int | None = None,
+        addr_endianness: Endianness = Endianness.Default,
+    ) -> list[int]:
+        """Read 'count' consecutive registers starting at 'addr'
+
+        The registers are read with burst reads, relying on the device to
+        auto-increment the register address, so the device must support that.
+        """
+        data_size, data_bo, addr_size, addr_bo = self._resolve_sizes(
+            data_size, data_endianness, addr_size, addr_endianness
+        )
+
+        if count < 0:
+            raise ValueError(f'Count must not be negative, got {count}')
+
+        self._check_range(addr, count * data_size)
+
+        # Split at message size limit, on a register boundary
+        max_len = I2C_RDWR_MAX_MSG_LEN // data_size * data_size
+        if max_len == 0:
+            raise ValueError(f'Data size {data_size} too large for a burst read')
+
+        total = count * data_size
+        reads = [(addr + i, min(max_len, total - i)) for i in range(0, total, max_len)]
+
+        data = self._read_batched(reads, addr_size, addr_bo)
+
+        return [
+            int.from_bytes(data[i : i + data_size], data_bo) for i in range(0, total, data_size)
+        ]
+
+    def write_many(
+        self,
+        pairs: Iterable[tuple[int, int]],
+        data_size: int | None = None,
+        data_endianness: Endianness = Endianness.Default,
+        addr_size: int | None = None,
+        addr_endianness: Endianness = Endianness.Default,
+    ):
+        """Write the (addr, value) pairs, in order
+
+        The writes are packed into as few I2C_RDWR ioctls as possible.
+        """
+        if self.mode == MapMode.Read:
+            raise RuntimeError()
+
+        data_size, data_bo, addr_size, addr_bo = self._resolve_sizes(
+            data_size, data_endianness, addr_size, addr_endianness
+        )
+
+        # Convert everything first, so that a bad value is found before any write
+        writes = []
+        for addr, value in pairs:
+            self._check_range(addr, data_size)
+            writes.append(addr.to_bytes(addr_size, addr_bo) + value.to_bytes(data_size, data_bo))
+
+        msgs = self._msgs
+        msg_len = addr_size + data_size
+
+        for start in range(0, len(writes), I2C_RDWR_IOCTL_MAX_MSGS):
+            chunk = writes[start : start + I2C_RDWR_IOCTL_MAX_MSGS]
+
+            buf = self._get_buf(len(chunk) * msg_len)
+            ctypes.memmove(buf, b''.join(chunk), len(chunk) * msg_len)
+
+            ptr = ctypes.addressof(buf)
+
+            for i in range(len(chunk)):
+                m = msgs[i]
+                m.addr = self.i2c_dev_addr
+                m.flags = 0
+                m.len = msg_len
+                m.buf = ctypes.cast(ptr + i * msg_len, ctypes.POINTER(ctypes.c_uint8))
+
+            self._transfer(len(chunk))
@@ -1,6 +1,8 @@
 from __future__ import annotations
 
 import collections.abc
+import contextlib
+from collections.abc import Iterator
 
 import rwmem.helpers
 import rwmem.mmaptarget
@@ -8,41 +10,72 @@ import rwmem.mmaptarget
 __all__ = ['MappedRegister', 'MappedRegisterBlock', 'MappedRegisterFile']
 
 
+class _Transaction:
+    """Register values of a block, as read from the target, while a
+    transaction is active"""
+
+    __slots__ = ('values', 'dirty')
+
+    def __init__(self, values: dict[str, int]) -> None:
+        self.values = values
+        self.dirty: dict[str, rwmem.Register] = {}
+
+
 class MappedRegister:
-    def __init__(self, map, reg: rwmem.Register, block_offset):
+    def __init__(
+        self, map, reg: rwmem.Register, block_offset, block: MappedRegisterBlock | None = None
+    ):
         self._map = map
         self._reg = reg
         self._frozen = None
         self._block_offset = block_offset
+        self._block = block
+
+    def _read(self) -> int:
+        txn = self._block._txn if self._block else None
+        if txn:
+            value = txn.values[self._reg.name]
+        else:
+            value = self._map.read(
+                self._block_offset + self._reg.offset, data_size=self._reg.effective_data_size
+            )
+        return self._convert_endianness_if_needed(value, True)
+
+    def _write(self, value: int):
+        converted_val = self._convert_endianness_if_needed(value, False)
+
+        txn = self._block._txn if self._block else None
+        if txn:
+            # Checked here, so that a bad value is not found only at commit time
+            if converted_val < 0 or converted_val >= 1 << (self._reg.effective_data_size * 8):
+                raise OverflowError(f'Value {value:#x} too large for register {self._reg.name}')
+            txn.values[self._reg.name] = converted_val
+            txn.dirty[self._reg.name] = self._reg
+        else:
+            self._map.write(
+                self._block_offset + self._reg.offset,
+                converted_val,
+                data_size=self._reg.effective_data_size,
+            )
 
     def freeze(self):
         if self._frozen is not None:
             raise RuntimeError('Register already frozen')
 
-        value = self._map.read(
-            self._block_offset + self._reg.offset, data_size=self._reg.effective_data_size
-        )
-        self._frozen = self._convert_endianness_if_needed(value, True)
+        self._frozen = self._read()
 
     def unfreeze(self):
         if self._frozen is None:
             raise RuntimeError('Register not frozen')
-        converted_val = self._convert_endianness_if_needed(self._frozen, False)
-        self._map.write(
-            self._block_offset + self._reg.offset,
-            converted_val,
-            data_size=self._reg.effective_data_size,
-        )
+        self._write(self._frozen)
         self._frozen = None
 
     def get_fields(self):
-        self.freeze()
+        reg_value = self.get_value()
 
         fields = {}
         for f in self._reg.values():
-            fields[f.name] = self[f.name]
-
-        self.unfreeze()
+            fields[f.name] = rwmem.helpers.get_field_value(reg_value, f.high, f.low)
 
         return fields
 
@@ -89,10 +122,7 @@ class MappedRegister:
 
     def get_value(self) -> int:
         if self._frozen is None:
-            value = self._map.read(
-                self._block_offset + self._reg.offset, data_size=self._reg.effective_data_size
-            )
-            return self._convert_endianness_if_needed(value, True)
+            return self._read()
         else:
             return self._frozen
 
@@ -104,12 +134,7 @@ class MappedRegister:
             self.unfreeze()
         else:
             if self._frozen is None:
-                converted_val = self._convert_endianness_if_needed(val, False)
-                self._map.write(
-                    self._block_offset + self._reg.offset,
-                    converted_val,
-                    data_size=self._reg.effective_data_size,
-                )
+                self._write(val)
             else:
                 self._frozen = val
 
@@ -214,6 +239,93 @@ class MappedRegisterBlock(collections.abc.Mapping):
 
         self._registers: dict[str, MappedRegister | None] = dict.fromkeys(regblock.keys())
 
+        self._txn: _Transaction | None = None
+
+    @contextlib.contextmanager
+    def transaction(self, verify: bool = False) -> Iterator[MappedRegisterBlock]:
+        """Access the registers of the block in memory
+
+        All the registers of the block are read once when the transaction
+        starts, and register and field accesses inside the transaction only
+        use those values. When the transaction ends, the registers that were
+        written are written back in offset order, each with a single access.
+        With 'verify', the written registers are read back afterwards, and a
+        RuntimeError is raised if any of them differs from the written value.
+
+        If the with-block raises an exception, nothing is written.
+        """
+        if self._txn is not None:
+            raise RuntimeError('Transaction already active')
+
+        self._txn = _Transaction(self._read_registers())
+
+        try:
+            yield self
+        except BaseException:
+            self._txn = None
+            raise
+
+        txn = self._txn
+        self._txn = None
+
+        self._write_registers(txn, verify)
+
+    def _read_registers(self) -> dict[str, int]:
+        """Read the values of all registers, in offset order"""
+        regs = sorted((self._regblock[name] for name in self._registers), key=lambda r: r.offset)
+
+        # Block-sized registers at consecutive offsets are read with one read_array()
+        run_size = self._regblock.data_size if self._regblock.data_size in (1, 2, 4, 8) else 0
+
+        values: dict[str, int] = {}
+        i = 0
+
+        while i < len(regs):
+            j = i + 1
+
+            if regs[i].effective_data_size == run_size:
+                while (
+                    j < len(regs)
+                    and regs[j].effective_data_size == run_size
+                    and regs[j].offset == regs[j - 1].offset + run_size
+                ):
+                    j += 1
+
+            if j - i > 1:
+                run = self._map.read_array(self._offset + regs[i].offset, j - i, run_size)
+                values.update(zip((r.name for r in regs[i:j]), run))
+            else:
+                r = regs[i]
+                values[r.name] = self._map.read(
+                    self._offset + r.offset, data_size=r.effective_data_size
+                )
+
+            i = j
+
+        return values
+
+    def _write_registers(self, txn: _Transaction, verify: bool):
+        """Write back the dirty registers of the transaction, in offset order"""
+        regs = sorted(txn.dirty.values(), key=lambda r: r.offset)
+
+        for r in regs:
+            self._map.write(
+                self._offset + r.offset, txn.values[r.name], data_size=r.effective_data_size
+            )
+
+        if not verify:
+            return
+
+        mismatches = []
+
+        for r in regs:
+            v = self._map.read(self._offset + r.offset, data_size=r.effective_data_size)
+            if v != txn.values[r.name]:
+                mismatches.append(f'{r.name}: wrote {txn.values[r.name]:#x}, read {v:#x}')
+
+        if mismatches:
+            raise RuntimeError('Register verify failed: ' + ', '.join(mismatches))
+
     def __enter__(self):
         return self
 
@@ -232,7 +344,7 @@ class MappedRegisterBlock(collections.abc.Mapping):
 
         r = self._regblock.get(key)
         if r:
-            mr = MappedRegister(self._map, r, self._offset)
+            mr = MappedRegister(self._map, r, self._offset, self)
             self._registers[r.name] = mr
             return mr
 
@@ -1,10 +1,14 @@
 from __future__ import annotations
 
+import array
 import mmap
 import os
+import sys
 import weakref
+from collections.abc import Iterable
 from typing import BinaryIO
 
+from ._native import native
 from .enums import Endianness, MapMode
 from .target import Target
 
@@ -13,6 +17,25 @@ __all__ = [
 ]
 
 
+def _array_typecode(data_size: int) -> str:
+    for tc in 'BHILQ':
+        if array.array(tc).itemsize == data_size:
+            return tc
+    raise ValueError(f'Array data size must be 1, 2, 4 or 8, got {data_size}')
+
+
+def _as_buffer(values, data_size: int):
+    # Buffers of integers of the right size are used as they are
+    try:
+        with memoryview(values) as mv:
+            if mv.c_contiguous and mv.itemsize == data_size and mv.format[-1] in 'BHILQbhilq':
+                return values
+    except TypeError:
+        pass
+
+    return array.array(_array_typecode(data_size), values)
+
+
 class MMapTarget(Target):
     def __init__(
         self,
@@ -64,15 +87,35 @@ class MMapTarget(Target):
 
             # print(f'\nMAP off: {offset:#x} len: {length:#x} ->  mmap_offset: {mmap_offset:#x} mmap_len: {mmap_len:#x}')
 
-            self._map = mmap.mmap(fd, mmap_len, mmap.MAP_SHARED, prot, offset=mmap_offset)
+            if native and data_size <= 8:
+                # The native target reopens the file through our fd, so
+                # that str and BinaryIO sources work the same way.
+                self._native = native.MMapTarget(
+                    f'/proc/self/fd/{fd}', offset, length, data_endianness, data_size, mode.value
+                )
+                self._map = None
+            else:
+                self._native = None
+                self._map = mmap.mmap(fd, mmap_len, mmap.MAP_SHARED, prot, offset=mmap_offset)
         finally:
             os.close(fd)
 
-        self._finalizer = weakref.finalize(self, mmap.mmap.close, self._map)
+        if self._native:
+            # Accesses go directly to the native target, skipping the
+            # argument handling below. The semantics are the same, except
+            # that data_size is limited to 8 bytes.
+            self.read = self._native.read
+            self.write = self._native.write
+            self._finalizer = weakref.finalize(self, self._native.close)
+        else:
+            self._finalizer = weakref.finalize(self, mmap.mmap.close, self._map)
 
     def close(self):
         if self._finalizer.detach():
-            self._map.close()
+            if self._native:
+                self._native.close()
+            else:
+                self._map.close()
 
     def _check_access(self, addr: int, data_size, addr_size, addr_endianness):
         if addr_size is not None and addr_size != 0:
@@ -150,3 +193,101 @@ class MMapTarget(Target):
         addr -= self.mmap_offset
 
         self._map[addr : addr + data_size] = value.to_bytes(data_size, bo, signed=False)
+
+    def read_array(
+        self,
+        addr: int,
+        count: int,
+        data_size: int | None = None,
+        data_endianness: Endianness = Endianness.Default,
+    ) -> array.array:
+        """Read 'count' consecutive values starting at 'addr'
+
+        Each value is read with a single access of 'data_size' bytes. The
+        result is an array.array of host endian values, which supports the
+        buffer protocol, e.g. numpy.frombuffer() can use it without a copy.
+        """
+        if data_size is None:
+            data_size = self.data_size
+
+        tc = _array_typecode(data_size)
+        arr = array.array(tc, bytes(count * data_size))
+
+        if count == 0:
+            return arr
+
+        if self._native:
+            self._native.read_into(addr, arr, data_size, data_endianness)
+            return arr
+
+        self._check_access(addr, count * data_size, None, Endianness.Default)
+
+        if data_endianness == Endianness.Default:
+            data_endianness = self.data_endianness
+
+        bo = self._endianness_to_bo(data_endianness)
+
+        start = addr - self.mmap_offset
+
+        with (
+            memoryview(self._map) as mv,
+            mv[start : start + count * data_size] as area,
+            area.cast(tc) as values,
+        ):
+            # Iterating the typed view reads each value with its own access
+            arr = array.array(tc, values)
+
+        if bo != sys.byteorder:
+            arr.byteswap()
+
+        return arr
+
+    def write_array(
+        self,
+        addr: int,
+        values: Iterable[int],
+        data_size: int | None = None,
+        data_endianness: Endianness = Endianness.Default,
+    ):
+        """Write consecutive values starting at 'addr'
+
+        'values' is a buffer of host endian values of 'data_size' bytes,
+        like an array.array or a NumPy array, or any iterable of ints. Each
+        value is written with a single access of 'data_size' bytes.
+        """
+        if self.mode == MapMode.Read:
+            raise RuntimeError()
+
+        if data_size is None:
+            data_size = self.data_size
+
+        buf = _as_buffer(values, data_size)
+
+        if self._native:
+            self._native.write_from(addr, buf, data_size, data_endianness)
+            return
+
+        arr = array.array(_array_typecode(data_size))
+        arr.frombytes(bytes(buf))
+
+        if len(arr) == 0:
+            return
+
+        self._check_access(addr, len(arr) * data_size, None, Endianness.Default)
+
+        if data_endianness == Endianness.Default:
+            data_endianness = self.data_endianness
+
+        if self._endianness_to_bo(data_endianness) != sys.byteorder:
+            arr.byteswap()
+
+        start = addr - self.mmap_offset
+
+        with (
+            memoryview(self._map) as mv,
+            mv[start : start + len(arr) * data_size] as area,
+            area.cast(arr.typecode) as dst,
+        ):
+            # Store each value with its own access
+            for i, v in enumerate(arr):
+                dst[i] = v
@@ -4,10 +4,12 @@ import ctypes
 import gc
 import mmap
 import os
+import struct
 import collections.abc
 from typing import BinaryIO
-from collections.abc import Iterator
+from collections.abc import Iterable, Iterator
 
+from ._native import native
 from .enums import Endianness
 from ._structs import (
     RegisterFileDataV3 as RegisterFileData,
@@ -25,6 +27,28 @@ __all__ = ['RegisterFile', 'RegisterBlock', 'Register', 'Field']
 
 # Structure definitions now imported from _structs.py
 
+_U32 = struct.Struct('<I')
+
+
+class _NameIndex:
+    """Case-insensitive name -> index map of the entries of one level
+
+    Iterating gives the names in file order. The first entry wins if a name
+    is repeated.
+    """
+
+    __slots__ = ('names', 'indices')
+
+    def __init__(self, entries: Iterable[tuple[str, int]]) -> None:
+        self.names: list[str] = []
+        self.indices: dict[str, int] = {}
+
+        for name, idx in entries:
+            key = name.upper()
+            if key not in self.indices:
+                self.indices[key] = idx
+                self.names.append(name)
+
 
 class Field:
     def __init__(self, rf: RegisterFile, fd: FieldData) -> None:
@@ -55,23 +79,17 @@ class Register(collections.abc.Mapping[str, Field]):
         self.parent_block = parent_block
         self.name = rf._get_str(rd.name_offset)
 
-        field_names = []
+        # Built on first use
+        self._field_index: _NameIndex | None = None
+        self._field_infos: dict[str, Field] = {}
 
-        for idx in range(self.rd.num_fields):
-            # Get field index from the FieldIndex array
-            field_index_offset = self.rf.field_indices_offset + ctypes.sizeof(FieldIndexV3) * (
-                self.rd.first_field_list_index + idx
+    @property
+    def _fields(self) -> _NameIndex:
+        if self._field_index is None:
+            self._field_index = _NameIndex(
+                self.rf._field_list(self.rd.first_field_list_index, self.rd.num_fields)
             )
-            field_index_data = FieldIndexV3.from_buffer(self.rf._map, field_index_offset)
-            actual_field_index = field_index_data.field_index
-
-            # Get the actual field using the resolved index
-            offset = self.rf._get_field_offset(actual_field_index)
-            fd = FieldData.from_buffer(self.rf._map, offset)
-            name = self.rf._get_str(fd.name_offset)
-            field_names.append(name)
-
-        self._field_infos: dict[str, Field | None] = dict.fromkeys(field_names)
+        return self._field_index
 
     @property
     def num_fields(self) -> int:
@@ -108,38 +126,26 @@ class Register(collections.abc.Mapping[str, Field]):
         return self.rd.data_size
 
     def __getitem__(self, key: str) -> Field:
-        if key not in self._field_infos:
-            raise KeyError(f'Field "{key}" not found')
+        ukey = key.upper()
 
-        rbi = self._field_infos.get(key)
-        if rbi:
-            return rbi
+        f = self._field_infos.get(ukey)
+        if f:
+            return f
 
-        for idx in range(self.rd.num_fields):
-            # Get field index from the FieldIndex array
-            field_index_offset = self.rf.field_indices_offset + ctypes.sizeof(FieldIndexV3) * (
-                self.rd.first_field_list_index + idx
-            )
-            field_index_data = FieldIndexV3.from_buffer(self.rf._map, field_index_offset)
-            actual_field_index = field_index_data.field_index
-
-            # Get the actual field using the resolved index
-            offset = self.rf._get_field_offset(actual_field_index)
-            fd = FieldData.from_buffer(self.rf._map, offset)
-            name = self.rf._get_str(fd.name_offset)
-
-            if key == name:
-                f = Field(self.rf, fd)
-                self._field_infos[key] = f
-                return f
+        idx = self._fields.indices.get(ukey)
+        if idx is None:
+            raise KeyError(f'Field "{key}" not found')
 
-        raise RuntimeError()
+        fd = FieldData.from_buffer(self.rf._map, self.rf._get_field_offset(idx))
+        f = Field(self.rf, fd)
+        self._field_infos[ukey] = f
+        return f
 
     def __iter__(self) -> Iterator[str]:
-        return iter(self._field_infos)
+        return iter(self._fields.names)
 
     def __len__(self) -> int:
-        return len(self._field_infos)
+        return len(self._fields.names)
 
 
 class RegisterBlock(collections.abc.Mapping[str, Register]):
@@ -148,23 +154,17 @@ class RegisterBlock(collections.abc.Mapping[str, Register]):
         self.rbd = rbd
         self.name = rf._get_str(rbd.name_offset)
 
-        reg_names = []
+        # Built on first use
+        self._reg_index: _NameIndex | None = None
+        self._reg_infos: dict[str, Register] = {}
 
-        for idx in range(self.rbd.num_regs):
-            # Get register index from the RegisterIndex array
-            reg_index_offset = self.rf.register_indices_offset + ctypes.sizeof(RegisterIndexV3) * (
-                self.rbd.first_reg_list_index + idx
+    @property
+    def _regs(self) -> _NameIndex:
+        if self._reg_index is None:
+            self._reg_index = _NameIndex(
+                self.rf._reg_list(self.rbd.first_reg_list_index, self.rbd.num_regs)
             )
-            reg_index_data = RegisterIndexV3.from_buffer(self.rf._map, reg_index_offset)
-            actual_reg_index = reg_index_data.register_index
-
-            # Get the actual register using the resolved index
-            offset = self.rf._get_register_offset(actual_reg_index)
-            rd = RegisterData.from_buffer(self.rf._map, offset)
-            name = self.rf._get_str(rd.name_offset)
-            reg_names.append(name)
-
-        self._reg_infos: dict[str, Register | None] = dict.fromkeys(reg_names)
+        return self._reg_index
 
     @property
     def num_registers(self) -> int:
@@ -202,38 +202,26 @@ class RegisterBlock(collections.abc.Mapping[str, Register]):
         return self.rf._get_str(self.rbd.description_offset)
 
     def __getitem__(self, key: str) -> Register:
-        if key not in self._reg_infos:
-            raise KeyError(f'Register "{key}" not found')
-
-        rbi = self._reg_infos.get(key)
-        if rbi:
-            return rbi
-
-        for idx in range(self.rbd.num_regs):
-            # Get register index from the RegisterIndex array
-            reg_index_offset = self.rf.register_indices_offset + ctypes.sizeof(RegisterIndexV3) * (
-                self.rbd.first_reg_list_index + idx
-            )
-            reg_index_data = RegisterIndexV3.from_buffer(self.rf._map, reg_index_offset)
-            actual_reg_index = reg_index_data.register_index
+        ukey = key.upper()
 
-            # Get the actual register using the resolved index
-            offset = self.rf._get_register_offset(actual_reg_index)
-            rd = RegisterData.from_buffer(self.rf._map, offset)
-            name = self.rf._get_str(rd.name_offset)
+        r = self._reg_infos.get(ukey)
+        if r:
+            return r
 
-            if key == name:
-                r = Register(self.rf, rd, self)
-                self._reg_infos[key] = r
-                return r
+        idx = self._regs.indices.get(ukey)
+        if idx is None:
+            raise KeyError(f'Register "{key}" not found')
 
-        raise RuntimeError()
+        rd = RegisterData.from_buffer(self.rf._map, self.rf._get_register_offset(idx))
+        r = Register(self.rf, rd, self)
+        self._reg_infos[ukey] = r
+        return r
 
     def __iter__(self) -> Iterator[str]:
-        return iter(self._reg_infos)
+        return iter(self._regs.names)
 
     def __len__(self) -> int:
-        return len(self._reg_infos)
+        return len(self._regs.names)
 
 
 class RegisterFile(collections.abc.Mapping[str, RegisterBlock]):
@@ -288,19 +276,18 @@ class RegisterFile(collections.abc.Mapping[str, RegisterBlock]):
             self.field_indices_offset + ctypes.sizeof(FieldIndexV3) * self.rfd.num_field_indices
         )
 
-        self.name = self._get_str(self.rfd.name_offset)
-
-        rb_names = []
+        # The native accelerator, if available, does the name lookups
+        self._native = native.RegisterFileData(self._map) if native else None
 
-        for idx in range(self.rfd.num_blocks):
-            offset = self._get_regblock_offset(idx)
-            rbd = RegisterBlockData.from_buffer(self._map, offset)
-            name = self._get_str(rbd.name_offset)
-            rb_names.append(name)
+        self.name = self._get_str(self.rfd.name_offset)
 
-        self._regblock_infos: dict[str, RegisterBlock | None] = dict.fromkeys(rb_names)
+        # Built on first use
+        self._regblock_index: _NameIndex | None = None
+        self._regblock_infos: dict[str, RegisterBlock] = {}
 
     def close(self) -> None:
+        if self._native:
+            self._native.release()
         if self._mmap:
             self._mmap.close()
 
@@ -312,6 +299,8 @@ class RegisterFile(collections.abc.Mapping[str, RegisterBlock]):
         self._regblock_infos.clear()
         # Force garbage collection to clean up circular references in ctypes structures
         gc.collect()
+        if self._native:
+            self._native.release()
         if self._mmap:
             self._mmap.close()
 
@@ -345,37 +334,81 @@ class RegisterFile(collections.abc.Mapping[str, RegisterBlock]):
         return self.fields_offset + ctypes.sizeof(FieldData) * idx
 
     def _get_str(self, offset: int) -> str:
-        c = ctypes.c_char.from_buffer(self._map, self.strings_offset + offset)
-        c_addr = ctypes.addressof(c)
-        cp = ctypes.c_char_p(c_addr)
-        v = cp.value
-        if not v:
+        if self._native:
+            return self._native.string(offset)
+
+        start = self.strings_offset + offset
+        end = self._map.find(b'\0', start)
+        if end <= start:
             raise RuntimeError()
-        return v.decode('ascii')  # pylint: disable=no-member
+        return self._map[start:end].decode('ascii')
 
-    def __getitem__(self, key: str) -> RegisterBlock:
-        if key not in self._regblock_infos:
-            raise KeyError(f'RegisterBlock "{key}" not found')
+    def _block_list(self) -> list[tuple[str, int]]:
+        """(name, block index) for all blocks"""
+        if self._native:
+            return [(name, idx) for idx, name in enumerate(self._native.block_names())]
+
+        # name_offset is the first field of RegisterBlockData
+        block = struct.Struct(f'<I{ctypes.sizeof(RegisterBlockData) - 4}x')
+        end = self.blocks_offset + block.size * self.rfd.num_blocks
 
-        rbi = self._regblock_infos.get(key)
-        if rbi:
-            return rbi
+        with memoryview(self._map) as mv, mv[self.blocks_offset : end] as table:
+            name_offsets = [v for (v,) in block.iter_unpack(table)]
 
-        for idx in range(self.rfd.num_blocks):
-            offset = self._get_regblock_offset(idx)
+        return [(self._get_str(offset), idx) for idx, offset in enumerate(name_offsets)]
 
-            rbd = RegisterBlockData.from_buffer(self._map, offset)
-            name = self._get_str(rbd.name_offset)
+    def _reg_list(self, first: int, count: int) -> list[tuple[str, int]]:
+        """(name, register index) for entries of the register index list"""
+        if self._native:
+            return self._native.register_list(first, count)
+
+        indices = struct.unpack_from(
+            f'<{count}I', self._map, self.register_indices_offset + 4 * first
+        )
 
-            if key == name:
-                rb = RegisterBlock(self, rbd)
-                self._regblock_infos[key] = rb
-                return rb
+        # name_offset is the first field of RegisterData
+        return [
+            (self._get_str(_U32.unpack_from(self._map, self._get_register_offset(idx))[0]), idx)
+            for idx in indices
+        ]
+
+    def _field_list(self, first: int, count: int) -> list[tuple[str, int]]:
+        """(name, field index) for entries of the field index list"""
+        if self._native:
+            return self._native.field_list(first, count)
+
+        indices = struct.unpack_from(f'<{count}I', self._map, self.field_indices_offset + 4 * first)
+
+        # name_offset is the first field of FieldData
+        return [
+            (self._get_str(_U32.unpack_from(self._map, self._get_field_offset(idx))[0]), idx)
+            for idx in indices
+        ]
+
+    @property
+    def _blocks(self) -> _NameIndex:
+        if self._regblock_index is None:
+            self._regblock_index = _NameIndex(self._block_list())
+        return self._regblock_index
+
+    def __getitem__(self, key: str) -> RegisterBlock:
+        ukey = key.upper()
+
+        rb = self._regblock_infos.get(ukey)
+        if rb:
+            return rb
+
+        idx = self._blocks.indices.get(ukey)
+        if idx is None:
+            raise KeyError(f'RegisterBlock "{key}" not found')
 
-        raise RuntimeError()
+        rbd = RegisterBlockData.from_buffer(self._map, self._get_regblock_offset(idx))
+        rb = RegisterBlock(self, rbd)
+        self._regblock_infos[ukey] = rb
+        return rb
 
     def __iter__(self) -> Iterator[str]:
-        return iter(self._regblock_infos)
+        return iter(self._blocks.names)
 
     def __len__(self) -> int:
-        return len(self._regblock_infos)
+        return len(self._blocks.names)
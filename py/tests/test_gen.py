@@ -1,6 +1,8 @@
 #!/usr/bin/env python3
 
 import io
+import os
+import time
 import unittest
 
 import rwmem as rw
@@ -668,5 +670,79 @@ class V3GenerationTests(unittest.TestCase):
         self.assertIn('Field specification must be UnpackedField or tuple', str(cm.exception))
 
 
+class LargeRegFileTests(unittest.TestCase):
+    """Packing very large register files"""
+
+    # The target is 1M registers, but generating and packing those takes
+    # about 30 seconds, too slow for every test run. 100k registers show a
+    # quadratic packer just as well, as the check is the ratio to 10k
+    # registers. RWMEM_SLOW_TESTS=1 packs the full 1M.
+    NUM_REGS = 1_000_000 if os.environ.get('RWMEM_SLOW_TESTS') else 100_000
+    REGS_PER_BLOCK = 1000
+
+    def generate(self, num_regs):
+        blocks = []
+        for b in range(num_regs // self.REGS_PER_BLOCK):
+            regs = [
+                gen.UnpackedRegister(f'R{b}_{r}', r * 4, [gen.UnpackedField('F', 7, 0)])
+                for r in range(self.REGS_PER_BLOCK)
+            ]
+            blocks.append(
+                gen.UnpackedRegBlock(
+                    f'B{b}', b * 0x10000, 0, regs, rw.Endianness.Little, 4, rw.Endianness.Little, 4
+                )
+            )
+        return gen.UnpackedRegFile('LARGE', blocks)
+
+    def pack_time(self, urf):
+        start = time.perf_counter()
+        with io.BytesIO() as f:
+            urf.pack_to(f)
+            data = f.getvalue()
+        return time.perf_counter() - start, data
+
+    def test_pack_time_is_linear(self):
+        small = self.NUM_REGS // 10
+
+        t_small, _ = self.pack_time(self.generate(small))
+        t_large, data = self.pack_time(self.generate(self.NUM_REGS))
+
+        # 10x the registers should take about 10x the time. A quadratic
+        # packer would take 100x.
+        self.assertLess(
+            t_large,
+            t_small * 30,
+            f'{small} regs: {t_small:.2f}s, {self.NUM_REGS} regs: {t_large:.2f}s',
+        )
+
+        rf = RegisterFile(data)
+        self.assertEqual(rf.num_regs, self.NUM_REGS)
+        self.assertEqual(rf.num_fields, self.NUM_REGS)
+
+        last_block = self.NUM_REGS // self.REGS_PER_BLOCK - 1
+        reg = rf[f'B{last_block}'][f'R{last_block}_{self.REGS_PER_BLOCK - 1}']
+        self.assertEqual(reg.offset, (self.REGS_PER_BLOCK - 1) * 4)
+        self.assertEqual(list(reg), ['F'])
+
+    def test_pack_to_stream(self):
+        """pack_to() only writes, it does not need a seekable output"""
+
+        class Stream:
+            def __init__(self):
+                self.chunks = []
+
+            def write(self, data):
+                self.chunks.append(bytes(data))
+
+        urf = self.generate(self.REGS_PER_BLOCK * 20)
+
+        out = Stream()
+        urf.pack_to(out)
+
+        with io.BytesIO() as f:
+            urf.pack_to(f)
+            self.assertEqual(b''.join(out.chunks), f.getvalue())
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -1,9 +1,12 @@
 #!/usr/bin/env python3
 
+import ctypes
 import os
 import unittest
+from unittest import mock
 
 import rwmem as rw
+import rwmem.i2ctarget as i2ct
 from rwmem.enums import Endianness
 
 DRM_PATH = '/sys/devices/pci0000:00/0000:00:02.0/drm/card1/card1-DP-2'
@@ -53,5 +56,108 @@ class I2CTests(unittest.TestCase):
             self.assertEqual(v1, v2)
 
 
+class FakeI2CDevice:
+    """Emulates i2c-dev ioctls for a device with 16-bit auto-incrementing
+    register addresses"""
+
+    def __init__(self, size):
+        self.mem = bytearray(os.urandom(size))
+        self.ioctls = []
+        self.fd = os.open('/dev/null', os.O_RDWR)
+
+    def ioctl(self, fd, request, arg, mutate_flag=False):
+        if request == i2ct.I2C_FUNCS:
+            arg.value = i2ct.I2C_FUNC_I2C
+            return 0
+
+        assert request == i2ct.I2C_RDWR
+        assert arg.nmsgs <= i2ct.I2C_RDWR_IOCTL_MAX_MSGS
+
+        self.ioctls.append(arg.nmsgs)
+
+        ptr = 0
+        for i in range(arg.nmsgs):
+            m = arg.msgs[i]
+            assert m.len <= i2ct.I2C_RDWR_MAX_MSG_LEN
+            data = ctypes.string_at(m.buf, m.len)
+
+            if m.flags & i2ct.I2C_M_RD:
+                ctypes.memmove(m.buf, bytes(self.mem[ptr : ptr + m.len]), m.len)
+                ptr += m.len
+            else:
+                ptr = int.from_bytes(data[:2], 'big')
+                self.mem[ptr : ptr + m.len - 2] = data[2:]
+                ptr += m.len - 2
+
+        return arg.nmsgs
+
+
+class BatchedI2CTests(unittest.TestCase):
+    def setUp(self):
+        self.dev = FakeI2CDevice(0x10000)
+
+        with (
+            mock.patch('rwmem.i2ctarget.os.open', return_value=self.dev.fd),
+            mock.patch('rwmem.i2ctarget.fcntl.ioctl', self.dev.ioctl),
+        ):
+            self.map = rw.I2CTarget(
+                0,
+                0x50,
+                0,
+                0x10000,
+                addr_endianness=rw.Endianness.Big,
+                addr_size=2,
+                data_endianness=rw.Endianness.Little,
+                data_size=2,
+                mode=rw.MapMode.ReadWrite,
+            )
+
+        patcher = mock.patch('rwmem.i2ctarget.fcntl.ioctl', self.dev.ioctl)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+        self.addCleanup(self.map.close)
+
+    def expected(self, addr):
+        return int.from_bytes(self.dev.mem[addr : addr + 2], 'little')
+
+    def test_read_many(self):
+        addrs = [(i * 7919) % 0xFFF0 for i in range(100)]
+
+        values = self.map.read_many(addrs)
+
+        self.assertEqual(values, [self.expected(a) for a in addrs])
+        self.assertEqual(values[:3], [self.map.read(a) for a in addrs[:3]])
+        # Two messages per read, 42 messages per ioctl
+        self.assertEqual(self.dev.ioctls[:5], [42, 42, 42, 42, 32])
+
+    def test_read_range(self):
+        values = self.map.read_range(0x10, 5000, data_endianness=Endianness.Big)
+
+        self.assertEqual(
+            values,
+            [int.from_bytes(self.dev.mem[a : a + 2], 'big') for a in range(0x10, 0x10 + 10000, 2)],
+        )
+        # 10000 bytes is read in two messages of at most 8192 bytes
+        self.assertEqual(self.dev.ioctls, [4])
+
+    def test_write_many(self):
+        pairs = [(0x100 + i * 4, i * 0x101) for i in range(50)]
+
+        self.map.write_many(pairs)
+
+        self.assertEqual([self.expected(a) for a, _ in pairs], [v for _, v in pairs])
+        self.assertEqual(self.dev.ioctls, [42, 8])
+
+    def test_errors(self):
+        with self.assertRaises(RuntimeError):
+            self.map.read_many([0, 0xFFFF])
+        with self.assertRaises(RuntimeError):
+            self.map.read_range(0xFF00, 0x81)
+        with self.assertRaises(OverflowError):
+            self.map.write_many([(0, 1), (2, 0x10000)])
+
+        self.assertEqual(self.dev.ioctls, [])
+
+
 if __name__ == '__main__':
     unittest.main()
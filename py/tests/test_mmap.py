@@ -1,11 +1,13 @@
 #!/usr/bin/env python3
 
+import array
 import os
 import random
 import shutil
 import stat
 import tempfile
 import unittest
+from unittest import mock
 
 import rwmem as rw
 
@@ -417,3 +419,78 @@ class WriteMmapTests(unittest.TestCase):
         self.assertEqual(map.read(0, 8, rw.Endianness.Big), 0x1122334455667788)
         map.write(0, 0xFFEEDDCCBBAA9988, 8, rw.Endianness.Little)
         self.assertEqual(map.read(0, 8, rw.Endianness.Little), 0xFFEEDDCCBBAA9988)
+
+
+class ArrayTests(unittest.TestCase):
+    """read_array() and write_array(), with and without the native module"""
+
+    def setUp(self):
+        self.tmpfile = tempfile.NamedTemporaryFile(mode='w+b', suffix='.bin', delete=True)
+        shutil.copy2(BIN_PATH, self.tmpfile.name)
+
+    def tearDown(self):
+        self.tmpfile.close()
+
+    def open_maps(self, mode):
+        yield rw.MMapTarget(self.tmpfile.name, 0, 64, rw.Endianness.Big, 4, mode)
+        with mock.patch('rwmem.mmaptarget.native', None):
+            yield rw.MMapTarget(self.tmpfile.name, 0, 64, rw.Endianness.Big, 4, mode)
+
+    def test_read_array(self):
+        for map in self.open_maps(rw.MapMode.Read):
+            with self.subTest(native=map._native is not None), map:
+                arr = map.read_array(8, 4)
+                self.assertEqual(arr.itemsize, 4)
+                self.assertEqual(list(arr), [map.read(8 + i * 4) for i in range(4)])
+
+                for size in (1, 2, 8):
+                    for endianness in (rw.Endianness.Big, rw.Endianness.Little):
+                        arr = map.read_array(16, 32 // size, size, endianness)
+                        expected = [
+                            extract_value(TEST_DATA, 16 + i * size, size, endianness)
+                            for i in range(32 // size)
+                        ]
+                        self.assertEqual(list(arr), expected)
+
+                self.assertEqual(len(map.read_array(0, 0)), 0)
+
+                # The array is a plain buffer of host endian values
+                self.assertEqual(memoryview(map.read_array(0, 2, 2)).nbytes, 4)
+
+    def test_write_array(self):
+        for map in self.open_maps(rw.MapMode.ReadWrite):
+            with self.subTest(native=map._native is not None), map:
+                map.write_array(0, [0x11223344, 0x55667788])
+                self.assertEqual(map.read(0), 0x11223344)
+                self.assertEqual(map.read(4), 0x55667788)
+
+                map.write_array(8, array.array('H', [0x1234, 0x5678]), 2, rw.Endianness.Little)
+                self.assertEqual(map.read(8, 2, rw.Endianness.Little), 0x1234)
+                self.assertEqual(map.read(10, 2, rw.Endianness.Little), 0x5678)
+
+                values = list(range(0x0102030405060708, 0x0102030405060708 + 4))
+                map.write_array(32, values, 8)
+                self.assertEqual(list(map.read_array(32, 4, 8)), values)
+
+    def test_array_failures(self):
+        for map in self.open_maps(rw.MapMode.Read):
+            with self.subTest(native=map._native is not None), map:
+                with self.assertRaises(RuntimeError):
+                    map.read_array(60, 2)
+
+                with self.assertRaises(RuntimeError):
+                    map.read_array(-4, 1)
+
+                with self.assertRaises(ValueError):
+                    map.read_array(0, 2, 3)
+
+                with self.assertRaises(RuntimeError):
+                    map.write_array(0, [1])
+
+        for map in self.open_maps(rw.MapMode.ReadWrite):
+            with self.subTest(native=map._native is not None), map:
+                with self.assertRaises(RuntimeError):
+                    map.write_array(60, [1, 2])
+
+                with self.assertRaises(OverflowError):
+                    map.write_array(0, [0x100], 1)
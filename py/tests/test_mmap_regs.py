@@ -5,6 +5,7 @@ import shutil
 import stat
 import tempfile
 import unittest
+from unittest import mock
 import rwmem as rw
 
 REGS_PATH = os.path.dirname(os.path.abspath(__file__)) + '/test.regdb'
@@ -125,3 +126,121 @@ class WriteMmapRegsTests(unittest.TestCase):
             self.assertNotEqual(x, y)
             # But should have some unchanged regions
             self.assertGreater(len(matching), 1)
+
+
+class TransactionTests(unittest.TestCase):
+    def setUp(self):
+        self.rf = rw.RegisterFile(REGS_PATH)
+
+        self.tmpfile = tempfile.NamedTemporaryFile(mode='w+b', suffix='.bin', delete=True)
+        self.tmpfile_path = self.tmpfile.name
+
+        shutil.copy2(BIN_PATH, self.tmpfile_path)
+        os.chmod(self.tmpfile_path, stat.S_IREAD | stat.S_IWRITE)
+
+        self.map = rw.MappedRegisterBlock(
+            self.tmpfile_path, self.rf['SENSOR_A'], mode=rw.MapMode.ReadWrite
+        )
+
+    def read_file(self):
+        with open(self.tmpfile_path, 'rb') as f:
+            return f.read()
+
+    def test_get_fields_does_not_write(self):
+        m = self.map
+
+        with mock.patch.object(m._map, 'write', wraps=m._map.write) as write:
+            fields = m['STATUS_REG'].get_fields()
+            self.assertEqual(fields, {'MODE': 0x7, 'ERROR': 0x0, 'READY': 0x1})
+            write.assert_not_called()
+
+    def test_commit(self):
+        m = self.map
+        orig = self.read_file()
+
+        with mock.patch.object(m._map, 'write', wraps=m._map.write) as write:
+            with m.transaction() as t:
+                self.assertIs(t, m)
+                self.assertEqual(m['CONFIG_REG'].value, 0x344772)
+
+                m['CONFIG_REG']['GAIN'] = 0x11
+                m['STATUS_REG']['MODE'] = 0x1F
+                m['STATUS_REG']['READY'] = 0
+                m['DATA_REG'].set_value(0x1234)
+
+                # Visible in the transaction, but not written yet
+                self.assertEqual(m['STATUS_REG'].value, 0xF8)
+                self.assertEqual(m['CONFIG_REG'].value, 0x341172)
+                self.assertEqual(self.read_file(), orig)
+                write.assert_not_called()
+
+            # One write per dirty register, in offset order
+            self.assertEqual([c.args[0] for c in write.call_args_list], [0x0, 0x2, 0x4])
+
+        self.assertEqual(m['STATUS_REG'].value, 0xF8)
+        self.assertEqual(m['DATA_REG'].value, 0x1234)
+        self.assertEqual(m['CONFIG_REG'].value, 0x341172)
+        self.assertEqual(m['COUNTER_REG'].value, 0x2F0F10D8)
+
+    def test_exception_discards(self):
+        m = self.map
+        orig = self.read_file()
+
+        with self.assertRaises(ValueError):
+            with m.transaction():
+                m['STATUS_REG'].set_value(0)
+                raise ValueError()
+
+        self.assertEqual(self.read_file(), orig)
+        self.assertEqual(m['STATUS_REG'].value, 0x39)
+
+        # A new transaction can be started afterwards
+        with m.transaction():
+            m['STATUS_REG'].set_value(0)
+        self.assertEqual(m['STATUS_REG'].value, 0)
+
+    def test_nested(self):
+        with self.map.transaction():
+            with self.assertRaises(RuntimeError):
+                with self.map.transaction():
+                    pass
+
+    def test_overflow(self):
+        with self.map.transaction():
+            with self.assertRaises(OverflowError):
+                self.map['STATUS_REG'].set_value(0x100)
+
+    def test_verify(self):
+        m = self.map
+
+        with m.transaction(verify=True):
+            m['COUNTER_REG'].set_value(0x12345678)
+        self.assertEqual(m['COUNTER_REG'].value, 0x12345678)
+
+        # Simulate a register that does not keep the written value
+        with mock.patch.object(m._map, 'read', wraps=m._map.read) as read:
+            with self.assertRaises(RuntimeError):
+                with m.transaction(verify=True):
+                    m['COUNTER_REG'].set_value(0x1)
+                    read.side_effect = None
+                    read.return_value = 0
+
+    def test_bulk_read(self):
+        mrb = rw.MappedRegisterBlock(
+            self.tmpfile_path, self.rf['MEMORY_CTRL'], mode=rw.MapMode.ReadWrite
+        )
+
+        expected = {name: mrb[name].value for name in mrb}
+
+        with mock.patch.object(mrb._map, 'read_array', wraps=mrb._map.read_array) as read_array:
+            with mrb.transaction():
+                self.assertEqual({name: mrb[name].value for name in mrb}, expected)
+
+            # STATUS_REG, DATA_LO_REG and DATA_HI_REG are read with one access each
+            read_array.assert_called_once_with(512 + 12, 3, 4)
+
+        with mrb.transaction():
+            mrb['DATA_HI_REG'].set_value(0xAABBCCDD)
+
+        self.assertEqual(mrb['DATA_HI_REG'].value, 0xAABBCCDD)
+        self.assertEqual(self.read_file()[512 + 20 : 512 + 24], bytes.fromhex('AABBCCDD'))
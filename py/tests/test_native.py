@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+
+import array
+import mmap
+import os
+import shutil
+import tempfile
+import unittest
+from unittest import mock
+
+import rwmem as rw
+from rwmem._native import native
+
+BIN_PATH = os.path.dirname(os.path.abspath(__file__)) + '/test.bin'
+REGS_PATH = os.path.dirname(os.path.abspath(__file__)) + '/test.regdb'
+
+
+@unittest.skipIf(native is None, 'native extension not available')
+class NativeParityTests(unittest.TestCase):
+    """Compare the native accelerator against the pure Python implementation"""
+
+    def test_mmap_reads(self):
+        with (
+            rw.MMapTarget(BIN_PATH, 0, 64, rw.Endianness.Big, 4, rw.MapMode.Read) as nmap,
+            mock.patch('rwmem.mmaptarget.native', None),
+        ):
+            pmap = rw.MMapTarget(BIN_PATH, 0, 64, rw.Endianness.Big, 4, rw.MapMode.Read)
+
+            self.assertIsNotNone(nmap._native)
+            self.assertIsNone(pmap._native)
+
+            for size in range(1, 9):
+                for endianness in (rw.Endianness.Default, rw.Endianness.Big, rw.Endianness.Little):
+                    for addr in range(0, 64 - size + 1, 3):
+                        self.assertEqual(
+                            nmap.read(addr, size, endianness),
+                            pmap.read(addr, size, endianness),
+                            f'addr={addr} size={size} {endianness}',
+                        )
+
+            pmap.close()
+
+    def test_mmap_writes(self):
+        with tempfile.NamedTemporaryFile(suffix='.bin') as ntmp, tempfile.NamedTemporaryFile(
+            suffix='.bin'
+        ) as ptmp:
+            shutil.copy2(BIN_PATH, ntmp.name)
+            shutil.copy2(BIN_PATH, ptmp.name)
+
+            nmap = rw.MMapTarget(ntmp.name, 0, 64, rw.Endianness.Little, 2)
+            with mock.patch('rwmem.mmaptarget.native', None):
+                pmap = rw.MMapTarget(ptmp.name, 0, 64, rw.Endianness.Little, 2)
+
+            for m in (nmap, pmap):
+                m.write(0, 0x1234)
+                m.write(2, 0x12345678, 4, rw.Endianness.Big)
+                m.write(6, 0x123456, 3, rw.Endianness.Little)
+                m.write(16, 0x0123456789ABCDEF, 8)
+                m.write(data_size=1, addr=30, value=0xFF)
+                m.close()
+
+            with open(ntmp.name, 'rb') as nf, open(ptmp.name, 'rb') as pf:
+                self.assertEqual(nf.read(), pf.read())
+
+    def test_windowed_arrays(self):
+        # A file of several windows of two pages
+        size = 16 * mmap.PAGESIZE
+        data = bytes((i * 7) & 0xFF for i in range(size))
+
+        with tempfile.NamedTemporaryFile(suffix='.bin') as tmp:
+            tmp.write(data)
+            tmp.flush()
+
+            t = native.MMapTarget(
+                tmp.name, 0, size, rw.Endianness.Little, 4, rw.MapMode.ReadWrite.value,
+                window_size=2 * mmap.PAGESIZE,
+            )
+
+            # Not at a window boundary, across all the windows but the first
+            addr = 2 * mmap.PAGESIZE + 0x100
+            arr = array.array('I', bytes(size - addr))
+            t.read_into(addr, arr)
+            self.assertEqual(arr.tobytes(), data[addr:])
+
+            arr = array.array('H', bytes((i * 3) & 0xFF for i in range(size)))
+            t.write_from(0, arr.tobytes(), 2)
+
+            back = array.array('H', bytes(size))
+            t.read_into(0, back, 2)
+            self.assertEqual(back, arr)
+
+            t.close()
+
+            with open(tmp.name, 'rb') as f:
+                self.assertEqual(f.read(), arr.tobytes())
+
+    def _compare_regfiles(self, nrf, prf):
+        self.assertEqual(list(nrf), list(prf))
+
+        for bname in prf:
+            nrb, prb = nrf[bname], prf[bname]
+            self.assertEqual(list(nrb), list(prb))
+            self.assertEqual(nrb.offset, prb.offset)
+
+            for rname in prb:
+                nr, pr = nrb[rname], prb[rname]
+                self.assertEqual(list(nr), list(pr))
+                self.assertEqual(nr.offset, pr.offset)
+                self.assertEqual(nr.description, pr.description)
+
+                for fname in pr:
+                    self.assertEqual(nr[fname].high, pr[fname].high)
+                    self.assertEqual(nr[fname].low, pr[fname].low)
+
+    def test_registerfile(self):
+        with rw.RegisterFile(REGS_PATH) as nrf, mock.patch('rwmem.registerfile.native', None):
+            with rw.RegisterFile(REGS_PATH) as prf:
+                self.assertIsNotNone(nrf._native)
+                self.assertIsNone(prf._native)
+
+                self._compare_regfiles(nrf, prf)
+
+    def test_registerfile_rejects_corrupt_data(self):
+        with open(REGS_PATH, 'rb') as f:
+            data = bytearray(f.read())
+
+        # Truncate the string pool
+        with self.assertRaises(RuntimeError):
+            rw.RegisterFile(bytes(data[:-8]))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -202,6 +202,38 @@ class DeduplicationTests(unittest.TestCase):
             self.assertEqual(list(reg_a.keys()), list(reg_b.keys()))
 
 
+class LookupTests(unittest.TestCase):
+    def setUp(self):
+        self.rf = rw.RegisterFile(REGS_PATH)
+
+    def test_lazy_index(self):
+        """Name indices are built on first use"""
+        rf = rw.RegisterFile(REGS_PATH)
+        self.assertIsNone(rf._regblock_index)
+
+        rb = rf['SENSOR_A']
+        self.assertIsNone(rb._reg_index)
+
+        reg = rb['STATUS_REG']
+        self.assertIsNone(reg._field_index)
+        self.assertEqual(len(reg), reg.num_fields)
+
+    def test_case_insensitive(self):
+        rf = self.rf
+
+        self.assertIs(rf['sensor_a'], rf['SENSOR_A'])
+        self.assertIs(rf['Sensor_A']['status_reg'], rf['SENSOR_A']['STATUS_REG'])
+
+        reg = rf['SENSOR_A']['STATUS_REG']
+        for name in reg:
+            self.assertIs(reg[name.lower()], reg[name])
+
+        self.assertIn('memory_ctrl', rf)
+
+        # Iteration gives the names as in the file
+        self.assertEqual(list(rf), ['SENSOR_A', 'SENSOR_B', 'MEMORY_CTRL'])
+
+
 class ErrorHandlingTests(unittest.TestCase):
     def setUp(self):
         self.rf = rw.RegisterFile(REGS_PATH)
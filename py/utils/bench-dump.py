@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+
+# Measure the time rwmem takes to dump a large register file with fields,
+# formatting on one thread and with the print pipeline, against a file target
+
+from __future__ import annotations
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..'))
+
+import rwmem as rw
+import rwmem.gen as gen
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--rwmem', default=os.environ.get('RWMEM_CMD', 'rwmem'), help='rwmem binary')
+parser.add_argument('--blocks', type=int, default=64)
+parser.add_argument('--regs', type=int, default=1024, help='Registers per block')
+parser.add_argument('--fields', type=int, default=8, help='Fields per register')
+parser.add_argument('--threads', default='2,4,0', help='Thread counts to compare with 1, 0 is automatic')
+parser.add_argument('--iters', '-n', type=int, default=3)
+args = parser.parse_args()
+
+
+def create_regdb(path):
+    width = 32 // args.fields
+    fields = [(f'F{i}', i * width + width - 1, i * width) for i in range(args.fields)]
+    regs = [(f'REG{r}', r * 4, fields) for r in range(args.regs)]
+    block_size = args.regs * 4
+
+    blocks = [
+        (f'BLOCK{b}', b * block_size, block_size, regs, rw.Endianness.Default, 4, rw.Endianness.Default, 4)
+        for b in range(args.blocks)
+    ]
+
+    regfile = gen.create_register_file('BENCH', blocks)
+    with open(path, 'wb') as f:
+        regfile.pack_to(f)
+
+    return args.blocks * block_size
+
+
+def run(cmd):
+    best = float('inf')
+    for _ in range(args.iters):
+        start = time.perf_counter()
+        subprocess.run(cmd, stdout=subprocess.DEVNULL, check=True)
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+with tempfile.TemporaryDirectory() as tmpdir:
+    regdb = tmpdir + '/bench.regdb'
+    data = tmpdir + '/bench.bin'
+
+    size = create_regdb(regdb)
+    with open(data, 'wb') as f:
+        f.write(os.urandom(size))
+
+    cmd = [args.rwmem, 'mmap', data, '--regs=' + regdb, '-p', 'rf', '--map', 'cached']
+    cmd += [f'BLOCK{b}' for b in range(args.blocks)]
+
+    # Warm up the page cache
+    run([*cmd, '-p', 'q'])
+
+    serial = run([*cmd, '--threads', '1'])
+
+    print(f'{args.blocks} blocks of {args.regs} registers with {args.fields} fields')
+    print(f'{"threads":>8} {"time":>10} {"speedup":>8}')
+    print(f'{1:>8} {serial * 1000:7.1f} ms {1:7.2f}x')
+
+    for threads in args.threads.split(','):
+        t = run([*cmd] if threads == '0' else [*cmd, '--threads', threads])
+        name = 'auto' if threads == '0' else threads
+        print(f'{name:>8} {t * 1000:7.1f} ms {serial / t:7.2f}x')
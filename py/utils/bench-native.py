@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+
+# Compare the per-access cost of the native accelerator and the pure Python
+# implementation
+
+from __future__ import annotations
+
+import argparse
+import array
+import os
+import time
+from unittest import mock
+
+import rwmem as rw
+from rwmem._native import native
+
+TESTS_PATH = os.path.dirname(os.path.abspath(__file__)) + '/../tests'
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--bin', default=TESTS_PATH + '/test.bin', help='File to mmap')
+parser.add_argument('--regdb', default=TESTS_PATH + '/test.regdb', help='Register file')
+parser.add_argument('--iters', '-n', type=int, default=200000)
+args = parser.parse_args()
+
+
+def timeit(func, iters):
+    start = time.perf_counter()
+    func(iters)
+    return (time.perf_counter() - start) / iters * 1e9
+
+
+def bench_read(iters):
+    with rw.MMapTarget(args.bin, 0, 64, rw.Endianness.Little, 4, rw.MapMode.Read) as m:
+        read = m.read
+        for i in range(iters):
+            read((i & 7) * 4)
+
+
+def bench_write(iters):
+    with rw.MMapTarget(tmp_path, 0, 64, rw.Endianness.Little, 4) as m:
+        write = m.write
+        for i in range(iters):
+            write((i & 7) * 4, i & 0xFFFFFFFF)
+
+
+ARRAY_SIZE = 1024 * 1024
+
+
+def bench_read_array(iters):
+    with rw.MMapTarget(tmp_path, 0, ARRAY_SIZE, rw.Endianness.Little, 4, rw.MapMode.Read) as m:
+        for _ in range(iters):
+            m.read_array(0, ARRAY_SIZE // 4)
+
+
+def bench_write_array(iters):
+    values = array.array('I', range(ARRAY_SIZE // 4))
+    with rw.MMapTarget(tmp_path, 0, ARRAY_SIZE, rw.Endianness.Little, 4) as m:
+        for _ in range(iters):
+            m.write_array(0, values)
+
+
+def walk(rf):
+    for bname in rf:
+        rb = rf[bname]
+        for rname in rb:
+            for _ in rb[rname]:
+                pass
+
+
+def bench_regfile_load(iters):
+    # Not closed explicitly, as RegisterFile.__exit__() runs a full gc.collect()
+    for _ in range(iters):
+        walk(rw.RegisterFile(args.regdb))
+
+
+def bench_regfile_lookup(iters):
+    # Open the file and look up the last register of the last block
+    rf = rw.RegisterFile(args.regdb)
+    bname = list(rf)[-1]
+    rname = list(rf[bname])[-1]
+    del rf
+
+    for _ in range(iters):
+        rw.RegisterFile(args.regdb)[bname][rname]  # pylint: disable=pointless-statement
+
+
+with open(args.bin, 'rb') as f:
+    data = f.read()
+
+tmp_path = '/tmp/rwmem-bench-native.bin'
+with open(tmp_path, 'wb') as f:
+    f.write(data.ljust(ARRAY_SIZE, b'\0'))
+
+benchmarks = [
+    ('MMapTarget.read', bench_read, args.iters),
+    ('MMapTarget.write', bench_write, args.iters),
+    ('read_array 1 MiB', bench_read_array, 10),
+    ('write_array 1 MiB', bench_write_array, 10),
+    ('RegisterFile load+walk', bench_regfile_load, args.iters // 1000 or 1),
+    ('RegisterFile open+lookup', bench_regfile_lookup, args.iters // 100 or 1),
+]
+
+print(f'native: {native.__file__ if native else "not available"}')
+print(f'{"":24} {"python":>12} {"native":>12}')
+
+for name, func, iters in benchmarks:
+    with mock.patch('rwmem.mmaptarget.native', None), mock.patch('rwmem.registerfile.native', None):
+        pure = timeit(func, iters)
+
+    fast = timeit(func, iters) if native else float('nan')
+
+    print(f'{name:24} {pure:9.0f} ns {fast:9.0f} ns')
+
+os.unlink(tmp_path)
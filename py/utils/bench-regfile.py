@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+
+# Measure the time to open a register file and look up registers in it
+
+from __future__ import annotations
+
+import argparse
+import os
+import time
+from unittest import mock
+
+import rwmem as rw
+from rwmem._native import native
+
+TESTS_PATH = os.path.dirname(os.path.abspath(__file__)) + '/../tests'
+
+parser = argparse.ArgumentParser()
+parser.add_argument('regdb', nargs='?', default=TESTS_PATH + '/test.regdb')
+parser.add_argument('--walk', action='store_true', help='Also walk all blocks, registers and fields')
+args = parser.parse_args()
+
+
+def ms(start):
+    return (time.perf_counter() - start) * 1000
+
+
+def walk(rf):
+    n = 0
+    for bname in rf:
+        rb = rf[bname]
+        for rname in rb:
+            n += len(rb[rname])
+    return n
+
+
+def run():
+    start = time.perf_counter()
+    rf = rw.RegisterFile(args.regdb)
+    t_open = ms(start)
+
+    start = time.perf_counter()
+    bname = list(rf)[-1]
+    t_blocks = ms(start)
+
+    start = time.perf_counter()
+    rb = rf[bname]
+    rname = list(rb)[-1]
+    reg = rb[rname]
+    len(reg)
+    t_lookup = ms(start)
+
+    res = [t_open, t_blocks, t_lookup]
+
+    if args.walk:
+        start = time.perf_counter()
+        walk(rf)
+        res.append(ms(start))
+
+    return res
+
+
+# Warm up the page cache
+run()
+
+names = ['open', 'list blocks', 'first lookup'] + (['walk'] if args.walk else [])
+
+with mock.patch('rwmem.registerfile.native', None):
+    pure = run()
+
+fast = run() if native else [float('nan')] * len(names)
+
+print(f'{"":16} {"python":>12} {"native":>12}')
+for name, p, f in zip(names, pure, fast):
+    print(f'{name:16} {p:9.2f} ms {f:9.2f} ms')
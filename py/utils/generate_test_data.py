@@ -6,6 +6,7 @@ Generate test data files for pyrwmem tests.
 This script generates:
 - test.bin: Binary data file with specific test values
 - test.regdb: Register database file defining register layout
+- test-overlay.regdb: Register database overlaid on test.regdb
 
 The generated files match the existing test data structure used by
 pyrwmem tests in py/tests/.
@@ -390,8 +391,70 @@ def generate_test_regs(output_path: str):
     print(f'Generated {output_path} (v3 format with comprehensive features)')
 
 
+def generate_overlay_regs(output_path: str):
+    """Generate test-overlay.regdb register database file.
+
+    Meant to be loaded on top of test.regdb:
+    - SENSOR_B block: replaces the SENSOR_B block of test.regdb
+    - BOARD_DEV block: new block in the unused space after MEMORY_CTRL
+    """
+
+    sensor_b_block = gen.UnpackedRegBlock(
+        name='SENSOR_B',
+        offset=0x100,
+        size=0x100,
+        regs=[
+            gen.UnpackedRegister(
+                'ID_REG',
+                0x00,
+                [
+                    gen.UnpackedField('VERSION', 7, 0, 'Device version'),
+                ],
+                'Device ID register',
+            ),
+        ],
+        addr_endianness=rw.Endianness.Little,
+        addr_size=1,
+        data_endianness=rw.Endianness.Little,
+        data_size=4,
+        description='Sensor B, board revision',
+    )
+
+    board_dev_block = gen.UnpackedRegBlock(
+        name='BOARD_DEV',
+        offset=0x280,
+        size=0x80,
+        regs=[
+            gen.UnpackedRegister(
+                'CTRL_REG',
+                0x00,
+                [
+                    gen.UnpackedField('EN', 0, 0, 'Enable'),
+                ],
+                'Board device control',
+            ),
+        ],
+        addr_endianness=rw.Endianness.Little,
+        addr_size=4,
+        data_endianness=rw.Endianness.Little,
+        data_size=4,
+        description='Board specific device',
+    )
+
+    regfile = gen.UnpackedRegFile(
+        'TEST_OVERLAY',
+        [sensor_b_block, board_dev_block],
+        'Board overlay for TEST_V3',
+    )
+
+    with open(output_path, 'wb') as f:
+        regfile.pack_to(f)
+
+    print(f'Generated {output_path} (overlay for test.regdb)')
+
+
 def main():
-    """Generate both test.bin and test.regdb files."""
+    """Generate test.bin, test.regdb and test-overlay.regdb files."""
 
     # Determine output directory (py/tests/)
     script_dir = os.path.dirname(os.path.abspath(__file__))
@@ -399,6 +462,7 @@ def main():
 
     bin_path = os.path.join(tests_dir, 'test.bin')
     regs_path = os.path.join(tests_dir, 'test.regdb')
+    overlay_path = os.path.join(tests_dir, 'test-overlay.regdb')
 
     print('Generating test data files...')
     print(f'Output directory: {tests_dir}')
@@ -406,6 +470,7 @@ def main():
     # Generate files
     generate_test_bin(bin_path)
     generate_test_regs(regs_path)
+    generate_overlay_regs(overlay_path)
 
     print('\nTest data generation complete!')
     print('\nGenerated file contents:')
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include <sched.h>
+
+#include "rwmem.h"
+#include "helpers.h"
+
+using namespace std;
+
+// Each bandwidth measurement runs for at least this long, after a warmup pass
+static const double min_secs = 0.1;
+// At most this many random offsets, and latency samples
+static const size_t max_random = 1024 * 1024;
+static const size_t latency_samples = 10000;
+
+static const char* map_type_name(MapType type)
+{
+	switch (type) {
+	case MapType::Uncached:
+		return "uc";
+	case MapType::WriteCombine:
+		return "wc";
+	case MapType::Cached:
+		return "cached";
+	}
+
+	return "?";
+}
+
+// Pin to the CPU, or to the current one if negative. Returns the CPU.
+static int pin_cpu(int cpu)
+{
+	if (cpu < 0) {
+		cpu = sched_getcpu();
+		ERR_ON(cpu < 0, "Failed to get the current CPU: {}", strerror(errno));
+	}
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	ERR_ON(sched_setaffinity(0, sizeof(set), &set) != 0, "Failed to pin to CPU {}: {}", cpu, strerror(errno));
+
+	return cpu;
+}
+
+// Run pass() until min_secs has passed, after a warmup pass. Returns MiB/s.
+template<typename F>
+static double measure_bandwidth(F pass, uint64_t bytes_per_pass)
+{
+	pass();
+
+	uint64_t passes = 0;
+	double secs;
+
+	auto start = chrono::steady_clock::now();
+
+	do {
+		pass();
+		++passes;
+		secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	} while (secs < min_secs);
+
+	return (double)bytes_per_pass * passes / secs / (1024 * 1024);
+}
+
+struct Latencies {
+	double min, p50, p90, p99, max;
+};
+
+// Time single random reads. The cost of reading the clock, measured the same
+// way without the read, is subtracted.
+static Latencies measure_latency(MMapTarget& mm, const MMapAccessor& acc, const vector<uint64_t>& offsets)
+{
+	const size_t n = min(latency_samples, offsets.size());
+	vector<double> samples(n);
+	uint64_t sum = 0;
+
+	auto time_loop = [&](bool access) {
+		for (size_t i = 0; i < n; ++i) {
+			auto t0 = chrono::steady_clock::now();
+			if (access)
+				sum += mm.read_unchecked(acc, offsets[i]);
+			auto t1 = chrono::steady_clock::now();
+			samples[i] = chrono::duration<double, nano>(t1 - t0).count();
+		}
+
+		sort(samples.begin(), samples.end());
+	};
+
+	time_loop(false);
+	const double overhead = samples[n / 2];
+
+	// Warmup, then the measurement
+	time_loop(true);
+	time_loop(true);
+
+	// Keep the reads from being optimized away
+	if (sum == 1)
+		rwmem_vprint("\n");
+
+	auto at = [&](double p) { return max(samples[min(n - 1, (size_t)(p * n))] - overhead, 0.0); };
+
+	return { at(0), at(0.5), at(0.9), at(0.99), at(1) };
+}
+
+void bench(RwmemSession& session)
+{
+	RwmemOp op;
+	RwmemMapping mapping;
+
+	try {
+		op = session.parse_op(rwmem_opts.parsed_args[0]);
+		mapping = session.map_range(op, 0, rwmem_opts.bench_writes ? MapMode::ReadWrite : MapMode::Read);
+	} catch (const runtime_error& e) {
+		ERR("{}", e.what());
+	}
+
+	MMapTarget* mm = session.mmap_target();
+	ERR_ON(!mm, "bench needs an mmap target");
+
+	const int cpu = pin_cpu(rwmem_opts.bench_cpu);
+
+	const uint64_t base = mapping.offset;
+	// The accesses are unchecked, so a windowed mapping, e.g. of a large
+	// region on a 32-bit system, is measured in the window at the start
+	const uint64_t len = mm->window_len(base, mapping.length);
+
+	vector<uint8_t> widths = { 1, 2, 4, 8 };
+	if (rwmem_opts.user_data_size)
+		widths = { rwmem_opts.data_size };
+
+	print("Region {:#x}+{:#x}, {} mapping, CPU {}\n", base, mapping.length, map_type_name(mapping.type), cpu);
+
+	if (len < mapping.length)
+		print("The region does not fit in the map window, measuring the first {:#x} bytes\n", len);
+
+	print("Bandwidth, MiB/s:\n");
+	print("  width  {:>10} {:>10} {:>10} {:>10}\n", "seq read", "rand read", "seq write", "rand write");
+
+	mt19937_64 rng(1);
+	vector<Latencies> latencies;
+	uint64_t sum = 0;
+
+	for (uint8_t width : widths) {
+		const uint64_t count = len / width;
+		ERR_ON(count == 0, "Region is smaller than the width {}", width);
+
+		const MMapAccessor acc = mm->accessor(width, Endianness::Little);
+		mm->validate_range(base, count * width, rwmem_opts.bench_writes);
+
+		// Random element offsets, precomputed so that the generation is not timed
+		vector<uint64_t> offsets(min<uint64_t>(count, max_random));
+		uniform_int_distribution<uint64_t> dist(0, count - 1);
+		for (uint64_t& o : offsets)
+			o = base + dist(rng) * width;
+
+		auto seq_read = [&] {
+			for (uint64_t addr = base; addr < base + count * width; addr += width)
+				sum += mm->read_unchecked(acc, addr);
+		};
+
+		auto rand_read = [&] {
+			for (uint64_t addr : offsets)
+				sum += mm->read_unchecked(acc, addr);
+		};
+
+		auto seq_write = [&] {
+			for (uint64_t addr = base; addr < base + count * width; addr += width)
+				mm->write_unchecked(acc, addr, addr);
+		};
+
+		auto rand_write = [&] {
+			for (uint64_t addr : offsets)
+				mm->write_unchecked(acc, addr, addr);
+		};
+
+		const uint64_t seq_bytes = count * width;
+		const uint64_t rand_bytes = offsets.size() * width;
+
+		const double seq_rd = measure_bandwidth(seq_read, seq_bytes);
+		const double rand_rd = measure_bandwidth(rand_read, rand_bytes);
+
+		print("  {:>3}    {:10.1f} {:10.1f}", width * 8, seq_rd, rand_rd);
+
+		if (rwmem_opts.bench_writes) {
+			const double seq_wr = measure_bandwidth(seq_write, seq_bytes);
+			const double rand_wr = measure_bandwidth(rand_write, rand_bytes);
+
+			print(" {:10.1f} {:10.1f}\n", seq_wr, rand_wr);
+		} else {
+			print(" {:>10} {:>10}\n", "-", "-");
+		}
+
+		latencies.push_back(measure_latency(*mm, acc, offsets));
+	}
+
+	print("Random read latency, ns:\n");
+	print("  width  {:>8} {:>8} {:>8} {:>8} {:>8}\n", "min", "p50", "p90", "p99", "max");
+
+	for (size_t i = 0; i < widths.size(); ++i) {
+		const Latencies& l = latencies[i];
+		print("  {:>3}    {:8.1f} {:8.1f} {:8.1f} {:8.1f} {:8.1f}\n", widths[i] * 8, l.min, l.p50, l.p90,
+		      l.p99, l.max);
+	}
+
+	// Keep the reads from being optimized away
+	if (sum == 1)
+		rwmem_vprint("\n");
+}
@@ -5,6 +5,7 @@
 #include <cstring>
 #include <unistd.h>
 #include <charconv>
+#include <sched.h>
 
 #include "rwmem.h"
 #include "helpers.h"
@@ -27,6 +28,18 @@ enum OptId {
 	OPT_RAW,
 	OPT_IGNORE_BASE,
 	OPT_VERBOSE,
+	OPT_CACHE,
+	OPT_MAP,
+	OPT_MMAP,
+	OPT_DIRECT,
+	OPT_CPU,
+	OPT_WRITES,
+	OPT_LATENCY,
+	OPT_SNAPSHOT,
+	OPT_THREADS,
+	OPT_WINDOW,
+	OPT_FILE,
+	OPT_IO_URING,
 };
 
 // Mmap options
@@ -39,6 +52,28 @@ static const std::vector<OptDef> mmap_opts = {
 	{ OPT_REGS, 'r', "regs", ArgReq::REQUIRED },
 	{ OPT_RAW, 'R', "raw", ArgReq::NONE },
 	{ OPT_IGNORE_BASE, '\0', "ignore-base", ArgReq::NONE },
+	{ OPT_MAP, '\0', "map", ArgReq::REQUIRED },
+	{ OPT_WINDOW, '\0', "window", ArgReq::REQUIRED },
+	{ OPT_LATENCY, '\0', "latency", ArgReq::REQUIRED },
+	{ OPT_SNAPSHOT, '\0', "snapshot", ArgReq::NONE },
+	{ OPT_THREADS, '\0', "threads", ArgReq::REQUIRED },
+	{ OPT_VERBOSE, 'v', "verbose", ArgReq::NONE },
+};
+
+// File options, as mmap but without the mapping options
+static const std::vector<OptDef> file_opts = {
+	{ OPT_HELP, 'h', "help", ArgReq::NONE },
+	{ OPT_DATA, 'd', "data", ArgReq::REQUIRED },
+	{ OPT_WRITE, 'w', "write", ArgReq::REQUIRED },
+	{ OPT_PRINT, 'p', "print", ArgReq::REQUIRED },
+	{ OPT_FORMAT, 'f', "format", ArgReq::REQUIRED },
+	{ OPT_REGS, 'r', "regs", ArgReq::REQUIRED },
+	{ OPT_RAW, 'R', "raw", ArgReq::NONE },
+	{ OPT_IGNORE_BASE, '\0', "ignore-base", ArgReq::NONE },
+	{ OPT_LATENCY, '\0', "latency", ArgReq::REQUIRED },
+	{ OPT_SNAPSHOT, '\0', "snapshot", ArgReq::NONE },
+	{ OPT_THREADS, '\0', "threads", ArgReq::REQUIRED },
+	{ OPT_IO_URING, '\0', "io-uring", ArgReq::NONE },
 	{ OPT_VERBOSE, 'v', "verbose", ArgReq::NONE },
 };
 
@@ -53,6 +88,39 @@ static const std::vector<OptDef> i2c_opts = {
 	{ OPT_REGS, 'r', "regs", ArgReq::REQUIRED },
 	{ OPT_RAW, 'R', "raw", ArgReq::NONE },
 	{ OPT_IGNORE_BASE, '\0', "ignore-base", ArgReq::NONE },
+	{ OPT_LATENCY, '\0', "latency", ArgReq::REQUIRED },
+	{ OPT_SNAPSHOT, '\0', "snapshot", ArgReq::NONE },
+	{ OPT_VERBOSE, 'v', "verbose", ArgReq::NONE },
+};
+
+// Load and save options
+static const std::vector<OptDef> transfer_opts = {
+	{ OPT_HELP, 'h', "help", ArgReq::NONE },
+	{ OPT_DATA, 'd', "data", ArgReq::REQUIRED },
+	{ OPT_PRINT, 'p', "print", ArgReq::REQUIRED },
+	{ OPT_REGS, 'r', "regs", ArgReq::REQUIRED },
+	{ OPT_IGNORE_BASE, '\0', "ignore-base", ArgReq::NONE },
+	{ OPT_MAP, '\0', "map", ArgReq::REQUIRED },
+	{ OPT_WINDOW, '\0', "window", ArgReq::REQUIRED },
+	{ OPT_MMAP, '\0', "mmap", ArgReq::REQUIRED },
+	{ OPT_FILE, '\0', "file", ArgReq::REQUIRED },
+	{ OPT_IO_URING, '\0', "io-uring", ArgReq::NONE },
+	{ OPT_DIRECT, '\0', "direct", ArgReq::NONE },
+	{ OPT_THREADS, '\0', "threads", ArgReq::REQUIRED },
+	{ OPT_VERBOSE, 'v', "verbose", ArgReq::NONE },
+};
+
+// Bench options
+static const std::vector<OptDef> bench_opts = {
+	{ OPT_HELP, 'h', "help", ArgReq::NONE },
+	{ OPT_DATA, 'd', "data", ArgReq::REQUIRED },
+	{ OPT_REGS, 'r', "regs", ArgReq::REQUIRED },
+	{ OPT_IGNORE_BASE, '\0', "ignore-base", ArgReq::NONE },
+	{ OPT_MAP, '\0', "map", ArgReq::REQUIRED },
+	{ OPT_WINDOW, '\0', "window", ArgReq::REQUIRED },
+	{ OPT_MMAP, '\0', "mmap", ArgReq::REQUIRED },
+	{ OPT_CPU, '\0', "cpu", ArgReq::REQUIRED },
+	{ OPT_WRITES, '\0', "writes", ArgReq::NONE },
 	{ OPT_VERBOSE, 'v', "verbose", ArgReq::NONE },
 };
 
@@ -61,6 +129,15 @@ static const std::vector<OptDef> list_opts = {
 	{ OPT_HELP, 'h', "help", ArgReq::NONE },
 	{ OPT_REGS, 'r', "regs", ArgReq::REQUIRED },
 	{ OPT_PRINT, 'p', "print", ArgReq::REQUIRED },
+	{ OPT_THREADS, '\0', "threads", ArgReq::REQUIRED },
+	{ OPT_VERBOSE, 'v', "verbose", ArgReq::NONE },
+};
+
+// Complete options
+static const std::vector<OptDef> complete_opts = {
+	{ OPT_HELP, 'h', "help", ArgReq::NONE },
+	{ OPT_REGS, 'r', "regs", ArgReq::REQUIRED },
+	{ OPT_CACHE, '\0', "cache", ArgReq::NONE },
 	{ OPT_VERBOSE, 'v', "verbose", ArgReq::NONE },
 };
 
@@ -68,8 +145,13 @@ static void print_help()
 {
 	fputs("usage: rwmem [options] <address>[:field][=value] ...\n"
 	      "       rwmem mmap <file> [options] <address>[:field][=value] ...\n"
+	      "       rwmem file <file> [options] <address>[:field][=value] ...\n"
 	      "       rwmem i2c <bus>:<addr> [options] <address>[:field][=value] ...\n"
+	      "       rwmem load [options] <file> <address>\n"
+	      "       rwmem save [options] <address> <file>\n"
+	      "       rwmem bench [options] <address>\n"
 	      "       rwmem list [options] [pattern] ...\n"
+	      "       rwmem complete [options] [prefix]\n"
 	      "\n"
 	      "address:\n"
 	      "  <address>                  single address\n"
@@ -85,11 +167,11 @@ static void print_help()
 	      "\n"
 	      "Options:\n"
 	      "  -h, --help                 show this help\n"
-	      "  -d, --data <size>[endian]  data access size (mmap, i2c)\n"
+	      "  -d, --data <size>[endian]  data access size (mmap, file, i2c)\n"
 	      "                             size: 8-64 bits, multiple of 8\n"
 	      "                             endian: be, le, bes, les\n"
 	      "  -a, --addr <size>[endian]  address size (i2c only)\n"
-	      "  -w, --write <mode>         write mode (mmap, i2c):\n"
+	      "  -w, --write <mode>         write mode (mmap, file, i2c):\n"
 	      "                             w   - write only\n"
 	      "                             rw  - read-write\n"
 	      "                             rwr - read-write-read (default)\n"
@@ -101,73 +183,40 @@ static void print_help()
 	      "                             x - hexadecimal (default)\n"
 	      "                             b - binary\n"
 	      "                             d - decimal\n"
-	      "  -r, --regs <file>          register description file\n"
-	      "  -R, --raw                  raw output mode (mmap, i2c)\n"
-	      "  --ignore-base              ignore base from register file (mmap, i2c)\n"
+	      "  -r, --regs <file>          register description file, can be given\n"
+	      "                             multiple times to overlay files\n"
+	      "  -R, --raw                  raw output mode (mmap, file, i2c)\n"
+	      "  --ignore-base              ignore base from register file (mmap, file,\n"
+	      "                             i2c)\n"
+	      "  --map <type>               mapping type (mmap):\n"
+	      "                             uc     - uncached, for registers (default)\n"
+	      "                             wc     - write-combining, for RAM\n"
+	      "                             cached - cached, flushed before reads\n"
+	      "  --window <size>            map at most size bytes at a time (mmap, load,\n"
+	      "                             save, bench), 0 maps whole ranges. Default:\n"
+	      "                             256 MiB on 32-bit systems, 0 on 64-bit ones\n"
+	      "  --latency <by>             time the accesses, print histograms at exit\n"
+	      "                             (mmap, file, i2c), by: reg or block\n"
+	      "  --snapshot                 do all the accesses before printing (mmap,\n"
+	      "                             file, i2c)\n"
+	      "  --threads <n>              threads formatting the output (mmap, file),\n"
+	      "                             saving wc and cached mappings (save), or\n"
+	      "                             matching the registers (list). Default: all\n"
+	      "                             CPUs for large dumps and saves, up to 8 for\n"
+	      "                             large register files\n"
+	      "  --mmap <file>              file to map (load, save, bench), default /dev/mem\n"
+	      "  --file <file>              file to access with pread and pwrite instead of\n"
+	      "                             mapping it (load, save)\n"
+	      "  --io-uring                 batch the range accesses of the file with\n"
+	      "                             io_uring (file, load, save)\n"
+	      "  --cpu <cpu>                CPU to run on (bench), default the current one\n"
+	      "  --writes                   also measure writes, overwriting the region (bench)\n"
+	      "  --direct                   use O_DIRECT for the file (load, save)\n"
+	      "  --cache                    cache the name index in ~/.rwmem/cache (complete)\n"
 	      "  -v, --verbose              verbose output\n",
 	      stdout);
 }
 
-static void parse_arg(string str, RwmemOptsArg* arg)
-{
-	size_t idx;
-
-	// extract value
-
-	idx = str.find('=');
-
-	if (idx != string::npos) {
-		arg->value = str.substr(idx + 1);
-		str.resize(idx);
-
-		if (arg->value.empty())
-			throw runtime_error("Empty value not allowed");
-	}
-
-	// extract field
-
-	idx = str.find(':');
-
-	if (idx != string::npos) {
-		arg->field = str.substr(idx + 1);
-		str.resize(idx);
-
-		if (arg->field.empty())
-			throw runtime_error("Empty field not allowed");
-	}
-
-	// extract len
-
-	idx = str.find('+');
-
-	if (idx != string::npos) {
-		arg->range = str.substr(idx + 1);
-		arg->range_is_offset = true;
-		str.resize(idx);
-
-		if (arg->range.empty())
-			throw runtime_error("Empty range not allowed");
-	} else {
-		// extract end
-
-		idx = str.find('-');
-
-		if (idx != string::npos) {
-			arg->range = str.substr(idx + 1);
-			arg->range_is_offset = false;
-			str.resize(idx);
-
-			if (arg->range.empty())
-				throw runtime_error("Empty range not allowed");
-		}
-	}
-
-	arg->address = str;
-
-	if (arg->address.empty())
-		throw runtime_error("Empty address not allowed");
-}
-
 static void parse_size_endian(string_view s, uint32_t* size, Endianness* e)
 {
 	auto start = s.begin();
@@ -203,13 +252,14 @@ static void parse_size_endian(string_view s, uint32_t* size, Endianness* e)
 }
 
 // Pass 1: Normalize arguments for default mode
-static void normalize_args_for_default_mode(std::vector<std::string>& args)
+static void normalize_args_for_default_mode(std::vector<std::string_view>& args)
 {
 	// If the first positional is an explicit subcommand, nothing to do
 	for (size_t i = 1; i < args.size(); i++) {
-		if (args[i][0] != '-') {
-			const string& cmd = args[i];
-			if (cmd == "mmap" || cmd == "i2c" || cmd == "list")
+		if (!args[i].starts_with('-')) {
+			string_view cmd = args[i];
+			if (cmd == "mmap" || cmd == "file" || cmd == "i2c" || cmd == "load" || cmd == "save" ||
+			    cmd == "bench" || cmd == "list" || cmd == "complete")
 				return;
 			break;
 		}
@@ -221,7 +271,7 @@ static void normalize_args_for_default_mode(std::vector<std::string>& args)
 	args.insert(args.begin() + 1, "mmap");
 }
 
-void parse_cmdline(const std::vector<std::string>& args)
+void parse_cmdline(const std::vector<std::string_view>& args)
 {
 	// Show help if no arguments
 	if (args.size() == 1) {
@@ -239,7 +289,7 @@ void parse_cmdline(const std::vector<std::string>& args)
 		}
 
 		// Pass 1: Normalize arguments for default mode
-		std::vector<std::string> mutable_args(args);
+		std::vector<std::string_view> mutable_args(args);
 		normalize_args_for_default_mode(mutable_args);
 
 		// Pass 2: Full parsing
@@ -255,8 +305,9 @@ void parse_cmdline(const std::vector<std::string>& args)
 		string subcommand = string(cmd_arg->positional);
 
 		// Variables for option parsing
-		string data_size_str, addr_size_str, write_mode_str, print_mode_str, format_str;
-		vector<string> op_strs;
+		string data_size_str, addr_size_str, write_mode_str, print_mode_str, format_str, map_str;
+		// The ops refer to argv, which stays alive
+		vector<string_view> op_strs;
 		bool help_requested = false;
 
 		// Parse subcommand argument and set mode
@@ -270,6 +321,14 @@ void parse_cmdline(const std::vector<std::string>& args)
 			rwmem_opts.target_type = TargetType::MMap;
 			rwmem_opts.mmap_target = string(file_arg->positional);
 			opts = mmap_opts;
+		} else if (subcommand == "file") {
+			auto file_arg = parser.get_next(file_opts);
+			if (!file_arg || file_arg->type != ArgType::POSITIONAL) {
+				throw runtime_error("file requires file argument");
+			}
+			rwmem_opts.target_type = TargetType::File;
+			rwmem_opts.file_target = string(file_arg->positional);
+			opts = file_opts;
 		} else if (subcommand == "i2c") {
 			auto param_arg = parser.get_next(i2c_opts);
 			if (!param_arg || param_arg->type != ArgType::POSITIONAL) {
@@ -293,9 +352,18 @@ void parse_cmdline(const std::vector<std::string>& args)
 				throw runtime_error("Invalid I2C address '" + strs[1] + "'. Must be a number");
 			}
 			opts = i2c_opts;
+		} else if (subcommand == "load" || subcommand == "save") {
+			rwmem_opts.transfer = subcommand == "load" ? Transfer::Load : Transfer::Save;
+			opts = transfer_opts;
+		} else if (subcommand == "bench") {
+			rwmem_opts.run_bench = true;
+			opts = bench_opts;
 		} else if (subcommand == "list") {
 			rwmem_opts.show_list = true;
 			opts = list_opts;
+		} else if (subcommand == "complete") {
+			rwmem_opts.show_complete = true;
+			opts = complete_opts;
 		} else {
 			throw runtime_error("Unknown subcommand: " + subcommand);
 		}
@@ -327,7 +395,7 @@ void parse_cmdline(const std::vector<std::string>& args)
 					format_str = string(arg->option_value);
 					break;
 				case OPT_REGS:
-					rwmem_opts.regfile = string(arg->option_value);
+					rwmem_opts.regfiles.push_back(string(arg->option_value));
 					break;
 				case OPT_RAW:
 					rwmem_opts.raw_output = true;
@@ -338,12 +406,69 @@ void parse_cmdline(const std::vector<std::string>& args)
 				case OPT_VERBOSE:
 					rwmem_opts.verbose = true;
 					break;
+				case OPT_CACHE:
+					rwmem_opts.use_cache = true;
+					break;
+				case OPT_MAP:
+					map_str = string(arg->option_value);
+					break;
+				case OPT_MMAP:
+					rwmem_opts.target_type = TargetType::MMap;
+					rwmem_opts.mmap_target = string(arg->option_value);
+					break;
+				case OPT_FILE:
+					rwmem_opts.target_type = TargetType::File;
+					rwmem_opts.file_target = string(arg->option_value);
+					break;
+				case OPT_IO_URING:
+					rwmem_opts.file_io_uring = true;
+					break;
+				case OPT_DIRECT:
+					rwmem_opts.direct_io = true;
+					break;
+				case OPT_CPU: {
+					uint64_t cpu;
+					if (parse_u64(arg->option_value, &cpu) != 0 || cpu >= CPU_SETSIZE)
+						throw runtime_error("Invalid CPU '" + string(arg->option_value) + "'");
+					rwmem_opts.bench_cpu = (int)cpu;
+					break;
+				}
+				case OPT_LATENCY:
+					if (arg->option_value == "reg")
+						rwmem_opts.latency = LatencyMode::Register;
+					else if (arg->option_value == "block")
+						rwmem_opts.latency = LatencyMode::Block;
+					else
+						throw runtime_error("Invalid latency grouping '" + string(arg->option_value) +
+								    "'. Valid: reg, block");
+					break;
+				case OPT_SNAPSHOT:
+					rwmem_opts.snapshot = true;
+					break;
+				case OPT_WINDOW: {
+					uint64_t size;
+					if (parse_u64(arg->option_value, &size) != 0)
+						throw runtime_error("Invalid window size '" + string(arg->option_value) + "'");
+					rwmem_opts.user_map_window = true;
+					rwmem_opts.map_window = size;
+					break;
+				}
+				case OPT_THREADS: {
+					uint64_t n;
+					if (parse_u64(arg->option_value, &n) != 0 || n == 0 || n > 1024)
+						throw runtime_error("Invalid thread count '" + string(arg->option_value) + "'");
+					rwmem_opts.num_threads = (unsigned)n;
+					break;
+				}
+				case OPT_WRITES:
+					rwmem_opts.bench_writes = true;
+					break;
 				}
 			} else if (arg->type == ArgType::POSITIONAL) {
 				if (rwmem_opts.show_list) {
 					rwmem_opts.list_patterns.push_back(string(arg->positional));
 				} else {
-					op_strs.push_back(string(arg->positional));
+					op_strs.push_back(arg->positional);
 				}
 			}
 		}
@@ -384,6 +509,11 @@ void parse_cmdline(const std::vector<std::string>& args)
 				throw runtime_error("illegal write mode '" + write_mode_str + "'");
 		}
 
+		if (!map_str.empty()) {
+			rwmem_opts.map_type = parse_map_type(map_str);
+			rwmem_opts.user_map_type = true;
+		}
+
 		if (!print_mode_str.empty()) {
 			if (print_mode_str == "q")
 				rwmem_opts.print_mode = PrintMode::Quiet;
@@ -415,18 +545,52 @@ void parse_cmdline(const std::vector<std::string>& args)
 			}
 		}
 
+		if (rwmem_opts.show_complete) {
+			if (op_strs.size() > 1)
+				throw runtime_error("complete takes a single prefix");
+
+			if (!op_strs.empty())
+				rwmem_opts.complete_prefix = op_strs[0];
+		}
+
+		if (rwmem_opts.transfer != Transfer::None) {
+			if (op_strs.size() != 2)
+				throw runtime_error(rwmem_opts.transfer == Transfer::Load ?
+							    "load requires <file> <address>" :
+							    "save requires <address> <file>");
+
+			if (rwmem_opts.transfer == Transfer::Load)
+				swap(op_strs[0], op_strs[1]);
+
+			rwmem_opts.transfer_file = string(op_strs[1]);
+			op_strs.pop_back();
+
+			RwmemOptsArg arg = parse_op_arg(op_strs[0]);
+
+			if (!arg.field.empty() || !arg.value.empty())
+				throw runtime_error("load and save take an address without a field or value");
+		}
+
+		if (rwmem_opts.run_bench) {
+			if (op_strs.size() != 1)
+				throw runtime_error("bench requires a single <address>");
+
+			RwmemOptsArg arg = parse_op_arg(op_strs[0]);
+
+			if (!arg.field.empty() || !arg.value.empty())
+				throw runtime_error("bench takes an address without a field or value");
+		}
+
 		// Parse operation arguments
-		if (!rwmem_opts.show_list) {
+		if (!rwmem_opts.show_list && !rwmem_opts.show_complete) {
 			if (op_strs.empty())
 				throw runtime_error("No operations specified");
 
 			rwmem_opts.parsed_args.clear();
 			rwmem_opts.parsed_args.reserve(op_strs.size());
 
-			for (const string& param : op_strs) {
-				RwmemOptsArg parsed_arg;
-				parse_arg(param, &parsed_arg);
-				rwmem_opts.parsed_args.push_back(parsed_arg);
+			for (string_view param : op_strs) {
+				rwmem_opts.parsed_args.push_back(parse_op_arg(param));
 			}
 		}
 
@@ -1,5 +1,4 @@
 #include <string>
-#include <sstream>
 #include <vector>
 
 #include <cctype>
@@ -21,35 +20,6 @@ void err_vprint(std::string_view fmt, std::format_args args)
 	fputc('\n', stderr);
 }
 
-void split(const string& s, char delim, vector<string>& elems)
-{
-	stringstream ss(s);
-	string item;
-
-	while (getline(ss, item, delim))
-		elems.push_back(item);
-}
-
-vector<string> split(const string& s, char delim)
-{
-	vector<string> elems;
-	split(s, delim, elems);
-	return elems;
-}
-
-int parse_u64(const std::string& str, uint64_t* value)
-{
-	uint64_t v;
-	char* endptr;
-
-	v = strtoull(str.c_str(), &endptr, 0);
-	if (*endptr != 0)
-		return -EINVAL;
-
-	*value = v;
-	return 0;
-}
-
 int fls(uint64_t num)
 {
 	int i = 0;
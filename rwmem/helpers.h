@@ -7,6 +7,8 @@
 #include <vector>
 #include <format>
 
+#include "utils.h"
+
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
 void err_vprint(std::string_view fmt, std::format_args args);
@@ -41,13 +43,6 @@ void ERR_ON(bool condition, std::format_string<Args...> format_str, Args&&... ar
 	}
 }
 
-#define GENMASK(h, l) (((~0ULL) << (l)) & (~0ULL >> (64 - 1 - (h))))
-
-void split(const std::string& s, char delim, std::vector<std::string>& elems);
-std::vector<std::string> split(const std::string& s, char delim);
-
-int parse_u64(const std::string& str, uint64_t* value);
-
 int fls(uint64_t num);
 #define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
 
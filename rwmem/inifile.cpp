@@ -1,4 +1,5 @@
 #include <exception>
+#include <stdexcept>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
@@ -49,11 +50,28 @@ void load_opts_from_ini_pre()
 
 void detect_platform()
 {
-	if (rwmem_opts.regfile.empty()) {
+	if (rwmem_opts.regfiles.empty()) {
 		string platform = get_platform_name();
 		if (!platform.empty()) {
 			string plat_key = string("platform \"") + platform + "\"";
-			rwmem_opts.regfile = rwmem_ini.get(plat_key, "regfile", "");
+
+			// A space separated list of regfiles, later ones overlaid on the earlier
+			for (const string& regfile : split(rwmem_ini.get(plat_key, "regfile", ""), ' ')) {
+				if (!regfile.empty())
+					rwmem_opts.regfiles.push_back(regfile);
+			}
+		}
+	}
+}
+
+// [map] section: <block name> = uc|wc|cached
+void load_map_types_from_ini()
+{
+	for (const string& block : rwmem_ini.get_keys("map")) {
+		try {
+			rwmem_opts.block_map_types.emplace_back(block, parse_map_type(rwmem_ini.get("map", block)));
+		} catch (const runtime_error& e) {
+			ERR("rwmem.ini: block '{}': {}", block, e.what());
 		}
 	}
 }
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <bit>
+#include <format>
+
+#include "latency.h"
+#include "helpers.h"
+
+using namespace std;
+
+unsigned LatencyHistogram::bucket(uint64_t ns)
+{
+	if (ns < sub_buckets)
+		return ns;
+
+	// The top sub_bits + 1 bits of the value select the bucket
+	unsigned shift = bit_width(ns) - sub_bits - 1;
+	return (shift + 1) * sub_buckets + ((ns >> shift) & (sub_buckets - 1));
+}
+
+uint64_t LatencyHistogram::bucket_low(unsigned idx)
+{
+	if (idx < sub_buckets)
+		return idx;
+
+	unsigned shift = idx / sub_buckets - 1;
+	return (uint64_t)(sub_buckets | (idx % sub_buckets)) << shift;
+}
+
+uint64_t LatencyHistogram::bucket_high(unsigned idx)
+{
+	if (idx < sub_buckets)
+		return idx;
+
+	unsigned shift = idx / sub_buckets - 1;
+	return bucket_low(idx) + ((1ULL << shift) - 1);
+}
+
+void LatencyHistogram::add(uint64_t ns)
+{
+	m_buckets[bucket(ns)]++;
+	m_count++;
+	m_min = std::min(m_min, ns);
+	m_max = std::max(m_max, ns);
+	m_sum += ns;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+	if (!m_count)
+		return 0;
+
+	// The rank of the value, 1 based
+	uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p / 100 * m_count + 0.5));
+	uint64_t seen = 0;
+
+	for (unsigned idx = 0; idx < num_buckets; ++idx) {
+		seen += m_buckets[idx];
+		if (seen >= rank)
+			return std::min(bucket_high(idx), m_max);
+	}
+
+	return m_max;
+}
+
+void AccessLatencies::op_begin(const RwmemMapping& mapping)
+{
+	m_op_name = std::format("{:#x}+{:#x}", mapping.offset, mapping.length);
+}
+
+void AccessLatencies::record(const RwmemAccess& a)
+{
+	if (a.skipped)
+		return;
+
+	string name;
+
+	if (a.rd)
+		name = m_by_block ? a.rbd->name(a.rfd) : std::format("{}.{}", a.rbd->name(a.rfd), a.rd->name(a.rfd));
+	else
+		name = m_by_block ? m_op_name : std::format("{:#x}", a.address);
+
+	auto [it, inserted] = m_index.try_emplace(name, m_entries.size());
+	if (inserted)
+		m_entries.push_back({ name, {}, {} });
+
+	Entry& e = m_entries[it->second];
+
+	if (a.read)
+		e.reads.add(a.read_ns);
+	if (a.written)
+		e.writes.add(a.write_ns);
+	if (a.read_back)
+		e.reads.add(a.read_back_ns);
+}
+
+static void print_histogram(const char* kind, const LatencyHistogram& h)
+{
+	if (!h.count())
+		return;
+
+	eprint("  {:<6} n {}  min {}  mean {}  p50 {}  p90 {}  p99 {}  p99.9 {}  max {}\n", kind, h.count(), h.min(),
+	       h.mean(), h.percentile(50), h.percentile(90), h.percentile(99), h.percentile(99.9), h.max());
+
+	const auto& buckets = h.buckets();
+	const uint64_t most = *max_element(buckets.begin(), buckets.end());
+
+	for (unsigned idx = 0; idx < LatencyHistogram::num_buckets; ++idx) {
+		if (!buckets[idx])
+			continue;
+
+		unsigned bar = (unsigned)DIV_ROUND_UP(buckets[idx] * 40, most);
+
+		eprint("    {:>10} - {:<10} {:>8} {}\n", LatencyHistogram::bucket_low(idx),
+		       LatencyHistogram::bucket_high(idx), buckets[idx], string(bar, '#'));
+	}
+}
+
+void AccessLatencies::print() const
+{
+	eprint("Access latencies, ns:\n");
+
+	for (const Entry& e : m_entries) {
+		eprint("{}\n", e.name);
+		print_histogram("read", e.reads);
+		print_histogram("write", e.writes);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "session.h"
+
+/**
+ * LatencyHistogram - Log-linear histogram of durations in ns
+ *
+ * Like HDR histograms, each power of two range is split into 8 linear
+ * buckets, so the values are kept with 3 significant bits, i.e. within
+ * 12.5%, from 1 ns up to 2^63 ns in a fixed size.
+ */
+class LatencyHistogram
+{
+public:
+	void add(uint64_t ns);
+
+	uint64_t count() const { return m_count; }
+	uint64_t min() const { return m_min; }
+	uint64_t max() const { return m_max; }
+	uint64_t mean() const { return m_count ? m_sum / m_count : 0; }
+	/// The upper bound of the bucket with the percentile p (0-100)
+	uint64_t percentile(double p) const;
+
+	static constexpr unsigned sub_bits = 3;
+	static constexpr unsigned sub_buckets = 1 << sub_bits;
+	static constexpr unsigned num_buckets = (64 - sub_bits + 1) * sub_buckets;
+
+	static unsigned bucket(uint64_t ns);
+	static uint64_t bucket_low(unsigned idx);
+	static uint64_t bucket_high(unsigned idx);
+
+	const std::array<uint64_t, num_buckets>& buckets() const { return m_buckets; }
+
+private:
+	std::array<uint64_t, num_buckets> m_buckets{};
+	uint64_t m_count = 0;
+	uint64_t m_min = ~0ULL;
+	uint64_t m_max = 0;
+	uint64_t m_sum = 0;
+};
+
+/**
+ * AccessLatencies - Latencies of the timed accesses, per register or block
+ *
+ * Accesses of numeric ops are keyed by their address, or by the op range
+ * when grouping by block.
+ */
+class AccessLatencies
+{
+public:
+	explicit AccessLatencies(bool by_block) : m_by_block(by_block) {}
+
+	void op_begin(const RwmemMapping& mapping);
+	void record(const RwmemAccess& a);
+
+	/// Print the histograms to stderr
+	void print() const;
+
+private:
+	struct Entry {
+		std::string name;
+		LatencyHistogram reads;
+		LatencyHistogram writes;
+	};
+
+	bool m_by_block;
+	std::string m_op_name;
+
+	std::vector<Entry> m_entries;
+	std::unordered_map<std::string, size_t> m_index;
+};
@@ -1,5 +1,4 @@
 #include "opts.h"
-#include <cstring>
 #include <stdexcept>
 
 using namespace std;
@@ -7,8 +6,8 @@ using namespace std;
 namespace rwmem
 {
 
-ArgParser::ArgParser(const std::vector<std::string>& args)
-	: m_args(args), m_current_idx(1), m_short_opt_pos(0), m_positional_only(false) // Start at 1 to skip program name
+ArgParser::ArgParser(std::vector<std::string_view> args)
+	: m_args(std::move(args)), m_current_idx(1), m_short_opt_pos(0), m_positional_only(false) // Start at 1 to skip program name
 {
 }
 
@@ -21,14 +20,14 @@ bool ArgParser::has_more() const
 	return m_current_idx < m_args.size();
 }
 
-bool ArgParser::is_option(const char* arg) const
+bool ArgParser::is_option(string_view arg) const
 {
-	return arg[0] == '-' && arg[1] != '\0';
+	return arg.size() > 1 && arg[0] == '-';
 }
 
-bool ArgParser::is_long_option(const char* arg) const
+bool ArgParser::is_long_option(string_view arg) const
 {
-	return arg[0] == '-' && arg[1] == '-' && arg[2] != '\0';
+	return arg.size() > 2 && arg.starts_with("--");
 }
 
 const OptDef* ArgParser::find_short_opt(char opt, std::span<const OptDef> valid_opts) const
@@ -51,10 +50,10 @@ const OptDef* ArgParser::find_long_opt(string_view opt, std::span<const OptDef>
 
 ParsedArg ArgParser::parse_short_option(std::span<const OptDef> valid_opts)
 {
-	const char* arg = m_args[m_current_idx].c_str();
+	string_view arg = m_args[m_current_idx];
 
 	// Determine which character to parse (considering combined options)
-	int char_pos = (m_short_opt_pos > 0) ? m_short_opt_pos : 1;
+	size_t char_pos = (m_short_opt_pos > 0) ? m_short_opt_pos : 1;
 	char opt_char = arg[char_pos];
 
 	// Find option definition
@@ -68,20 +67,20 @@ ParsedArg ArgParser::parse_short_option(std::span<const OptDef> valid_opts)
 	// Handle argument based on requirement
 	if (opt->arg_req == ArgReq::REQUIRED) {
 		// Value could be directly after: -d32 or (in combined) -vd32
-		if (arg[char_pos + 1] != '\0') {
+		if (char_pos + 1 < arg.size()) {
 			m_current_idx++;
 			m_short_opt_pos = 0; // Reset combined mode
 			return ParsedArg{
 				.type = ArgType::OPTION,
 				.option_id = opt->id,
-				.option_value = &arg[char_pos + 1],
+				.option_value = arg.substr(char_pos + 1),
 				.positional = {},
 			};
 		}
 		// Or in next arg: -d 32
 		else if (m_current_idx + 1 < m_args.size()) {
 			m_current_idx++;
-			const char* value = m_args[m_current_idx].c_str();
+			string_view value = m_args[m_current_idx];
 			m_current_idx++;
 			m_short_opt_pos = 0;
 			return ParsedArg{
@@ -98,21 +97,21 @@ ParsedArg ArgParser::parse_short_option(std::span<const OptDef> valid_opts)
 		}
 	} else if (opt->arg_req == ArgReq::OPTIONAL) {
 		// Value only if directly after: -d32
-		if (arg[char_pos + 1] != '\0') {
+		if (char_pos + 1 < arg.size()) {
 			m_current_idx++;
 			m_short_opt_pos = 0;
 			return ParsedArg{
 				.type = ArgType::OPTION,
 				.option_id = opt->id,
-				.option_value = &arg[char_pos + 1],
+				.option_value = arg.substr(char_pos + 1),
 				.positional = {},
 			};
 		}
 		// If next arg exists and doesn't start with '-', it could be the value
 		// But only if we're not in combined mode
-		else if (m_short_opt_pos == 0 && m_current_idx + 1 < m_args.size() && m_args[m_current_idx + 1][0] != '-') {
+		else if (m_short_opt_pos == 0 && m_current_idx + 1 < m_args.size() && !m_args[m_current_idx + 1].starts_with('-')) {
 			m_current_idx++;
-			const char* value = m_args[m_current_idx].c_str();
+			string_view value = m_args[m_current_idx];
 			m_current_idx++;
 			m_short_opt_pos = 0;
 			return ParsedArg{
@@ -124,7 +123,7 @@ ParsedArg ArgParser::parse_short_option(std::span<const OptDef> valid_opts)
 		} else {
 			// No value provided, that's OK for optional
 			// Check if more combined options follow
-			if (arg[char_pos + 1] != '\0') {
+			if (char_pos + 1 < arg.size()) {
 				m_short_opt_pos = char_pos + 1; // Continue with next char
 			} else {
 				m_current_idx++;
@@ -139,7 +138,7 @@ ParsedArg ArgParser::parse_short_option(std::span<const OptDef> valid_opts)
 		}
 	} else { // ArgReq::NONE
 		// Check if more combined options follow
-		if (arg[char_pos + 1] != '\0') {
+		if (char_pos + 1 < arg.size()) {
 			// Enter or continue combined mode
 			m_short_opt_pos = char_pos + 1;
 		} else {
@@ -158,8 +157,7 @@ ParsedArg ArgParser::parse_short_option(std::span<const OptDef> valid_opts)
 
 ParsedArg ArgParser::parse_long_option(std::span<const OptDef> valid_opts)
 {
-	const char* arg = m_args[m_current_idx].c_str();
-	string_view opt_str = arg + 2; // Skip "--"
+	string_view opt_str = m_args[m_current_idx].substr(2); // Skip "--"
 
 	// Check for --option=value
 	size_t eq_pos = opt_str.find('=');
@@ -184,7 +182,7 @@ ParsedArg ArgParser::parse_long_option(std::span<const OptDef> valid_opts)
 		} else if (m_current_idx + 1 < m_args.size()) {
 			// --option value
 			m_current_idx++;
-			const char* value = m_args[m_current_idx].c_str();
+			string_view value = m_args[m_current_idx];
 			m_current_idx++;
 			return ParsedArg{
 				.type = ArgType::OPTION,
@@ -205,10 +203,10 @@ ParsedArg ArgParser::parse_long_option(std::span<const OptDef> valid_opts)
 				.option_value = opt_str.substr(eq_pos + 1),
 				.positional = {},
 			};
-		} else if (m_current_idx + 1 < m_args.size() && m_args[m_current_idx + 1][0] != '-') {
+		} else if (m_current_idx + 1 < m_args.size() && !m_args[m_current_idx + 1].starts_with('-')) {
 			// --option value (only if next doesn't start with '-')
 			m_current_idx++;
-			const char* value = m_args[m_current_idx].c_str();
+			string_view value = m_args[m_current_idx];
 			m_current_idx++;
 			return ParsedArg{
 				.type = ArgType::OPTION,
@@ -245,16 +243,16 @@ std::optional<ParsedArg> ArgParser::get_next(std::span<const OptDef> valid_opts)
 	if (m_current_idx >= m_args.size())
 		return std::nullopt;
 
-	const char* arg = m_args[m_current_idx].c_str();
+	string_view arg = m_args[m_current_idx];
 
 	// Check for end of options marker "--"
-	if (!m_positional_only && strcmp(arg, "--") == 0) {
+	if (!m_positional_only && arg == "--") {
 		m_positional_only = true;
 		m_current_idx++;
 		// Continue parsing, but all remaining are positional
 		if (m_current_idx >= m_args.size())
 			return std::nullopt;
-		arg = m_args[m_current_idx].c_str();
+		arg = m_args[m_current_idx];
 	}
 
 	// Check if it's an option (and we're not in positional-only mode)
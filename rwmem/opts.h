@@ -39,10 +39,13 @@ struct OptDef {
 };
 
 // Iterative argument parser
+//
+// The parser and the returned ParsedArgs refer to the argument strings, so
+// they must outlive them, as argv does.
 class ArgParser
 {
 public:
-	ArgParser(const std::vector<std::string>& args);
+	ArgParser(std::vector<std::string_view> args);
 	~ArgParser();
 
 	// Get next argument (option or positional)
@@ -53,13 +56,13 @@ public:
 	bool has_more() const;
 
 private:
-	std::vector<std::string> m_args;
+	std::vector<std::string_view> m_args;
 	size_t m_current_idx;
 	int m_short_opt_pos; // Position within combined short options (0 = not in combined mode)
 	bool m_positional_only; // After "--", treat all as positional
 
-	bool is_option(const char* arg) const;
-	bool is_long_option(const char* arg) const;
+	bool is_option(std::string_view arg) const;
+	bool is_long_option(std::string_view arg) const;
 
 	const OptDef* find_short_opt(char opt, std::span<const OptDef> valid_opts) const;
 	const OptDef* find_long_opt(std::string_view opt, std::span<const OptDef> valid_opts) const;
@@ -0,0 +1,418 @@
+#include <cstring>
+#include <unistd.h>
+
+#include "printer.h"
+#include "helpers.h"
+
+using namespace std;
+
+// Accesses per chunk of the print pipeline, and chunks in flight per worker
+static const size_t pipeline_chunk_accesses = 1024;
+static const size_t pipeline_chunks_per_thread = 4;
+
+static uint32_t print_chars_needed(uint32_t numbytes, NumberPrintMode mode)
+{
+	switch (mode) {
+	default:
+	case NumberPrintMode::Hex:
+		return numbytes * 2 + 2; // for hex: 2 chars per byte and "0x"
+	case NumberPrintMode::Dec:
+		// For N bytes, max value is 2^(N*8) - 1
+		// Number of decimal digits needed is floor(log10(2^(N*8) - 1)) + 1
+		// Which is approximately N * 8 * log10(2) + 1 = N * 2.408 + 1
+		return (unsigned)(numbytes * 8 * 0.30103) + 2; // log10(2) ≈ 0.30103, +2 for safety
+	case NumberPrintMode::Bin:
+		return numbytes * 8 + 2; // for bin: 8 chars per byte and "0b"
+	}
+}
+
+static void write_stdout(string& s)
+{
+	fwrite(s.data(), 1, s.size(), stdout);
+	s.clear();
+}
+
+static void print_verbose_access(const RwmemAccess& a, const RwmemFormatting& formatting)
+{
+	if (!rwmem_opts.verbose || rwmem_opts.raw_output || a.skipped)
+		return;
+
+	eprint("Accessing {:#0{}x}", a.address, formatting.address_chars);
+
+	if (a.op_offset != a.address)
+		eprint(" (+{:#{}x})", a.op_offset, formatting.offset_chars);
+
+	eprint("\n");
+}
+
+void OpFormatter::op_begin(const RwmemOp& op, const RwmemMapping& mapping)
+{
+	m_op = &op;
+
+	m_formatting.name_chars = 30;
+	m_formatting.address_chars = print_chars_needed(mapping.addr_size, NumberPrintMode::Hex);
+	m_formatting.offset_chars = DIV_ROUND_UP(fls(mapping.length), 4);
+	m_formatting.value_chars = print_chars_needed(mapping.data_size, rwmem_opts.number_print_mode);
+}
+
+void OpFormatter::access_begin(const RwmemAccess& a)
+{
+	if (a.skipped)
+		return;
+
+	const RwmemFormatting& formatting = m_formatting;
+
+	if (a.rd) {
+		string name = std::format("{}.{}", a.rbd->name(a.rfd), a.rd->name(a.rfd));
+		out("{:<{}} ", name.c_str(), formatting.name_chars);
+	}
+
+	out("{:#0{}x} ", a.address, formatting.address_chars);
+
+	if (a.op_offset != a.address)
+		out("(+{:#0{}x}) ", a.op_offset, formatting.offset_chars);
+}
+
+void OpFormatter::access_write(const RwmemAccess& a)
+{
+	if (a.read)
+		print_value("= ", a.old_value);
+
+	print_value(" := ", a.written_value);
+}
+
+void OpFormatter::access_end(const RwmemAccess& a)
+{
+	if (a.skipped)
+		return;
+
+	if (a.written) {
+		if (a.read_back)
+			print_value(" -> ", a.new_value);
+	} else if (a.read) {
+		print_value("= ", a.old_value);
+	}
+
+	out("\n");
+
+	if (rwmem_opts.print_mode != PrintMode::RegFields)
+		return;
+
+	print_fields(a);
+}
+
+void OpFormatter::access(const RwmemAccess& a)
+{
+	access_begin(a);
+
+	if (a.written)
+		access_write(a);
+
+	access_end(a);
+}
+
+void OpFormatter::print_value(const char* prefix, uint64_t v)
+{
+	switch (rwmem_opts.number_print_mode) {
+	case NumberPrintMode::Dec:
+		out("{}{:{}}", prefix, v, m_formatting.value_chars);
+		break;
+	default:
+	case NumberPrintMode::Hex:
+		out("{}{:#0{}x}", prefix, v, m_formatting.value_chars);
+		break;
+	case NumberPrintMode::Bin:
+		out("{}{:#0{}b}", prefix, v, m_formatting.value_chars);
+		break;
+	}
+}
+
+void OpFormatter::print_fields(const RwmemAccess& a)
+{
+	const RwmemOp& op = *m_op;
+
+	if (a.rd) {
+		if (op.custom_field) {
+			const FieldData* fd = a.rd->find_field(a.rfd, op.high, op.low);
+
+			print_field(op.high, op.low, a.rfd, fd, a);
+		} else {
+			for (unsigned i = 0; i < a.rd->num_fields(); ++i) {
+				const FieldData* fd = a.rd->field_at(a.rfd, i);
+
+				if (fd->high() >= op.low && fd->low() <= op.high)
+					print_field(fd->high(), fd->low(), a.rfd, fd, a);
+			}
+		}
+	} else {
+		if (op.custom_field)
+			print_field(op.high, op.low, nullptr, nullptr, a);
+	}
+}
+
+void OpFormatter::print_field(unsigned high, unsigned low, const RegisterFileData* rfd, const FieldData* fd,
+			      const RwmemAccess& a)
+{
+	const RwmemFormatting& formatting = m_formatting;
+
+	uint64_t mask = GENMASK(high, low);
+
+	uint64_t newval = (a.new_value & mask) >> low;
+	uint64_t oldval = (a.old_value & mask) >> low;
+	uint64_t userval = (a.written_value & mask) >> low;
+
+	out("  ");
+
+	if (fd)
+		out("{:<{}} ", fd->name(rfd), formatting.name_chars);
+
+	if (high == low)
+		out("   {:<2} = ", low);
+	else
+		out("{:2}:{:<2} = ", high, low);
+
+	if (rwmem_opts.write_mode != WriteMode::Write)
+		print_field_value("", oldval);
+
+	if (m_op->value_valid) {
+		print_field_value(":= ", userval);
+
+		if (rwmem_opts.write_mode == WriteMode::ReadWriteRead)
+			print_field_value("-> ", newval);
+	}
+
+	out("\n");
+}
+
+void OpFormatter::print_field_value(const char* prefix, uint64_t v)
+{
+	switch (rwmem_opts.number_print_mode) {
+	case NumberPrintMode::Dec:
+		out("{}{:<{}} ", prefix, v, m_formatting.value_chars);
+		break;
+	default:
+	case NumberPrintMode::Hex:
+		out("{}{:#0{}x} ", prefix, v, m_formatting.value_chars);
+		break;
+	case NumberPrintMode::Bin:
+		out("{}{:#0{}b} ", prefix, v, m_formatting.value_chars);
+		break;
+	}
+}
+
+bool OpPrinter::wants_accesses() const
+{
+	return rwmem_opts.print_mode != PrintMode::Quiet || rwmem_opts.raw_output || rwmem_opts.verbose ||
+	       m_latencies;
+}
+
+void OpPrinter::op_begin(const RwmemOp& op, const RwmemMapping& mapping)
+{
+	if (m_latencies)
+		m_latencies->op_begin(mapping);
+
+	rwmem_vprint("mmap offset={:x} length={:x}\n", mapping.offset, mapping.length);
+
+	m_formatter.op_begin(op, mapping);
+}
+
+void OpPrinter::access_begin(const RwmemAccess& a)
+{
+	if (rwmem_opts.raw_output)
+		return;
+
+	if (rwmem_opts.print_mode != PrintMode::Quiet)
+		m_formatter.access_begin(a);
+
+	print_verbose_access(a, m_formatter.formatting());
+}
+
+void OpPrinter::access_write(const RwmemAccess& a)
+{
+	if (rwmem_opts.raw_output)
+		return;
+
+	if (rwmem_opts.print_mode != PrintMode::Quiet)
+		m_formatter.access_write(a);
+
+	flush();
+	fflush(stdout);
+}
+
+void OpPrinter::access_end(const RwmemAccess& a)
+{
+	if (m_latencies)
+		m_latencies->record(a);
+
+	if (rwmem_opts.raw_output) {
+		// Undefined registers are output as zeroes
+		uint64_t v = a.skipped ? 0 : a.old_value;
+		ssize_t l = write(STDOUT_FILENO, &v, a.data_size);
+		ERR_ON(l == -1, "write failed: {}", strerror(errno));
+		return;
+	}
+
+	if (rwmem_opts.print_mode != PrintMode::Quiet)
+		m_formatter.access_end(a);
+
+	flush();
+}
+
+void OpPrinter::flush()
+{
+	write_stdout(m_formatter.output());
+}
+
+PrintPipeline::PrintPipeline(unsigned num_threads, AccessLatencies* latencies)
+	: m_latencies(latencies), m_max_chunks(num_threads * pipeline_chunks_per_thread)
+{
+	for (unsigned i = 0; i < num_threads; ++i)
+		m_workers.emplace_back(&PrintPipeline::work, this);
+
+	m_writer = thread(&PrintPipeline::write, this);
+}
+
+PrintPipeline::~PrintPipeline()
+{
+	finish();
+}
+
+void PrintPipeline::op_begin(const RwmemOp& op, const RwmemMapping& mapping)
+{
+	if (m_latencies)
+		m_latencies->op_begin(mapping);
+
+	rwmem_vprint("mmap offset={:x} length={:x}\n", mapping.offset, mapping.length);
+
+	m_op = &op;
+	m_mapping = mapping;
+
+	next_chunk();
+
+	// For the verbose messages, which are printed as the accesses are done
+	m_formatter.op_begin(op, mapping);
+}
+
+void PrintPipeline::access_begin(const RwmemAccess& a)
+{
+	print_verbose_access(a, m_formatter.formatting());
+}
+
+void PrintPipeline::access_end(const RwmemAccess& a)
+{
+	if (m_latencies)
+		m_latencies->record(a);
+
+	m_chunk->accesses.push_back(a);
+
+	if (m_chunk->accesses.size() == pipeline_chunk_accesses)
+		next_chunk();
+}
+
+void PrintPipeline::finish()
+{
+	if (!m_writer.joinable())
+		return;
+
+	submit();
+	m_chunk.reset();
+
+	{
+		lock_guard<mutex> lock(m_lock);
+		m_finished = true;
+	}
+
+	m_cond.notify_all();
+
+	for (thread& t : m_workers)
+		t.join();
+
+	m_writer.join();
+}
+
+// Queue the current chunk, waiting for room if too many are in flight
+void PrintPipeline::submit()
+{
+	if (!m_chunk || m_chunk->accesses.empty())
+		return;
+
+	unique_lock<mutex> lock(m_lock);
+
+	m_cond.wait(lock, [this] { return m_chunks.size() < m_max_chunks; });
+
+	m_unformatted.push_back(m_chunk.get());
+	m_chunks.push_back(std::move(m_chunk));
+
+	lock.unlock();
+	m_cond.notify_all();
+}
+
+// Queue the current chunk and start a new one for the current op
+void PrintPipeline::next_chunk()
+{
+	submit();
+
+	if (!m_chunk) {
+		m_chunk = make_unique<Chunk>();
+		m_chunk->accesses.reserve(pipeline_chunk_accesses);
+	}
+
+	m_chunk->op = m_op;
+	m_chunk->mapping = m_mapping;
+}
+
+void PrintPipeline::work()
+{
+	OpFormatter formatter;
+
+	while (true) {
+		unique_lock<mutex> lock(m_lock);
+
+		m_cond.wait(lock, [this] { return !m_unformatted.empty() || m_finished; });
+
+		if (m_unformatted.empty())
+			return;
+
+		Chunk* chunk = m_unformatted.front();
+		m_unformatted.pop_front();
+
+		lock.unlock();
+
+		formatter.op_begin(*chunk->op, chunk->mapping);
+
+		for (const RwmemAccess& a : chunk->accesses)
+			formatter.access(a);
+
+		chunk->output.swap(formatter.output());
+		formatter.output().clear();
+
+		lock.lock();
+		chunk->formatted = true;
+		lock.unlock();
+
+		m_cond.notify_all();
+	}
+}
+
+void PrintPipeline::write()
+{
+	while (true) {
+		unique_lock<mutex> lock(m_lock);
+
+		m_cond.wait(lock, [this] {
+			return (!m_chunks.empty() && m_chunks.front()->formatted) || (m_finished && m_chunks.empty());
+		});
+
+		if (m_chunks.empty())
+			return;
+
+		unique_ptr<Chunk> chunk = std::move(m_chunks.front());
+		m_chunks.pop_front();
+
+		lock.unlock();
+		// Wake up the executing thread, if waiting for room
+		m_cond.notify_all();
+
+		write_stdout(chunk->output);
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rwmem.h"
+#include "session.h"
+#include "latency.h"
+
+/**
+ * OpFormatter - Formats the accesses of ops to a string
+ *
+ * The output is what rwmem prints for the accesses, without the verbose
+ * messages and the raw output. Formatting only depends on the op, the
+ * mapping and the access, so separate formatters can format the accesses
+ * of an op in parallel.
+ */
+class OpFormatter
+{
+public:
+	void op_begin(const RwmemOp& op, const RwmemMapping& mapping);
+
+	void access_begin(const RwmemAccess& a);
+	void access_write(const RwmemAccess& a);
+	void access_end(const RwmemAccess& a);
+
+	/// All the output of a finished access
+	void access(const RwmemAccess& a);
+
+	/// The output so far, for the caller to write out and clear
+	std::string& output() { return m_out; }
+	const RwmemFormatting& formatting() const { return m_formatting; }
+
+private:
+	const RwmemOp* m_op = nullptr;
+	RwmemFormatting m_formatting;
+	std::string m_out;
+
+	template<typename... Args>
+	void out(std::format_string<Args...> format_str, Args&&... args)
+	{
+		std::format_to(std::back_inserter(m_out), format_str, std::forward<Args>(args)...);
+	}
+
+	void print_value(const char* prefix, uint64_t v);
+	void print_fields(const RwmemAccess& a);
+	void print_field(unsigned high, unsigned low, const RegisterFileData* rfd, const FieldData* fd,
+			 const RwmemAccess& a);
+	void print_field_value(const char* prefix, uint64_t v);
+};
+
+/**
+ * OpPrinter - Prints the accesses of the ops as they are done
+ *
+ * Also records the latencies of the accesses, if timed.
+ */
+class OpPrinter : public RwmemObserver
+{
+public:
+	explicit OpPrinter(AccessLatencies* latencies) : m_latencies(latencies) {}
+
+	bool wants_accesses() const override;
+	void op_begin(const RwmemOp& op, const RwmemMapping& mapping) override;
+	void access_begin(const RwmemAccess& a) override;
+	void access_write(const RwmemAccess& a) override;
+	void access_end(const RwmemAccess& a) override;
+
+private:
+	AccessLatencies* m_latencies;
+	OpFormatter m_formatter;
+
+	void flush();
+};
+
+/**
+ * PrintPipeline - Prints the accesses of the ops, formatting in parallel
+ *
+ * The accesses are collected in order on the thread executing the ops into
+ * chunks, which worker threads format in parallel. A writer thread prints
+ * the formatted chunks in order, so the output is the same as OpPrinter's.
+ * The number of chunks in flight is limited, blocking the executing thread
+ * when the output is behind.
+ *
+ * Raw output is not supported. finish() must be called after the last op.
+ */
+class PrintPipeline : public RwmemObserver
+{
+public:
+	PrintPipeline(unsigned num_threads, AccessLatencies* latencies);
+	~PrintPipeline();
+
+	void op_begin(const RwmemOp& op, const RwmemMapping& mapping) override;
+	void access_begin(const RwmemAccess& a) override;
+	void access_end(const RwmemAccess& a) override;
+
+	/// Print the rest of the output and stop the threads
+	void finish();
+
+private:
+	struct Chunk {
+		const RwmemOp* op;
+		RwmemMapping mapping;
+		std::vector<RwmemAccess> accesses;
+		std::string output;
+		bool formatted = false;
+	};
+
+	AccessLatencies* m_latencies;
+	size_t m_max_chunks;
+	// Only for the verbose messages
+	OpFormatter m_formatter;
+
+	// The op being executed, and the chunk being filled
+	const RwmemOp* m_op = nullptr;
+	RwmemMapping m_mapping{};
+	std::unique_ptr<Chunk> m_chunk;
+
+	// Protects the fields below
+	std::mutex m_lock;
+	std::condition_variable m_cond;
+	// The chunks in flight, in output order
+	std::deque<std::unique_ptr<Chunk>> m_chunks;
+	// The chunks waiting for a worker
+	std::deque<Chunk*> m_unformatted;
+	bool m_finished = false;
+
+	std::vector<std::thread> m_workers;
+	std::thread m_writer;
+
+	void submit();
+	void next_chunk();
+	void work();
+	void write();
+};
@@ -1,65 +1,50 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <thread>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "rwmem.h"
 #include "helpers.h"
 #include "regs.h"
-#include "mmaptarget.h"
-#include "i2ctarget.h"
+#include "regfileset.h"
+#include "nameindex.h"
+#include "session.h"
+#include "latency.h"
+#include "printer.h"
 
 #include <fnmatch.h>
 
 using namespace std;
 
-static vector<const RegisterData*> match_registers(const RegisterFileData* rfd, const RegisterBlockData* rbd, const string& pattern)
-{
-	vector<const RegisterData*> matches;
-
-	for (unsigned ridx = 0; ridx < rbd->num_regs(); ++ridx) {
-		const RegisterData* rd = rbd->register_at(rfd, ridx);
-
-		if (fnmatch(pattern.c_str(), rd->name(rfd), FNM_CASEFOLD) != 0)
-			continue;
-
-		matches.push_back(rd);
-	}
-
-	return matches;
-}
-
-static vector<RegMatch> match_reg(const RegisterFileData* rfd, const string& pattern)
-{
+struct RegMatchPatterns {
 	string rb_pat;
 	string r_pat;
 	string f_pat;
+};
 
-	vector<string> strs = split(pattern, '.');
-
-	rb_pat = strs[0];
-
-	if (strs.size() > 1) {
-		strs = split(strs[1], ':');
-
-		r_pat = strs[0];
-
-		if (strs.size() > 1) {
-			f_pat = strs[1];
-		}
-	}
-
-	vector<RegMatch> matches;
+static void match_blocks(const RegisterFileSet& regfiles, unsigned fidx, const RegMatchPatterns& pats,
+			 unsigned first_bidx, unsigned last_bidx, vector<RegMatch>& matches)
+{
+	const RegisterFileData* rfd = regfiles.file(fidx).data();
 
-	for (unsigned bidx = 0; bidx < rfd->num_blocks(); ++bidx) {
+	for (unsigned bidx = first_bidx; bidx < last_bidx; ++bidx) {
 		const RegisterBlockData* rbd = rfd->block_at(bidx);
 
-		if (fnmatch(rb_pat.c_str(), rbd->name(rfd), FNM_CASEFOLD) != 0)
+		if (regfiles.is_shadowed(fidx, bidx))
+			continue;
+
+		if (fnmatch(pats.rb_pat.c_str(), rbd->name(rfd), FNM_CASEFOLD) != 0)
 			continue;
 
 		RegMatch m{};
+		m.rfd = rfd;
 		m.rbd = rbd;
 
-		if (r_pat.empty()) {
+		if (pats.r_pat.empty()) {
 			matches.push_back(m);
 			continue;
 		}
@@ -67,12 +52,12 @@ static vector<RegMatch> match_reg(const RegisterFileData* rfd, const string& pat
 		for (unsigned ridx = 0; ridx < rbd->num_regs(); ++ridx) {
 			const RegisterData* rd = rbd->register_at(rfd, ridx);
 
-			if (fnmatch(r_pat.c_str(), rd->name(rfd), FNM_CASEFOLD) != 0)
+			if (fnmatch(pats.r_pat.c_str(), rd->name(rfd), FNM_CASEFOLD) != 0)
 				continue;
 
 			m.rd = rd;
 
-			if (f_pat.empty()) {
+			if (pats.f_pat.empty()) {
 				matches.push_back(m);
 				continue;
 			}
@@ -80,7 +65,7 @@ static vector<RegMatch> match_reg(const RegisterFileData* rfd, const string& pat
 			for (unsigned fidx = 0; fidx < rd->num_fields(); ++fidx) {
 				const FieldData* fd = rd->field_at(rfd, fidx);
 
-				if (fnmatch(f_pat.c_str(), fd->name(rfd), FNM_CASEFOLD) != 0)
+				if (fnmatch(pats.f_pat.c_str(), fd->name(rfd), FNM_CASEFOLD) != 0)
 					continue;
 
 				m.fd = fd;
@@ -88,568 +73,281 @@ static vector<RegMatch> match_reg(const RegisterFileData* rfd, const string& pat
 			}
 		}
 	}
-
-	return matches;
-}
-
-static void print_regfile_all(const RegisterFileData* rfd)
-{
-	print("{}: total {}/{}/{}\n",
-	      rfd->name(), rfd->num_blocks(), rfd->num_regs(), rfd->num_fields());
-
-	for (unsigned bidx = 0; bidx < rfd->num_blocks(); ++bidx) {
-		const RegisterBlockData* rbd = rfd->block_at(bidx);
-
-		print("  {}: {:#x} {:#x}, regs {}, endianness: {}/{}\n",
-		      rbd->name(rfd), rbd->offset(), rbd->size(), rbd->num_regs(),
-		      (unsigned)rbd->addr_endianness(), (unsigned)rbd->data_endianness());
-
-		for (unsigned ridx = 0; ridx < rbd->num_regs(); ++ridx) {
-			const RegisterData* rd = rbd->register_at(rfd, ridx);
-
-			print("    {}: {:#x}, fields {}\n",
-			      rd->name(rfd), rd->offset(), rd->num_fields());
-
-			if (rwmem_opts.print_mode != PrintMode::RegFields)
-				continue;
-
-			for (unsigned fidx = 0; fidx < rd->num_fields(); ++fidx) {
-				const FieldData* fd = rd->field_at(rfd, fidx);
-
-				print("      {}: {}:{}\n",
-				      fd->name(rfd), fd->high(), fd->low());
-			}
-		}
-	}
 }
 
-static void print_field(unsigned high, unsigned low,
-			const RegisterFileData* rfd,
-			const FieldData* fd,
-			uint64_t newval, uint64_t userval, uint64_t oldval,
-			const RwmemOp& op,
-			const RwmemFormatting& formatting)
-{
-	uint64_t mask = GENMASK(high, low);
-
-	newval = (newval & mask) >> low;
-	oldval = (oldval & mask) >> low;
-	userval = (userval & mask) >> low;
-
-	rwmem_printq("  ");
-
-	if (fd)
-		rwmem_printq("{:<{}} ", fd->name(rfd), formatting.name_chars);
-
-	if (high == low)
-		rwmem_printq("   {:<2} = ", low);
-	else
-		rwmem_printq("{:2}:{:<2} = ", high, low);
-
-	if (rwmem_opts.write_mode != WriteMode::Write) {
-		switch (rwmem_opts.number_print_mode) {
-		case NumberPrintMode::Dec:
-			rwmem_printq("{:<{}} ", oldval, formatting.value_chars);
-			break;
-		default:
-		case NumberPrintMode::Hex:
-			rwmem_printq("{:#0{}x} ", oldval, formatting.value_chars);
-			break;
-		case NumberPrintMode::Bin:
-			rwmem_printq("{:#0{}b} ", oldval, formatting.value_chars);
-			break;
-		}
-	}
+// Below this many register index entries a single thread finishes the scan
+// faster than a thread pool can be started. --threads overrides this.
+static const uint32_t PARALLEL_MATCH_MIN_REGS = 16384;
 
-	if (op.value_valid) {
-		switch (rwmem_opts.number_print_mode) {
-		case NumberPrintMode::Dec:
-			rwmem_printq(":= {:<{}} ", userval, formatting.value_chars);
-			break;
-		default:
-		case NumberPrintMode::Hex:
-			rwmem_printq(":= {:#0{}x} ", userval, formatting.value_chars);
-			break;
-		case NumberPrintMode::Bin:
-			rwmem_printq(":= {:#0{}b} ", userval, formatting.value_chars);
-			break;
-		}
+// The scan is bound by memory bandwidth well before this many threads
+static const unsigned PARALLEL_MATCH_MAX_THREADS = 8;
 
-		if (rwmem_opts.write_mode == WriteMode::ReadWriteRead) {
-			switch (rwmem_opts.number_print_mode) {
-			case NumberPrintMode::Dec:
-				rwmem_printq("-> {:<{}} ", newval, formatting.value_chars);
-				break;
-			default:
-			case NumberPrintMode::Hex:
-				rwmem_printq("-> {:#0{}x} ", newval, formatting.value_chars);
-				break;
-			case NumberPrintMode::Bin:
-				rwmem_printq("-> {:#0{}b} ", newval, formatting.value_chars);
-				break;
-			}
-		}
-	}
+// Number of work chunks per thread, to balance blocks of very different sizes
+static const unsigned PARALLEL_MATCH_CHUNKS_PER_THREAD = 4;
 
-	rwmem_printq("\n");
-}
+// Below this many accesses the output is formatted on the main thread, as
+// starting the print pipeline costs more than it saves
+static const size_t PIPELINE_MIN_ACCESSES = 8192;
 
-static void readwriteprint(const RwmemOp& op,
-			   ITarget* mm,
-			   uint64_t op_addr,
-			   uint64_t paddr,
-			   const RegisterFileData* rfd,
-			   const RegisterBlockData* rbd,
-			   const RegisterData* rd,
-			   const RwmemFormatting& formatting)
+static vector<RegMatch> match_blocks_parallel(const RegisterFileSet& regfiles, unsigned fidx,
+					      const RegMatchPatterns& pats, unsigned num_threads)
 {
-	if (rd) {
-		string name = std::format("{}.{}", rbd->name(rfd), rd->name(rfd));
-		rwmem_printq("{:<{}} ", name.c_str(), formatting.name_chars);
-	}
-
-	rwmem_printq("{:#0{}x} ", paddr, formatting.address_chars);
-	rwmem_vprint("Accessing {:#0{}x}", paddr, formatting.address_chars);
-
-	if (op_addr != paddr) {
-		rwmem_printq("(+{:#0{}x}) ", op_addr, formatting.offset_chars);
-		rwmem_vprint(" (+{:#{}x})", op_addr, formatting.offset_chars);
-	}
-
-	rwmem_vprint("\n");
-
-	uint64_t oldval, userval, newval;
+	const RegisterFileData* rfd = regfiles.file(fidx).data();
+	const uint32_t num_blocks = rfd->num_blocks();
+	const uint32_t num_chunks = min<uint32_t>(num_threads * PARALLEL_MATCH_CHUNKS_PER_THREAD, num_blocks);
 
-	oldval = userval = newval = 0;
+	// Split the blocks into contiguous chunks of roughly equal register count
+	const uint64_t regs_per_chunk = DIV_ROUND_UP((uint64_t)rfd->num_reg_indices(), num_chunks);
 
-	uint8_t reg_data_size;
-	Endianness reg_data_endianness;
+	vector<unsigned> bounds{ 0 };
+	uint64_t regs = 0;
 
-	if (rd && rbd) {
-		// Use register-specific effective size and endianness
-		reg_data_size = rd->effective_data_size(rbd);
-		reg_data_endianness = rd->effective_data_endianness(rbd);
-	} else {
-		// Fallback to mapping defaults (existing behavior)
-		reg_data_size = 0; // Use mapping default
-		reg_data_endianness = Endianness::Default; // Use mapping default
-	}
-
-	if (rwmem_opts.write_mode != WriteMode::Write) {
-		oldval = mm->read(paddr, reg_data_size, reg_data_endianness);
-
-		switch (rwmem_opts.number_print_mode) {
-		case NumberPrintMode::Dec:
-			rwmem_printq("= {:{}}", oldval, formatting.value_chars);
-			break;
-		default:
-		case NumberPrintMode::Hex:
-			rwmem_printq("= {:#0{}x}", oldval, formatting.value_chars);
-			break;
-		case NumberPrintMode::Bin:
-			rwmem_printq("= {:#0{}b}", oldval, formatting.value_chars);
-			break;
+	for (unsigned bidx = 0; bidx < num_blocks; ++bidx) {
+		regs += rfd->block_at(bidx)->num_regs() + 1;
+		if (regs >= regs_per_chunk && bounds.size() < num_chunks) {
+			bounds.push_back(bidx + 1);
+			regs = 0;
 		}
-
-		newval = oldval;
 	}
 
-	if (op.value_valid) {
-		uint64_t v;
-
-		v = oldval;
-		v &= ~GENMASK(op.high, op.low);
-		v |= op.value << op.low;
-
-		switch (rwmem_opts.number_print_mode) {
-		case NumberPrintMode::Dec:
-			rwmem_printq(" := {:{}}", v, formatting.value_chars);
-			break;
-		default:
-		case NumberPrintMode::Hex:
-			rwmem_printq(" := {:#0{}x}", v, formatting.value_chars);
-			break;
-		case NumberPrintMode::Bin:
-			rwmem_printq(" := {:#0{}b}", v, formatting.value_chars);
-			break;
-		}
-
-		fflush(stdout);
-
-		mm->write(paddr, v, reg_data_size, reg_data_endianness);
+	if (bounds.back() != num_blocks)
+		bounds.push_back(num_blocks);
 
-		newval = v;
-		userval = v;
+	vector<vector<RegMatch>> chunk_matches(bounds.size() - 1);
+	atomic<unsigned> next_chunk = 0;
 
-		if (rwmem_opts.write_mode == WriteMode::ReadWriteRead) {
-			newval = mm->read(paddr, reg_data_size, reg_data_endianness);
+	auto worker = [&]() {
+		unsigned chunk;
+		while ((chunk = next_chunk++) < chunk_matches.size())
+			match_blocks(regfiles, fidx, pats, bounds[chunk], bounds[chunk + 1], chunk_matches[chunk]);
+	};
 
-			switch (rwmem_opts.number_print_mode) {
-			case NumberPrintMode::Dec:
-				rwmem_printq(" -> {:{}}", newval, formatting.value_chars);
-				break;
-			default:
-			case NumberPrintMode::Hex:
-				rwmem_printq(" -> {:#0{}x}", newval, formatting.value_chars);
-				break;
-			case NumberPrintMode::Bin:
-				rwmem_printq(" -> {:#0{}b}", newval, formatting.value_chars);
-				break;
-			}
-		}
-	}
+	vector<thread> threads;
+	for (unsigned i = 1; i < num_threads; ++i)
+		threads.emplace_back(worker);
 
-	rwmem_printq("\n");
+	worker();
 
-	if (rwmem_opts.print_mode != PrintMode::RegFields)
-		return;
+	for (thread& t : threads)
+		t.join();
 
-	if (rd) {
-		if (op.custom_field) {
-			const FieldData* fd = rd->find_field(rfd, op.high, op.low);
+	// Merge in block order so that the output does not depend on scheduling
+	size_t total = 0;
+	for (const auto& v : chunk_matches)
+		total += v.size();
 
-			print_field(op.high, op.low, rfd, fd,
-				    newval, userval, oldval, op, formatting);
-		} else {
-			for (unsigned i = 0; i < rd->num_fields(); ++i) {
-				const FieldData* fd = rd->field_at(rfd, i);
-
-				if (fd->high() >= op.low && fd->low() <= op.high)
-					print_field(fd->high(), fd->low(), rfd, fd,
-						    newval, userval, oldval, op, formatting);
-			}
-		}
-	} else {
-		if (op.custom_field) {
-			print_field(op.high, op.low, nullptr, nullptr, newval, userval, oldval,
-				    op, formatting);
-		}
-	}
-}
+	vector<RegMatch> matches;
+	matches.reserve(total);
 
-static int readprint_raw(ITarget* mm, uint64_t offset, unsigned size)
-{
-	uint64_t v = mm->read(offset, size);
+	for (const auto& v : chunk_matches)
+		matches.insert(matches.end(), v.begin(), v.end());
 
-	return write(STDOUT_FILENO, &v, size);
+	return matches;
 }
 
-static RwmemOp parse_op(const RwmemOptsArg& arg, const RegisterFile* regfile)
+static vector<RegMatch> match_reg(const RegisterFileSet& regfiles, const string& pattern)
 {
-	RwmemOp op{};
+	RegMatchPatterns pats;
 
-	const RegisterFileData* rfd = nullptr;
-	if (regfile)
-		rfd = regfile->data();
-
-	/* Parse address */
-
-	// first register from the match
-	const RegisterData* rd = nullptr;
-
-	if (parse_u64(arg.address, &op.reg_offset) != 0) {
-		ERR_ON(!rfd, "Invalid address '{}'", arg.address);
-
-		vector<string> strs = split(arg.address, '.');
-
-		ERR_ON(strs.size() > 2, "Invalid address '{}'", arg.address);
+	vector<string> strs = split(pattern, '.');
 
-		// First try with str[0] meaning the reg block, if that fails
-		// search all regblocks for the str[0] register.
-		if (const RegisterBlockData* rbd = rfd->find_block(strs[0])) {
-			op.rbd = rbd;
+	pats.rb_pat = strs[0];
 
-			if (strs.size() > 1) {
-				op.rds = match_registers(rfd, rbd, strs[1]);
-				ERR_ON(op.rds.empty(), "Failed to find register");
-				rd = op.rds[0];
-			} else {
-				rd = rbd->register_at(rfd, 0);
-				ERR_ON(!rd, "Failed to figure out first register");
-			}
-		} else if (strs.size() == 1) {
-			for (uint32_t bidx = 0; bidx < rfd->num_blocks(); ++bidx) {
-				const RegisterBlockData* rbd = rfd->block_at(bidx);
-				const auto rds = match_registers(rfd, rbd, strs[0]);
-				if (!rds.empty()) {
-					op.rbd = rbd;
-					op.rds = rds;
-					break;
-				}
-			}
+	if (strs.size() > 1) {
+		strs = split(strs[1], ':');
 
-			ERR_ON(op.rds.empty(), "Failed to find reg by search");
+		pats.r_pat = strs[0];
 
-			rd = op.rds[0];
-			ERR_ON(!rd, "Failed to figure out first register");
-		} else {
-			ERR("Failed to find register block or register");
+		if (strs.size() > 1) {
+			pats.f_pat = strs[1];
 		}
 	}
 
-	/* Parse range */
-
-	if (arg.range.size()) {
-		int r = parse_u64(arg.range, &op.range);
-		ERR_ON(r, "Invalid range '{}'", arg.range);
-
-		if (!arg.range_is_offset) {
-			ERR_ON(op.range <= op.reg_offset, "range '{}' is <= 0", arg.range);
+	unsigned num_threads = rwmem_opts.num_threads;
+	uint32_t min_regs = 0;
 
-			op.range = op.range - op.reg_offset;
-		}
-	} else {
-		if (rd && op.rbd)
-			op.range = rd->effective_data_size(op.rbd);
-		else if (op.rbd)
-			op.range = op.rbd->data_size();
-		else
-			op.range = rwmem_opts.data_size;
+	if (!num_threads) {
+		num_threads = clamp(thread::hardware_concurrency(), 1u, PARALLEL_MATCH_MAX_THREADS);
+		min_regs = PARALLEL_MATCH_MIN_REGS;
 	}
 
-	/* Parse field */
-
-	if (arg.field.size()) {
-		unsigned fl, fh;
-		char* endptr;
-
-		bool ok = false;
+	vector<RegMatch> matches;
 
-		if (sscanf(arg.field.c_str(), "%u:%u", &fh, &fl) == 2)
-			ok = true;
+	for (unsigned fidx = 0; fidx < regfiles.num_files(); ++fidx) {
+		const RegisterFileData* rfd = regfiles.file(fidx).data();
 
-		if (!ok) {
-			fl = fh = strtoull(arg.field.c_str(), &endptr, 0);
-			if (*endptr == 0)
-				ok = true;
+		// Block-level patterns only look at the block names, which is cheap
+		if (num_threads > 1 && !pats.r_pat.empty() &&
+		    rfd->num_reg_indices() >= min_regs && rfd->num_blocks() > 1) {
+			rwmem_vprint("Matching '{}' in '{}' with {} threads\n", pattern, rfd->name(), num_threads);
+			vector<RegMatch> m = match_blocks_parallel(regfiles, fidx, pats, num_threads);
+			matches.insert(matches.end(), m.begin(), m.end());
+			continue;
 		}
 
-		if (!ok && rd) {
-			const FieldData* fd = rd->find_field(rfd, arg.field);
-			if (fd) {
-				fl = fd->low();
-				fh = fd->high();
-				ok = true;
-			}
-		}
+		match_blocks(regfiles, fidx, pats, 0, rfd->num_blocks(), matches);
+	}
 
-		ERR_ON(!ok, "Field not found '{}'", arg.field);
+	return matches;
+}
 
-		uint8_t reg_data_size;
-		if (rd && op.rbd) {
-			reg_data_size = rd->effective_data_size(op.rbd);
-		} else if (op.rbd) {
-			reg_data_size = op.rbd->data_size();
-		} else {
-			reg_data_size = rwmem_opts.data_size;
-		}
+static void print_regfile_all(const RegisterFileSet& regfiles, unsigned fidx)
+{
+	const RegisterFileData* rfd = regfiles.file(fidx).data();
 
-		ERR_ON(fl >= reg_data_size * 8 || fh >= reg_data_size * 8,
-		       "Field bits higher than register size");
+	print("{}: total {}/{}/{}\n",
+	      rfd->name(), rfd->num_blocks(), rfd->num_regs(), rfd->num_fields());
 
-		op.custom_field = true;
-		op.low = fl;
-		op.high = fh;
-	} else {
-		op.custom_field = false;
-		op.low = 0;
-		uint8_t reg_data_size;
-		if (rd && op.rbd) {
-			reg_data_size = rd->effective_data_size(op.rbd);
-		} else if (op.rbd) {
-			reg_data_size = op.rbd->data_size();
-		} else {
-			reg_data_size = rwmem_opts.data_size;
-		}
-		op.high = reg_data_size * 8 - 1;
-	}
+	for (unsigned bidx = 0; bidx < rfd->num_blocks(); ++bidx) {
+		const RegisterBlockData* rbd = rfd->block_at(bidx);
 
-	/* Parse value */
+		if (regfiles.is_shadowed(fidx, bidx))
+			continue;
 
-	if (arg.value.size()) {
-		uint64_t value;
-		int r = parse_u64(arg.value, &value);
-		ERR_ON(r, "Invalid value '{}'", arg.value);
+		print("  {}: {:#x} {:#x}, regs {}, endianness: {}/{}\n",
+		      rbd->name(rfd), rbd->offset(), rbd->size(), rbd->num_regs(),
+		      (unsigned)rbd->addr_endianness(), (unsigned)rbd->data_endianness());
 
-		uint8_t reg_data_size;
-		if (rd && op.rbd) {
-			reg_data_size = rd->effective_data_size(op.rbd);
-		} else if (op.rbd) {
-			reg_data_size = op.rbd->data_size();
-		} else {
-			reg_data_size = rwmem_opts.data_size;
-		}
+		for (unsigned ridx = 0; ridx < rbd->num_regs(); ++ridx) {
+			const RegisterData* rd = rbd->register_at(rfd, ridx);
 
-		uint64_t regmask = ~0ULL >> (64 - reg_data_size * 8);
+			print("    {}: {:#x}, fields {}\n",
+			      rd->name(rfd), rd->offset(), rd->num_fields());
 
-		ERR_ON(value & ~regmask, "Value does not fit into the register size");
+			if (rwmem_opts.print_mode != PrintMode::RegFields)
+				continue;
 
-		ERR_ON(value & ~GENMASK(op.high - op.low, 0),
-		       "Value does not fit into the field");
+			for (unsigned fidx = 0; fidx < rd->num_fields(); ++fidx) {
+				const FieldData* fd = rd->field_at(rfd, fidx);
 
-		op.value = value;
-		op.value_valid = true;
+				print("      {}: {}:{}\n",
+				      fd->name(rfd), fd->high(), fd->low());
+			}
+		}
 	}
-
-	return op;
 }
 
-static uint32_t print_chars_needed(uint32_t numbytes, NumberPrintMode mode)
+static void print_reg_matches(const vector<RegMatch>& matches)
 {
-	switch (mode) {
-	default:
-	case NumberPrintMode::Hex:
-		return numbytes * 2 + 2; // for hex: 2 chars per byte and "0x"
-	case NumberPrintMode::Dec:
-		// For N bytes, max value is 2^(N*8) - 1
-		// Number of decimal digits needed is floor(log10(2^(N*8) - 1)) + 1
-		// Which is approximately N * 8 * log10(2) + 1 = N * 2.408 + 1
-		return (unsigned)(numbytes * 8 * 0.30103) + 2; // log10(2) ≈ 0.30103, +2 for safety
-	case NumberPrintMode::Bin:
-		return numbytes * 8 + 2; // for bin: 8 chars per byte and "0b"
+	for (const RegMatch& m : matches) {
+		const RegisterFileData* rfd = m.rfd;
+
+		if (m.rd && m.fd)
+			print("{}.{}:{}\n", m.rbd->name(rfd), m.rd->name(rfd), m.fd->name(rfd));
+		else if (m.rd)
+			print("{}.{}\n", m.rbd->name(rfd), m.rd->name(rfd));
+		else
+			print("{}\n", m.rbd->name(rfd));
 	}
 }
 
-static void do_op_numeric(const RwmemOp& op, ITarget* mm)
+// The cache stamp changes whenever the regfile is replaced or modified
+static uint64_t regfile_cache_stamp(const string& path)
 {
-	const uint64_t op_base = op.reg_offset;
-	const uint64_t range = op.range;
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return 0;
 
-	const uint8_t data_size = rwmem_opts.data_size;
-	const uint8_t addr_size = rwmem_opts.address_size;
+	uint64_t stamp = (uint64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	stamp ^= (uint64_t)st.st_size << 32;
+	stamp ^= (uint64_t)st.st_ino;
 
-	rwmem_vprint("mmap offset={:x} length={:x}\n", op_base, range);
+	return stamp;
+}
 
-	mm->map(op_base, range, rwmem_opts.address_endianness, rwmem_opts.address_size,
-		rwmem_opts.data_endianness, data_size,
-		op.value_valid ? MapMode::ReadWrite : MapMode::Read);
+// A regfile with a valid cache has been validated when the cache was written,
+// so the regfile is loaded without validation and validated only on a cache miss
+static void load_name_index_cache(RegisterNameIndex& index, const RegisterFile& regfile,
+				  const string& regfile_path)
+{
+	const string dir = get_home() + "/.rwmem/cache";
+	const string cache_path = std::format("{}/{:016x}.idx", dir, hash<string>{}(regfile_path));
+	const uint64_t stamp = regfile_cache_stamp(regfile_path);
 
-	RwmemFormatting formatting;
-	formatting.name_chars = 30;
-	formatting.address_chars = print_chars_needed(addr_size, NumberPrintMode::Hex);
-	formatting.offset_chars = DIV_ROUND_UP(fls(range), 4);
-	formatting.value_chars = print_chars_needed(data_size, rwmem_opts.number_print_mode);
+	if (index.load_cache(cache_path, stamp)) {
+		rwmem_vprint("Using name index cache '{}'\n", cache_path);
+		return;
+	}
 
-	uint64_t op_offset = 0;
+	regfile.data()->validate(regfile.size());
 
-	while (op_offset < range) {
-		if (rwmem_opts.raw_output)
-			readprint_raw(mm, op_offset, data_size);
-		else
-			readwriteprint(op, mm, op_offset, op_base + op_offset, nullptr, nullptr, nullptr, formatting);
+	mkdir(dir.c_str(), 0755);
 
-		op_offset += data_size;
+	try {
+		index.save_cache(cache_path, stamp);
+		rwmem_vprint("Wrote name index cache '{}'\n", cache_path);
+	} catch (const runtime_error& e) {
+		rwmem_vprint("{}\n", e.what());
 	}
 }
 
-static void do_op_symbolic(const RwmemOp& op, const RegisterFile* regfile, ITarget* mm)
+// Print the names at the level the prefix is at: blocks for "BLK",
+// registers for "BLK.REG" and fields for "BLK.REG:FIELD"
+static void print_completions(const RegisterFileSet& regfiles, const vector<string>& regfile_paths,
+			      const string& prefix)
 {
-	const RegisterBlockData* rbd = op.rbd;
-
-	const uint64_t rb_base = rbd->offset();
-	const uint64_t rb_access_base = rwmem_opts.ignore_base ? 0 : rbd->offset();
-	const uint64_t range = rbd->size();
+	vector<RegisterNameIndex> indices;
+	indices.reserve(regfiles.num_files());
 
-	Endianness addr_endianness, data_endianness;
-	uint8_t addr_size, data_size;
+	for (unsigned fidx = 0; fidx < regfiles.num_files(); ++fidx) {
+		indices.emplace_back(regfiles.file(fidx).data());
 
-	if (rwmem_opts.user_address_size) {
-		addr_endianness = rwmem_opts.address_endianness;
-		addr_size = rwmem_opts.address_size;
-	} else {
-		addr_endianness = rbd->addr_endianness();
-		addr_size = rbd->addr_size();
-	}
-
-	if (rwmem_opts.user_data_size) {
-		data_endianness = rwmem_opts.data_endianness;
-		data_size = rwmem_opts.data_size;
-	} else {
-		data_endianness = rbd->data_endianness();
-		data_size = rbd->data_size();
+		if (rwmem_opts.use_cache)
+			load_name_index_cache(indices.back(), regfiles.file(fidx), regfile_paths[fidx]);
 	}
 
-	rwmem_vprint("mmap offset={:x} length={:x}\n", rb_access_base, rbd->size());
+	const size_t dot = prefix.find('.');
 
-	mm->map(rb_access_base, rbd->size(), addr_endianness, addr_size, data_endianness, data_size,
-		op.value_valid ? MapMode::ReadWrite : MapMode::Read);
+	if (dot == string::npos) {
+		vector<const char*> names;
 
-	RwmemFormatting formatting;
-	formatting.name_chars = 30;
-	formatting.address_chars = print_chars_needed(addr_size, NumberPrintMode::Hex);
-	formatting.offset_chars = DIV_ROUND_UP(fls(range), 4);
-	formatting.value_chars = print_chars_needed(data_size, rwmem_opts.number_print_mode);
+		for (unsigned fidx = 0; fidx < regfiles.num_files(); ++fidx) {
+			const RegisterFileData* rfd = regfiles.file(fidx).data();
 
-	const RegisterFileData* rfd = regfile->data();
-
-	// Accessing addresses not defined in regfile may cause problems. So skip those.
-	const bool skip_undefined_regs = true;
-
-	if (op.rds.empty()) {
-		uint64_t op_offset = 0;
+			for (const RegisterBlockData* rbd : indices[fidx].blocks_with_prefix(prefix)) {
+				if (regfiles.find_block(rbd->name(rfd))->rbd == rbd)
+					names.push_back(rbd->name(rfd));
+			}
+		}
 
-		while (op_offset < range) {
-			const RegisterData* rd = rbd->find_register(rfd, op_offset);
+		// Each file's blocks are already in order, this only merges the files
+		stable_sort(names.begin(), names.end(), [](const char* a, const char* b) {
+			return strcasecmp(a, b) < 0;
+		});
 
-			uint8_t step_size;
-			if (rd) {
-				// Use register-specific size for stepping
-				step_size = rd->effective_data_size(rbd);
-			} else {
-				// Use block default size for gaps
-				step_size = data_size;
-			}
+		for (const char* name : names)
+			print("{}\n", name);
+		return;
+	}
 
-			if (!rd && skip_undefined_regs) {
-				if (rwmem_opts.raw_output) {
-					uint64_t v = 0;
-					ssize_t l = write(STDOUT_FILENO, &v, step_size);
-					ERR_ON(l == -1, "write failed: {}", strerror(errno));
-				}
+	const RegisterBlockRef* rb = regfiles.find_block(string_view(prefix).substr(0, dot));
+	if (!rb)
+		return;
 
-				op_offset += step_size;
-				continue;
-			}
+	const RegisterFileData* rfd = rb->rfd;
+	const RegisterBlockData* rbd = rb->rbd;
 
-			if (rwmem_opts.raw_output)
-				readprint_raw(mm, rb_access_base + op_offset, step_size);
-			else
-				readwriteprint(op, mm, op_offset, rb_base + op_offset, rfd, rbd, rd, formatting);
+	unsigned fidx = 0;
+	while (regfiles.file(fidx).data() != rfd)
+		++fidx;
 
-			op_offset += step_size;
-		}
-	} else {
-		for (const RegisterData* rd : op.rds) {
-			uint64_t op_offset = rd->offset();
+	const RegisterNameIndex& index = indices[fidx];
 
-			uint8_t reg_size = rd->effective_data_size(rbd);
+	const string_view reg_prefix = string_view(prefix).substr(dot + 1);
+	const size_t colon = reg_prefix.find(':');
 
-			if (rwmem_opts.raw_output)
-				readprint_raw(mm, op_offset, reg_size);
-			else
-				readwriteprint(op, mm, op_offset, rb_base + op_offset, rfd, rbd, rd, formatting);
-		}
+	if (colon == string_view::npos) {
+		for (const RegisterData* rd : index.registers_with_prefix(rbd, reg_prefix))
+			print("{}.{}\n", rbd->name(rfd), rd->name(rfd));
+		return;
 	}
-}
 
-static void do_op(const RwmemOp& op, const RegisterFile* regfile, ITarget* mm)
-{
-	if (op.rbd)
-		do_op_symbolic(op, regfile, mm);
-	else
-		do_op_numeric(op, mm);
-}
+	const RegisterData* rd = index.find_register(rbd, reg_prefix.substr(0, colon));
+	if (!rd)
+		return;
 
-static void print_reg_matches(const RegisterFileData* rfd, const vector<RegMatch>& matches)
-{
-	for (const RegMatch& m : matches) {
-		if (m.rd && m.fd)
-			print("{}.{}:{}\n", m.rbd->name(rfd), m.rd->name(rfd), m.fd->name(rfd));
-		else if (m.rd)
-			print("{}.{}\n", m.rbd->name(rfd), m.rd->name(rfd));
-		else
-			print("{}\n", m.rbd->name(rfd));
-	}
+	for (const FieldData* fd : index.fields_with_prefix(rd, reg_prefix.substr(colon + 1)))
+		print("{}.{}:{}\n", rbd->name(rfd), rd->name(rfd), fd->name(rfd));
 }
 
 int main(int argc, char** argv)
@@ -661,9 +359,10 @@ int main(int argc, char** argv)
 	}
 
 	load_opts_from_ini_pre();
+	load_map_types_from_ini();
 #endif
 
-	std::vector<std::string> args(argv, argv + argc);
+	std::vector<std::string_view> args(argv, argv + argc);
 
 	parse_cmdline(args);
 
@@ -676,76 +375,166 @@ int main(int argc, char** argv)
 #endif
 	}
 
-	unique_ptr<RegisterFile> regfile = nullptr;
+	RwmemSessionOptions session_opts;
 
-	if (!rwmem_opts.regfile.empty()) {
-		string path = get_home() + "/.rwmem/" + rwmem_opts.regfile;
+	session_opts.target_type = rwmem_opts.target_type;
+	session_opts.mmap_target = rwmem_opts.mmap_target;
+	session_opts.file_target = rwmem_opts.file_target;
+	session_opts.file_io_uring = rwmem_opts.file_io_uring;
 
-		if (!file_exists(path))
-			path = rwmem_opts.regfile;
+	if (rwmem_opts.target_type == TargetType::I2C) {
+		// I2C parameter validation already done in parse_cmdline()
+		vector<string> strs = split(rwmem_opts.i2c_target, ':');
+		uint64_t bus, addr;
 
-		rwmem_vprint("Reading regfile '{}'\n", path.c_str());
-		regfile = make_unique<RegisterFile>(path.c_str());
+		parse_u64(strs[0], &bus);
+		parse_u64(strs[1], &addr);
+
+		session_opts.i2c_bus = bus;
+		session_opts.i2c_addr = addr;
+	}
+
+	session_opts.user_address_size = rwmem_opts.user_address_size;
+	session_opts.address_size = rwmem_opts.address_size;
+	session_opts.address_endianness = rwmem_opts.address_endianness == Endianness::Default ?
+						  Endianness::Little :
+						  rwmem_opts.address_endianness;
+
+	session_opts.user_data_size = rwmem_opts.user_data_size;
+	session_opts.data_size = rwmem_opts.data_size;
+	session_opts.data_endianness = rwmem_opts.data_endianness == Endianness::Default ?
+					       Endianness::Little :
+					       rwmem_opts.data_endianness;
+
+	session_opts.write_mode = rwmem_opts.write_mode;
+	session_opts.user_map_type = rwmem_opts.user_map_type;
+	session_opts.map_type = rwmem_opts.map_type;
+	session_opts.block_map_types = rwmem_opts.block_map_types;
+	session_opts.user_map_window = rwmem_opts.user_map_window;
+	session_opts.map_window = rwmem_opts.map_window;
+	session_opts.raw = rwmem_opts.raw_output;
+	session_opts.ignore_base = rwmem_opts.ignore_base;
+	session_opts.time_accesses = rwmem_opts.latency != LatencyMode::None;
+
+	RwmemSession session(session_opts);
+	vector<string> regfile_paths;
+
+	for (const string& regfile : rwmem_opts.regfiles) {
+		string regfile_path = get_home() + "/.rwmem/" + regfile;
+
+		if (!file_exists(regfile_path))
+			regfile_path = regfile;
+
+		const bool validate = !(rwmem_opts.show_complete && rwmem_opts.use_cache);
+
+		// Validation and list read through the whole file. Without them only a
+		// few registers are looked up, and readahead would be wasted.
+		const RegisterFileAccess access = validate || rwmem_opts.show_list ? RegisterFileAccess::Sequential :
+										     RegisterFileAccess::Random;
+
+		rwmem_vprint("Reading regfile '{}'\n", regfile_path.c_str());
+		session.load_regfile(regfile_path, validate, access);
+		regfile_paths.push_back(regfile_path);
 	}
 
+	const RegisterFileSet& regfiles = session.regfiles();
+
 	if (rwmem_opts.show_list) {
-		ERR_ON(!regfile, "No regfile given");
+		ERR_ON(regfiles.empty(), "No regfile given");
 
 		if (rwmem_opts.list_patterns.empty()) {
-			print_regfile_all(regfile->data());
+			for (unsigned fidx = 0; fidx < regfiles.num_files(); ++fidx)
+				print_regfile_all(regfiles, fidx);
 		} else {
 			for (const string& pattern : rwmem_opts.list_patterns) {
-				vector<RegMatch> m = match_reg(regfile->data(), pattern);
-				print_reg_matches(regfile->data(), m);
+				vector<RegMatch> m = match_reg(regfiles, pattern);
+				print_reg_matches(m);
 			}
 		}
 
 		return 0;
 	}
 
+	if (rwmem_opts.show_complete) {
+		ERR_ON(regfiles.empty(), "No regfile given");
+
+		print_completions(regfiles, regfile_paths, rwmem_opts.complete_prefix);
+
+		return 0;
+	}
+
+	if (rwmem_opts.transfer != Transfer::None) {
+		transfer(session);
+		return 0;
+	}
+
+	if (rwmem_opts.run_bench) {
+		bench(session);
+		return 0;
+	}
+
 	vector<RwmemOp> ops;
 
 	for (const RwmemOptsArg& arg : rwmem_opts.parsed_args) {
-		RwmemOp op = parse_op(arg, regfile.get());
-		ops.push_back(op);
+		try {
+			ops.push_back(session.parse_op(arg));
+		} catch (const runtime_error& e) {
+			ERR("{}", e.what());
+		}
 	}
 
-	if (rwmem_opts.address_endianness == Endianness::Default)
-		rwmem_opts.address_endianness = Endianness::Little;
+	unique_ptr<AccessLatencies> latencies;
+	if (rwmem_opts.latency != LatencyMode::None)
+		latencies = make_unique<AccessLatencies>(rwmem_opts.latency == LatencyMode::Block);
 
-	if (rwmem_opts.data_endianness == Endianness::Default)
-		rwmem_opts.data_endianness = Endianness::Little;
+	// Formatting the fields takes much longer than reading the registers, so
+	// large dumps are formatted in parallel. Raw output needs no formatting.
+	unsigned num_threads = rwmem_opts.num_threads ? rwmem_opts.num_threads : thread::hardware_concurrency();
 
-	unique_ptr<ITarget> mm;
+	if (!rwmem_opts.num_threads) {
+		size_t num_accesses = 0;
+		for (const RwmemOp& op : ops)
+			num_accesses += session.estimate_accesses(op);
 
-	switch (rwmem_opts.target_type) {
-	case TargetType::MMap: {
-		string file = rwmem_opts.mmap_target;
-		if (file.empty())
-			file = "/dev/mem";
-
-		mm = make_unique<MMapTarget>(file);
-		break;
+		if (num_accesses < PIPELINE_MIN_ACCESSES)
+			num_threads = 1;
 	}
 
-	case TargetType::I2C: {
-		// I2C parameter validation already done in parse_cmdline()
-		vector<string> strs = split(rwmem_opts.i2c_target, ':');
-		uint64_t bus, addr;
+	if (rwmem_opts.print_mode == PrintMode::Quiet || rwmem_opts.raw_output)
+		num_threads = 1;
 
-		parse_u64(strs[0], &bus);
-		parse_u64(strs[1], &addr);
+	// Writes are printed before they are done, so that the output shows
+	// which write hung the board. The pipeline would print them later.
+	if (any_of(ops.begin(), ops.end(), [](const RwmemOp& op) { return op.value_valid; }))
+		num_threads = 1;
+
+	OpPrinter printer(latencies.get());
+	unique_ptr<PrintPipeline> pipeline;
 
-		mm = make_unique<I2CTarget>(bus, addr);
-		break;
+	if (num_threads > 1) {
+		rwmem_vprint("Formatting with {} threads\n", num_threads);
+		pipeline = make_unique<PrintPipeline>(num_threads, latencies.get());
 	}
 
-	default:
-		abort();
+	RwmemObserver& observer = pipeline ? (RwmemObserver&)*pipeline : printer;
+
+	if (rwmem_opts.snapshot) {
+		RwmemCapture capture = session.capture(ops);
+
+		rwmem_vprint("Snapshot at {}.{:06}, {} accesses captured in {} us\n", capture.time_ns / 1000000000,
+			     capture.time_ns % 1000000000 / 1000, capture.accesses.size(), capture.duration_ns / 1000);
+
+		replay_capture(ops, capture, observer);
+	} else {
+		for (const RwmemOp& op : ops)
+			session.execute(op, observer);
 	}
 
-	for (const RwmemOp& op : ops)
-		do_op(op, regfile.get(), mm.get());
+	if (pipeline)
+		pipeline->finish();
+
+	if (latencies)
+		latencies->print();
 
 	return 0;
 }
@@ -1,17 +1,13 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
 #include "regfiledata.h"
 #include "inireader.h"
-
-enum class WriteMode {
-	Write,
-	ReadWrite,
-	ReadWriteRead,
-};
+#include "session.h"
 
 enum class PrintMode {
 	Quiet,
@@ -25,45 +21,31 @@ enum class NumberPrintMode {
 	Bin,
 };
 
-enum class TargetType {
+enum class LatencyMode {
+	None,
+	Register,
+	Block,
+};
+
+enum class Transfer {
 	None,
-	MMap,
-	I2C,
+	Load,
+	Save,
 };
 
 struct RegMatch {
+	const RegisterFileData* rfd;
 	const RegisterBlockData* rbd;
 	const RegisterData* rd;
 	const FieldData* fd;
 };
 
-struct RwmemOp {
-	const RegisterBlockData* rbd;
-	std::vector<const RegisterData*> rds;
-
-	uint64_t reg_offset;
-
-	uint64_t range;
-
-	bool custom_field;
-	unsigned low, high;
-
-	bool value_valid;
-	uint64_t value;
-};
-
-struct RwmemOptsArg {
-	std::string address;
-	bool range_is_offset;
-	std::string range;
-	std::string field;
-	std::string value;
-};
-
 struct RwmemOpts {
 	TargetType target_type;
 
 	std::string mmap_target;
+	std::string file_target;
+	bool file_io_uring = false;
 	std::string i2c_target;
 
 	// for i2c
@@ -77,13 +59,44 @@ struct RwmemOpts {
 
 	WriteMode write_mode = WriteMode::ReadWriteRead;
 	PrintMode print_mode = PrintMode::RegFields;
+
+	// for mmap
+	bool user_map_type = false;
+	MapType map_type = MapType::Uncached;
+	// From rwmem.ini
+	std::vector<std::pair<std::string, MapType>> block_map_types;
+	// Mapping window size, 0 for the whole range
+	bool user_map_window = false;
+	uint64_t map_window = 0;
+
 	bool raw_output;
 
-	std::string regfile;
+	// Time the accesses and print latency histograms at exit
+	LatencyMode latency = LatencyMode::None;
+	// Do all the accesses before printing them
+	bool snapshot;
+	// Threads formatting the output, or saving, 0 for automatic
+	unsigned num_threads = 0;
+
+	// for load and save, the address is the single parsed_args entry
+	Transfer transfer = Transfer::None;
+	std::string transfer_file;
+	bool direct_io;
+
+	// for bench, the region is the single parsed_args entry
+	bool run_bench;
+	int bench_cpu = -1;
+	bool bench_writes;
+
+	// Later regfiles shadow blocks with the same name in the earlier ones
+	std::vector<std::string> regfiles;
 
 	bool show_list;
+	bool show_complete;
 
 	std::vector<std::string> list_patterns;
+	std::string complete_prefix;
+	bool use_cache;
 	std::vector<RwmemOptsArg> parsed_args;
 
 	bool verbose;
@@ -100,13 +113,19 @@ struct RwmemFormatting {
 
 extern RwmemOpts rwmem_opts;
 
-void parse_cmdline(const std::vector<std::string>& args);
+void parse_cmdline(const std::vector<std::string_view>& args);
+
+// rwmem load/save
+void transfer(RwmemSession& session);
+// rwmem bench
+void bench(RwmemSession& session);
 
 #if HAS_INIH
 extern INIReader rwmem_ini;
 
 void load_opts_from_ini_pre();
 void detect_platform();
+void load_map_types_from_ini();
 #endif
 
 #define rwmem_vprint(fmt_, ...)                                  \
@@ -0,0 +1,328 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "rwmem.h"
+#include "helpers.h"
+
+using namespace std;
+
+// Transfers are done in chunks of this size, from a buffer aligned for O_DIRECT
+static const uint64_t chunk_size = 1024 * 1024;
+static const size_t direct_align = 4096;
+
+// Parallel saves split the range into windows of this size, each mapped and
+// saved separately. Ranges below the minimum are saved on one thread, unless
+// --threads is given.
+static const uint64_t parallel_window_size = 4 * 1024 * 1024;
+static const uint64_t parallel_min_len = 64 * 1024 * 1024;
+
+struct FreeDeleter {
+	void operator()(void* p) const { free(p); }
+};
+
+static int open_file(const string& filename, int oflag)
+{
+	int fd = -1;
+
+	if (rwmem_opts.direct_io) {
+		fd = open(filename.c_str(), oflag | O_DIRECT, 0666);
+
+		// e.g. tmpfs does not support O_DIRECT
+		if (fd == -1 && errno == EINVAL)
+			rwmem_vprint("O_DIRECT not supported for '{}', using buffered I/O\n", filename);
+	}
+
+	if (fd == -1)
+		fd = open(filename.c_str(), oflag, 0666);
+
+	ERR_ON(fd == -1, "Failed to open '{}': {}", filename, strerror(errno));
+
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	return fd;
+}
+
+// Read until len bytes or end of file, returns the bytes read. Throws on
+// errors, as the parallel saves call this and write_full() on worker threads.
+static uint64_t read_full(int fd, uint8_t* buf, uint64_t len)
+{
+	uint64_t done = 0;
+
+	while (done < len) {
+		ssize_t r = read(fd, buf + done, len - done);
+
+		if (r == -1 && errno == EINTR)
+			continue;
+
+		if (r == -1)
+			throw runtime_error(std::format("Failed to read '{}': {}", rwmem_opts.transfer_file,
+							strerror(errno)));
+
+		if (r == 0)
+			break;
+
+		done += r;
+	}
+
+	return done;
+}
+
+// Write at the file offset
+static void write_full(int fd, const uint8_t* buf, uint64_t len, uint64_t file_off)
+{
+	// O_DIRECT needs the lengths and offsets to be aligned, so do the rest buffered
+	if (len % direct_align || file_off % direct_align)
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+
+	uint64_t done = 0;
+
+	while (done < len) {
+		ssize_t r = pwrite(fd, buf + done, len - done, file_off + done);
+
+		if (r == -1 && errno == EINTR)
+			continue;
+
+		if (r == -1)
+			throw runtime_error(std::format("Failed to write '{}': {}", rwmem_opts.transfer_file,
+							strerror(errno)));
+
+		done += r;
+	}
+}
+
+class Progress
+{
+public:
+	explicit Progress(uint64_t total)
+		: m_total(total), m_start(chrono::steady_clock::now()),
+		  m_show(rwmem_opts.print_mode != PrintMode::Quiet && isatty(STDERR_FILENO))
+	{
+	}
+
+	void update(uint64_t done)
+	{
+		if (!m_show)
+			return;
+
+		eprint("\r{} / {} KiB ({}%)", done / 1024, m_total / 1024, m_total ? done * 100 / m_total : 100);
+	}
+
+	// Seconds since the start
+	double finish()
+	{
+		if (m_show)
+			eprint("\n");
+
+		return chrono::duration<double>(chrono::steady_clock::now() - m_start).count();
+	}
+
+private:
+	uint64_t m_total;
+	chrono::steady_clock::time_point m_start;
+	bool m_show;
+};
+
+static void print_summary(const char* verb, const char* dir, uint64_t addr, uint64_t len, double secs)
+{
+	const double mib_per_sec = secs > 0 ? len / secs / (1024 * 1024) : 0.0;
+
+	if (mib_per_sec >= 1024)
+		rwmem_printq("{} {:#x} bytes {} {:#x} in {:.3f} s, {:.2f} GiB/s\n", verb, len, dir, addr, secs,
+			     mib_per_sec / 1024);
+	else
+		rwmem_printq("{} {:#x} bytes {} {:#x} in {:.3f} s, {:.1f} MiB/s\n", verb, len, dir, addr, secs,
+			     mib_per_sec);
+}
+
+static void load(RwmemSession& session, const RwmemOptsArg& arg, const RwmemOp& op)
+{
+	int fd = open_file(rwmem_opts.transfer_file, O_RDONLY);
+
+	struct stat st;
+	ERR_ON(fstat(fd, &st) != 0, "Failed to stat '{}': {}", rwmem_opts.transfer_file, strerror(errno));
+	ERR_ON(!S_ISREG(st.st_mode), "'{}' is not a regular file", rwmem_opts.transfer_file);
+
+	const uint64_t len = st.st_size;
+
+	ERR_ON(len == 0, "'{}' is empty", rwmem_opts.transfer_file);
+	ERR_ON(!op.rbd && arg.range.size() && len > op.range, "'{}' is larger than the range {:#x}",
+	       rwmem_opts.transfer_file, op.range);
+
+	RwmemMapping mapping = session.map_range(op, len, MapMode::ReadWrite);
+
+	rwmem_vprint("Loading '{}' to {:#x}+{:#x}\n", rwmem_opts.transfer_file, mapping.offset, len);
+
+	unique_ptr<uint8_t, FreeDeleter> buf((uint8_t*)aligned_alloc(direct_align, chunk_size));
+	Progress progress(len);
+
+	for (uint64_t off = 0; off < len; off += chunk_size) {
+		uint64_t n = min(chunk_size, len - off);
+
+		// O_DIRECT needs aligned lengths, the read of the tail stops at the end of file
+		uint64_t aligned_n = (n + direct_align - 1) & ~(direct_align - 1);
+
+		ERR_ON(read_full(fd, buf.get(), aligned_n) != n, "'{}' changed while loading",
+		       rwmem_opts.transfer_file);
+
+		// The file data is not needed again
+		posix_fadvise(fd, off, n, POSIX_FADV_DONTNEED);
+
+		session.write_range(mapping.offset + off, buf.get(), n);
+
+		progress.update(off + n);
+	}
+
+	close(fd);
+
+	print_summary("Loaded", "to", mapping.offset, len, progress.finish());
+}
+
+// The number of windows of a parallel save of len bytes at addr
+static uint64_t parallel_windows(uint64_t addr, uint64_t len)
+{
+	return DIV_ROUND_UP(addr + len - (addr & ~(parallel_window_size - 1)), parallel_window_size);
+}
+
+// Save each window of the mapping with a session of its own, so that the
+// windows are mapped and read in parallel, and written at their offsets. The
+// windows are aligned to the window size, so only the first and the last one
+// can be partial, and the mappings of the others are page aligned.
+static void save_parallel(const RwmemSession& session, const RwmemMapping& mapping, int fd, unsigned num_threads,
+			  Progress& progress)
+{
+	const uint64_t len = mapping.length;
+	const uint64_t aligned_start = mapping.offset & ~(parallel_window_size - 1);
+	const uint64_t end = mapping.offset + len;
+	const uint64_t num_windows = parallel_windows(mapping.offset, len);
+
+	// The windows are numeric ops with the mapping of the whole range
+	RwmemSessionOptions opts = session.options();
+	opts.user_map_type = true;
+	opts.map_type = mapping.type;
+	opts.user_data_size = true;
+	opts.data_size = mapping.data_size;
+
+	atomic<uint64_t> next_window = 0;
+	mutex lock;
+	// Protected by the lock
+	uint64_t done = 0;
+	exception_ptr error;
+
+	auto worker = [&]() {
+		try {
+			RwmemSession ws(opts);
+			unique_ptr<uint8_t, FreeDeleter> buf((uint8_t*)aligned_alloc(direct_align, chunk_size));
+			uint64_t window;
+
+			while ((window = next_window++) < num_windows) {
+				const uint64_t wstart = aligned_start + window * parallel_window_size;
+				// Offsets from the start of the mapping
+				const uint64_t start = max(wstart, mapping.offset) - mapping.offset;
+				const uint64_t wlen = min(wstart + parallel_window_size, end) - mapping.offset - start;
+
+				RwmemOp op = ws.parse_op(std::format("{:#x}+{:#x}", mapping.offset + start, wlen));
+				ws.map_range(op, 0, MapMode::Read);
+
+				for (uint64_t off = start; off < start + wlen; off += chunk_size) {
+					uint64_t n = min(chunk_size, start + wlen - off);
+
+					ws.read_range(mapping.offset + off, buf.get(), n);
+
+					write_full(fd, buf.get(), n, off);
+				}
+
+				lock_guard<mutex> guard(lock);
+				progress.update(done += wlen);
+			}
+		} catch (...) {
+			lock_guard<mutex> guard(lock);
+			if (!error)
+				error = current_exception();
+			// Stop the other workers
+			next_window = num_windows;
+		}
+	};
+
+	vector<thread> threads;
+	for (unsigned i = 1; i < num_threads; ++i)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (thread& t : threads)
+		t.join();
+
+	if (error)
+		rethrow_exception(error);
+}
+
+static void save(RwmemSession& session, const RwmemOp& op)
+{
+	RwmemMapping mapping = session.map_range(op, 0, MapMode::Read);
+	const uint64_t len = mapping.length;
+
+	// Parallel reads only pay off for RAM, registers are saved in order
+	unsigned num_threads = rwmem_opts.num_threads ? rwmem_opts.num_threads : thread::hardware_concurrency();
+
+	if (!rwmem_opts.num_threads && len < parallel_min_len)
+		num_threads = 1;
+
+	if (mapping.type == MapType::Uncached || !session.mmap_target())
+		num_threads = 1;
+
+	num_threads = (unsigned)min<uint64_t>(num_threads, parallel_windows(mapping.offset, len));
+
+	int fd = open_file(rwmem_opts.transfer_file, O_WRONLY | O_CREAT | O_TRUNC);
+
+	rwmem_vprint("Saving {:#x}+{:#x} to '{}'\n", mapping.offset, len, rwmem_opts.transfer_file);
+
+	Progress progress(len);
+
+	if (num_threads > 1) {
+		rwmem_vprint("Saving with {} threads, in windows of {:#x}\n", num_threads, parallel_window_size);
+
+		save_parallel(session, mapping, fd, num_threads, progress);
+	} else {
+		unique_ptr<uint8_t, FreeDeleter> buf((uint8_t*)aligned_alloc(direct_align, chunk_size));
+
+		for (uint64_t off = 0; off < len; off += chunk_size) {
+			uint64_t n = min(chunk_size, len - off);
+
+			session.read_range(mapping.offset + off, buf.get(), n);
+
+			write_full(fd, buf.get(), n, off);
+
+			progress.update(off + n);
+		}
+	}
+
+	ERR_ON(close(fd) != 0, "Failed to write '{}': {}", rwmem_opts.transfer_file, strerror(errno));
+
+	print_summary("Saved", "from", mapping.offset, len, progress.finish());
+}
+
+void transfer(RwmemSession& session)
+{
+	const RwmemOptsArg& arg = rwmem_opts.parsed_args[0];
+
+	try {
+		RwmemOp op = session.parse_op(arg);
+
+		if (rwmem_opts.transfer == Transfer::Load)
+			load(session, arg, op);
+		else
+			save(session, op);
+	} catch (const runtime_error& e) {
+		ERR("{}", e.what());
+	}
+}
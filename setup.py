@@ -0,0 +1,22 @@
+# The project metadata is in pyproject.toml. This only adds the optional
+# native accelerator, which is skipped if it fails to build.
+
+from setuptools import Extension, setup
+
+setup(
+    ext_modules=[
+        Extension(
+            'rwmem._rwmem',
+            sources=[
+                'py/ext/_rwmem.cpp',
+                'librwmem/mmaptarget.cpp',
+                'librwmem/regfiledata.cpp',
+            ],
+            include_dirs=['librwmem'],
+            define_macros=[('_FILE_OFFSET_BITS', '64')],
+            extra_compile_args=['-std=c++20'],
+            language='c++',
+            optional=True,
+        ),
+    ],
+)
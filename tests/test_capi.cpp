@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "../librwmem/librwmem.h"
+
+class CApiTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        rf = rwmem_regfile_open((std::string(TEST_DATA_DIR) + "/test.regdb").c_str());
+        ASSERT_NE(rf, nullptr) << rwmem_last_error();
+
+        // Writable copy of test.bin
+        bin_filename = "/tmp/rwmem_test_capi_" + std::to_string(getpid()) + ".bin";
+        std::ifstream src(std::string(TEST_DATA_DIR) + "/test.bin", std::ios::binary);
+        std::ofstream dst(bin_filename, std::ios::binary);
+        dst << src.rdbuf();
+    }
+
+    void TearDown() override {
+        rwmem_regfile_close(rf);
+        unlink(bin_filename.c_str());
+    }
+
+    rwmem_regfile* rf = nullptr;
+    std::string bin_filename;
+};
+
+TEST_F(CApiTest, Lookup) {
+    EXPECT_EQ(rwmem_api_version(), (uint32_t)RWMEM_API_VERSION);
+    EXPECT_EQ(rwmem_regfile_num_blocks(rf), 3U);
+
+    const rwmem_block* block = rwmem_regfile_find_block(rf, "memory_ctrl");
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block, rwmem_regfile_block_at(rf, 2));
+
+    rwmem_block_info bi;
+    ASSERT_EQ(rwmem_block_get_info(rf, block, &bi), 0);
+    EXPECT_STREQ(bi.name, "MEMORY_CTRL");
+    EXPECT_EQ(bi.offset, 512U);
+    EXPECT_EQ(bi.size, 256U);
+    EXPECT_EQ(bi.data_endianness, RWMEM_ENDIANNESS_BIG);
+    EXPECT_EQ(bi.data_size, 4);
+
+    const rwmem_register* reg = rwmem_block_find_register(rf, block, "CONFIG_REG");
+    ASSERT_NE(reg, nullptr);
+
+    rwmem_register_info ri;
+    ASSERT_EQ(rwmem_register_get_info(rf, block, reg, &ri), 0);
+    EXPECT_STREQ(ri.name, "CONFIG_REG");
+    EXPECT_EQ(ri.offset, 8U);
+    EXPECT_EQ(ri.data_size, 3);
+    EXPECT_EQ(ri.data_endianness, RWMEM_ENDIANNESS_BIG);
+
+    // By absolute address
+    const rwmem_block* found_block = nullptr;
+    EXPECT_EQ(rwmem_regfile_find_register(rf, 512 + 8, &found_block), reg);
+    EXPECT_EQ(found_block, block);
+
+    ASSERT_GT(ri.num_fields, 0U);
+    const rwmem_field* field = rwmem_register_field_at(rf, reg, 0);
+    ASSERT_NE(field, nullptr);
+
+    rwmem_field_info fi;
+    ASSERT_EQ(rwmem_field_get_info(rf, field, &fi), 0);
+    EXPECT_EQ(rwmem_register_find_field(rf, reg, fi.name), field);
+}
+
+TEST_F(CApiTest, NotFound) {
+    EXPECT_EQ(rwmem_regfile_find_block(rf, "NO_SUCH_BLOCK"), nullptr);
+    EXPECT_NE(std::string(rwmem_last_error()).find("NO_SUCH_BLOCK"), std::string::npos);
+
+    EXPECT_EQ(rwmem_regfile_block_at(rf, 3), nullptr);
+    EXPECT_EQ(rwmem_regfile_find_register(rf, 0x10000, nullptr), nullptr);
+
+    EXPECT_EQ(rwmem_regfile_open("/nonexistent.regdb"), nullptr);
+    EXPECT_NE(std::string(rwmem_last_error()), "");
+}
+
+TEST_F(CApiTest, FieldDecode) {
+    EXPECT_EQ(rwmem_field_decode(0x39, 7, 3), 0x7U);
+    EXPECT_EQ(rwmem_field_decode(0x39, 0, 0), 0x1U);
+    EXPECT_EQ(rwmem_field_decode(0x8000000000000000ULL, 63, 63), 1U);
+    EXPECT_EQ(rwmem_field_decode(~0ULL, 63, 0), ~0ULL);
+
+    EXPECT_EQ(rwmem_field_encode(0x39, 7, 3, 0x1f), 0xf9U);
+    // Extra bits of the field value are dropped
+    EXPECT_EQ(rwmem_field_encode(0x00, 2, 1, 0xff), 0x06U);
+}
+
+TEST_F(CApiTest, Target) {
+    rwmem_target* t = rwmem_target_open_mmap(bin_filename.c_str(), 0, 768, RWMEM_ENDIANNESS_LITTLE, 4,
+                                             RWMEM_MAP_READWRITE);
+    ASSERT_NE(t, nullptr) << rwmem_last_error();
+
+    uint64_t v;
+    ASSERT_EQ(rwmem_target_read(t, 0, 0, RWMEM_ENDIANNESS_DEFAULT, &v), 0);
+    EXPECT_EQ(v, 0x7d8c0c39U);
+
+    ASSERT_EQ(rwmem_target_write(t, 4, 0x12345678, 4, RWMEM_ENDIANNESS_BIG), 0);
+    ASSERT_EQ(rwmem_target_read(t, 4, 1, RWMEM_ENDIANNESS_DEFAULT, &v), 0);
+    EXPECT_EQ(v, 0x12U);
+
+    uint16_t out[4] = { 0x1111, 0x2222, 0x3333, 0x4444 };
+    ASSERT_EQ(rwmem_target_write_array(t, 0x100, out, 4, 2, RWMEM_ENDIANNESS_DEFAULT), 0);
+
+    uint16_t in[4] = {};
+    ASSERT_EQ(rwmem_target_read_array(t, 0x100, in, 4, 2, RWMEM_ENDIANNESS_DEFAULT), 0);
+    EXPECT_EQ(memcmp(in, out, sizeof(in)), 0);
+
+    uint32_t words[2];
+    ASSERT_EQ(rwmem_target_read_array(t, 0x100, words, 2, 0, RWMEM_ENDIANNESS_DEFAULT), 0);
+    EXPECT_EQ(words[0], 0x22221111U);
+
+    // Errors
+    EXPECT_EQ(rwmem_target_read(t, 768, 4, RWMEM_ENDIANNESS_DEFAULT, &v), -1);
+    EXPECT_NE(std::string(rwmem_last_error()), "");
+    EXPECT_EQ(rwmem_target_read_array(t, 0, in, 1, 3, RWMEM_ENDIANNESS_DEFAULT), -1);
+    EXPECT_EQ(rwmem_target_read_array(t, 760, words, 4, 4, RWMEM_ENDIANNESS_DEFAULT), -1);
+
+    rwmem_target_close(t);
+
+    EXPECT_EQ(rwmem_target_open_mmap("/nonexistent", 0, 4, RWMEM_ENDIANNESS_DEFAULT, 4, RWMEM_MAP_READ),
+              nullptr);
+}
+
+TEST_F(CApiTest, WindowedArrays) {
+    // A file of several small windows
+    const size_t len = 64 * 1024;
+    std::vector<uint32_t> data(len / 4);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (uint32_t)(i * 0x01010101U);
+
+    std::ofstream dst(bin_filename, std::ios::binary | std::ios::trunc);
+    dst.write((const char*)data.data(), len);
+    dst.close();
+
+    rwmem_target* t = rwmem_target_open_mmap(bin_filename.c_str(), 0, len, RWMEM_ENDIANNESS_LITTLE, 4,
+                                             RWMEM_MAP_READWRITE);
+    ASSERT_NE(t, nullptr) << rwmem_last_error();
+    ASSERT_EQ(rwmem_target_set_window_size(t, 8192), 0) << rwmem_last_error();
+
+    // Not at a window boundary, across all the windows but the first
+    std::vector<uint32_t> in(data.size() - 0x900);
+    ASSERT_EQ(rwmem_target_read_array(t, 0x2400, in.data(), in.size(), 4, RWMEM_ENDIANNESS_DEFAULT), 0)
+        << rwmem_last_error();
+    EXPECT_EQ(memcmp(in.data(), data.data() + 0x900, in.size() * 4), 0);
+
+    std::vector<uint16_t> out(len / 2);
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i] = (uint16_t)(i * 3);
+    ASSERT_EQ(rwmem_target_write_array(t, 0, out.data(), out.size(), 2, RWMEM_ENDIANNESS_DEFAULT), 0)
+        << rwmem_last_error();
+
+    std::vector<uint16_t> back(out.size());
+    ASSERT_EQ(rwmem_target_read_array(t, 0, back.data(), back.size(), 2, RWMEM_ENDIANNESS_DEFAULT), 0);
+    EXPECT_EQ(back, out);
+
+    rwmem_target_close(t);
+}
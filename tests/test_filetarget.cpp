@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "../librwmem/filetarget.h"
+#include "../librwmem/mmaptarget.h"
+#include "../librwmem/endianness.h"
+
+class FileTargetTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_filename = std::string(TEST_DATA_DIR) + "/test.bin";
+
+        struct stat st;
+        if (stat(test_filename.c_str(), &st) != 0) {
+            FAIL() << "Test data file not found: " << test_filename;
+        }
+
+        std::ifstream src(test_filename, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(src), std::istreambuf_iterator<char>());
+        src.close();
+
+        // Create a writable copy for write tests
+        writable_filename = "/tmp/rwmem_test_file_" + std::to_string(getpid()) + ".bin";
+        std::ofstream dst(writable_filename, std::ios::binary);
+        dst.write((const char*)contents.data(), contents.size());
+        dst.close();
+    }
+
+    void TearDown() override {
+        unlink(writable_filename.c_str());
+    }
+
+    std::string test_filename;
+    std::string writable_filename;
+    std::vector<uint8_t> contents;
+};
+
+TEST_F(FileTargetTest, ReadsMatchMMap) {
+    FileTarget file(test_filename);
+    MMapTarget mmap(test_filename);
+
+    file.map(0, 768, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read);
+    mmap.map(0, 768, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read);
+
+    EXPECT_EQ(file.read(0, 4, Endianness::Little), 0x7d8c0c39U);
+    EXPECT_EQ(file.read(0, 0, Endianness::Default), 0x7d8c0c39U);
+
+    for (uint8_t nbytes = 1; nbytes <= 8; ++nbytes) {
+        for (Endianness e : { Endianness::Little, Endianness::Big, Endianness::BigSwapped,
+                              Endianness::LittleSwapped }) {
+            for (uint64_t addr : { 0, 5, 0x100, 768 - 8 }) {
+                EXPECT_EQ(file.read(addr, nbytes, e), mmap.read(addr, nbytes, e))
+                    << "addr " << addr << " size " << (int)nbytes << " endianness " << (int)e;
+            }
+        }
+    }
+}
+
+TEST_F(FileTargetTest, Write) {
+    FileTarget target(writable_filename);
+    target.map(0, 768, Endianness::Little, 4, Endianness::Little, 4, MapMode::ReadWrite);
+
+    target.write(100, 0x12345678, 4, Endianness::Little);
+    EXPECT_EQ(target.read(100, 4, Endianness::Little), 0x12345678U);
+    EXPECT_EQ(target.read(100, 1, Endianness::Little), 0x78U);
+
+    target.write(104, 0x123456, 3, Endianness::Big);
+    EXPECT_EQ(target.read(104, 3, Endianness::Big), 0x123456U);
+    EXPECT_EQ(target.read(104, 1, Endianness::Little), 0x12U);
+
+    target.write(108, 0xFEDCBA0987654321ULL, 8, Endianness::Big);
+    EXPECT_EQ(target.read(108, 8, Endianness::Big), 0xFEDCBA0987654321ULL);
+
+    EXPECT_NO_THROW(target.sync());
+
+    // The file has the bytes
+    MMapTarget mmap(writable_filename);
+    mmap.map(0, 768, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read);
+    EXPECT_EQ(mmap.read(100, 4, Endianness::Little), 0x12345678U);
+}
+
+TEST_F(FileTargetTest, Errors) {
+    FileTarget target(test_filename);
+    target.map(0x10, 0x20, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read);
+
+    EXPECT_THROW(target.read(0xc, 4, Endianness::Little), std::runtime_error);
+    EXPECT_THROW(target.read(0x2e, 4, Endianness::Little), std::runtime_error);
+    EXPECT_NO_THROW(target.read(0x2c, 4, Endianness::Little));
+    EXPECT_THROW(target.write(0x10, 0, 4, Endianness::Little), std::runtime_error);
+    EXPECT_THROW(target.read(0x10, 9, Endianness::Little), std::runtime_error);
+
+    // Past the end of the file
+    EXPECT_THROW(target.map(0, 769, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read),
+                 std::runtime_error);
+
+    FileTarget missing("/nonexistent/rwmem-test");
+    EXPECT_THROW(missing.map(0, 4, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read),
+                 std::runtime_error);
+}
+
+TEST_F(FileTargetTest, RangeAccesses) {
+    // Batched with io_uring, if the kernel supports it, and one by one
+    for (bool use_io_uring : { true, false }) {
+        FileTarget target(writable_filename, use_io_uring);
+        target.map(0, 768, Endianness::Little, 4, Endianness::Little, 4, MapMode::ReadWrite);
+
+        if (!use_io_uring) {
+            EXPECT_FALSE(target.batched());
+        }
+
+        for (uint8_t nbytes : { 1, 2, 4, 8 }) {
+            std::vector<uint8_t> buf(768);
+
+            target.map(0, 768, Endianness::Little, 4, Endianness::Little, nbytes, MapMode::ReadWrite);
+            target.read_range(0, buf.data(), buf.size());
+
+            EXPECT_EQ(buf, contents) << "io_uring " << use_io_uring << " size " << (int)nbytes;
+
+            // One system call per access, or per batch
+            const uint64_t accesses = buf.size() / nbytes;
+            if (target.batched()) {
+                EXPECT_LE(target.range_syscalls(), (accesses + 63) / 64 * 2);
+            } else {
+                EXPECT_EQ(target.range_syscalls(), accesses);
+            }
+
+            // Not at the start of the range
+            std::vector<uint8_t> part(0x40);
+            target.read_range(0x48, part.data(), part.size(), 8);
+            EXPECT_EQ(memcmp(part.data(), contents.data() + 0x48, part.size()), 0);
+
+            for (size_t i = 0; i < buf.size(); ++i)
+                buf[i] = (uint8_t)(i * 7 + nbytes);
+
+            target.write_range(0, buf.data(), buf.size());
+
+            std::vector<uint8_t> back(768);
+            target.read_range(0, back.data(), back.size());
+            EXPECT_EQ(back, buf);
+            EXPECT_EQ(target.read(0x10, 1, Endianness::Little), (uint8_t)(0x10 * 7 + nbytes));
+
+            target.write_range(0, contents.data(), contents.size());
+        }
+
+        uint8_t buf[8];
+        EXPECT_THROW(target.read_range(0x300, buf, 4), std::runtime_error);
+        EXPECT_THROW(target.read_range(0, buf, 6, 4), std::runtime_error);
+    }
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+
+#include "../rwmem/latency.h"
+
+TEST(LatencyHistogramTest, Buckets) {
+    // Exact below the sub bucket count
+    for (uint64_t ns = 0; ns < 8; ++ns) {
+        EXPECT_EQ(LatencyHistogram::bucket(ns), ns);
+        EXPECT_EQ(LatencyHistogram::bucket_low(ns), ns);
+        EXPECT_EQ(LatencyHistogram::bucket_high(ns), ns);
+    }
+
+    // Every value is within its bucket, and buckets are contiguous
+    for (uint64_t ns : { 8ULL, 15ULL, 16ULL, 17ULL, 100ULL, 1000ULL, 123456789ULL, ~0ULL }) {
+        unsigned idx = LatencyHistogram::bucket(ns);
+        ASSERT_LT(idx, LatencyHistogram::num_buckets);
+        EXPECT_LE(LatencyHistogram::bucket_low(idx), ns);
+        EXPECT_GE(LatencyHistogram::bucket_high(idx), ns);
+        // 3 significant bits
+        EXPECT_LE(LatencyHistogram::bucket_high(idx) - LatencyHistogram::bucket_low(idx), ns / 8);
+    }
+
+    for (unsigned idx = 0; idx + 1 < LatencyHistogram::num_buckets; ++idx)
+        ASSERT_EQ(LatencyHistogram::bucket_high(idx) + 1, LatencyHistogram::bucket_low(idx + 1)) << idx;
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram h;
+
+    EXPECT_EQ(h.percentile(50), 0U);
+
+    for (uint64_t ns = 1; ns <= 100; ++ns)
+        h.add(ns * 10);
+
+    EXPECT_EQ(h.count(), 100U);
+    EXPECT_EQ(h.min(), 10U);
+    EXPECT_EQ(h.max(), 1000U);
+    EXPECT_EQ(h.mean(), 505U);
+
+    // Within the bucket resolution
+    EXPECT_GE(h.percentile(50), 500U);
+    EXPECT_LE(h.percentile(50), 500U + 500U / 8);
+    EXPECT_GE(h.percentile(99), 990U);
+    EXPECT_EQ(h.percentile(100), 1000U);
+    EXPECT_EQ(h.percentile(0), 10U);
+}
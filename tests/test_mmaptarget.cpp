@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <cstring>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <fstream>
+#include <vector>
 
 #include "../librwmem/mmaptarget.h"
 #include "../librwmem/endianness.h"
@@ -487,3 +489,242 @@ TEST_F(MMapTargetTest, KnownDataValidation) {
     value = target.read(0x1c, 4, Endianness::Little);
     EXPECT_EQ(value, 0x31c22f34U);
 }
+
+TEST_F(MMapTargetTest, UncheckedMatchesChecked) {
+    MMapTarget target(test_filename);
+    target.map(0, 768, Endianness::Little, 4,
+               Endianness::Little, 4, MapMode::Read);
+
+    const Endianness endiannesses[] = {
+        Endianness::Big, Endianness::Little, Endianness::BigSwapped, Endianness::LittleSwapped,
+    };
+
+    for (uint8_t nbytes = 1; nbytes <= 8; ++nbytes) {
+        for (Endianness e : endiannesses) {
+            MMapAccessor acc = target.accessor(nbytes, e);
+
+            for (uint64_t addr = 0; addr < 64; addr += nbytes)
+                EXPECT_EQ(target.read_unchecked(acc, addr), target.read(addr, nbytes, e))
+                    << "nbytes " << (int)nbytes << " endianness " << (int)e;
+        }
+    }
+
+    // The map defaults
+    MMapAccessor acc = target.accessor();
+    EXPECT_EQ(target.read_unchecked(acc, 0), 0x7d8c0c39U);
+}
+
+TEST_F(MMapTargetTest, UncheckedWrite) {
+    MMapTarget target(writable_filename);
+    target.map(0, 768, Endianness::Little, 4,
+               Endianness::Big, 4, MapMode::ReadWrite);
+
+    MMapAccessor acc = target.accessor(2, Endianness::Default);
+    target.validate_range(0x20, 8, true);
+
+    for (uint64_t addr = 0x20; addr < 0x28; addr += 2)
+        target.write_unchecked(acc, addr, addr);
+
+    EXPECT_EQ(target.read(0x20, 8, Endianness::Big), 0x0020002200240026ULL);
+}
+
+TEST_F(MMapTargetTest, ValidateRange) {
+    MMapTarget target(test_filename);
+    target.map(0x10, 0x100, Endianness::Little, 4,
+               Endianness::Little, 4, MapMode::Read);
+
+    EXPECT_NO_THROW(target.validate_range(0x10, 0x100));
+    EXPECT_THROW(target.validate_range(0x0, 0x10), std::runtime_error);
+    EXPECT_THROW(target.validate_range(0x10, 0x101), std::runtime_error);
+    EXPECT_THROW(target.validate_range(0x20, ~0ULL), std::runtime_error);
+    EXPECT_THROW(target.validate_range(0x10, 4, true), std::runtime_error);
+
+    EXPECT_THROW(target.accessor(9, Endianness::Little), std::runtime_error);
+    EXPECT_THROW(target.read(0x10, 9, Endianness::Little), std::runtime_error);
+}
+
+TEST_F(MMapTargetTest, MapTypes) {
+    EXPECT_EQ(parse_map_type("uc"), MapType::Uncached);
+    EXPECT_EQ(parse_map_type("wc"), MapType::WriteCombine);
+    EXPECT_EQ(parse_map_type("cached"), MapType::Cached);
+    EXPECT_THROW(parse_map_type("wb"), std::runtime_error);
+
+    for (MapType type : { MapType::Uncached, MapType::WriteCombine, MapType::Cached }) {
+        MMapTarget target(writable_filename, type);
+        EXPECT_EQ(target.map_type(), type);
+
+        target.map(0, 768, Endianness::Little, 4,
+                   Endianness::Little, 4, MapMode::ReadWrite);
+
+        EXPECT_EQ(target.read(0, 4, Endianness::Little), 0x7d8c0c39U);
+
+        // Single writes are flushed like range writes
+        target.write(0x40, 0x12345678, 4, Endianness::Little);
+        EXPECT_EQ(target.read_unchecked(target.accessor(), 0x40), 0x12345678U);
+        target.write(0x44, 0x9abcdef0, 0, Endianness::Default);
+        EXPECT_EQ(target.read(0x44, 4, Endianness::Little), 0x9abcdef0U);
+    }
+}
+
+TEST_F(MMapTargetTest, FillAndUpdate) {
+    MMapTarget ref_target(test_filename);
+    ref_target.map(0, 768, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read);
+
+    for (MapType type : { MapType::Uncached, MapType::Cached }) {
+        for (uint8_t nbytes : { 1, 2, 3, 4, 8 }) {
+            for (Endianness e : { Endianness::Little, Endianness::Big }) {
+                MMapTarget target(writable_filename, type);
+                // Odd start and length, so that there are unaligned heads and tails
+                target.map(0, 768, e, 4, e, nbytes, MapMode::ReadWrite);
+
+                const uint64_t start = nbytes * 3;
+                const uint64_t len = nbytes * 60 + 1;
+                const uint64_t mask = 0xf0ULL << ((nbytes - 1) * 8);
+                const uint64_t value = 0xa5a5a5a5a5a5a5a5ULL;
+
+                target.update(start, len, mask, value);
+
+                for (uint64_t addr = 0; addr + nbytes <= 768; addr += nbytes) {
+                    uint64_t old = ref_target.read(addr, nbytes, e);
+                    uint64_t expected = old;
+                    if (addr >= start && addr + nbytes <= start + len)
+                        expected = (old & ~mask) | (value & mask);
+                    ASSERT_EQ(target.read(addr, nbytes, e), expected)
+                        << "update nbytes " << (int)nbytes << " addr " << addr;
+                }
+
+                target.fill(start, len, 0x0102030405060708ULL);
+
+                const uint64_t elem = 0x0102030405060708ULL & (~0ULL >> (64 - nbytes * 8));
+
+                for (uint64_t addr = start; addr + nbytes <= start + len; addr += nbytes)
+                    ASSERT_EQ(target.read(addr, nbytes, e), elem)
+                        << "fill nbytes " << (int)nbytes << " addr " << addr;
+
+                // Restore the original contents for the next round
+                for (uint64_t addr = 0; addr < 768; addr += 4)
+                    target.write(addr, ref_target.read(addr, 4, Endianness::Little), 4, Endianness::Little);
+            }
+        }
+    }
+
+    MMapTarget ro_target(writable_filename);
+    ro_target.map(0, 768, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read);
+    EXPECT_THROW(ro_target.fill(0, 16, 0), std::runtime_error);
+    EXPECT_THROW(ro_target.update(0x300, 4, 1, 1), std::runtime_error);
+}
+
+TEST_F(MMapTargetTest, WindowedMapping) {
+    const long pagesize = sysconf(_SC_PAGESIZE);
+    const uint64_t file_len = pagesize * 16 + 100;
+
+    // Each 32-bit element holds its offset
+    {
+        std::ofstream dst(writable_filename, std::ios::binary | std::ios::trunc);
+        for (uint32_t off = 0; off < file_len; off += 4)
+            dst.write(reinterpret_cast<const char*>(&off), 4);
+    }
+
+    MMapTarget target(writable_filename, MapType::Cached);
+    target.set_window_size(pagesize * 3 - 100);
+    EXPECT_EQ(target.window_size(), (uint64_t)pagesize * 3);
+
+    target.map(0x10, file_len - 0x10, Endianness::Little, 4, Endianness::Little, 4, MapMode::ReadWrite);
+
+    // The window starts at the page of the address
+    EXPECT_EQ(target.window_len(0x10, file_len), (uint64_t)pagesize * 3 - 0x10);
+    EXPECT_EQ(target.window_len(0x10, 8), 8U);
+
+    for (uint64_t addr = 0x10; addr + 4 <= file_len; addr += 4)
+        ASSERT_EQ(target.read(addr, 4, Endianness::Little), addr) << "addr " << addr;
+
+    EXPECT_EQ(target.window_moves(), 5U);
+
+    // Backwards, and an element straddling a window end
+    const uint64_t end = pagesize * 3;
+    EXPECT_EQ(target.read(0x10, 4, Endianness::Little), 0x10U);
+    EXPECT_EQ(target.read(end - 2, 4, Endianness::Little), ((end - 4) >> 16) | ((end & 0xffff) << 16));
+
+    // Ranges must fit in a window, range writes are split
+    EXPECT_THROW(target.validate_range(0x10, pagesize * 3), std::runtime_error);
+    EXPECT_NO_THROW(target.validate_range(pagesize * 5, pagesize * 3));
+
+    target.fill(0x10, file_len - 0x10, 0x5a5a5a5a);
+    target.update(0x10, file_len - 0x10, 0xff, 0x11);
+
+    MMapTarget whole(writable_filename);
+    whole.set_window_size(0);
+    whole.map(0, file_len, Endianness::Little, 4, Endianness::Little, 4, MapMode::Read);
+
+    EXPECT_EQ(whole.read(0xc, 4, Endianness::Little), 0xcU);
+    for (uint64_t addr = 0x10; addr + 4 <= file_len; addr += 4)
+        ASSERT_EQ(whole.read(addr, 4, Endianness::Little), 0x5a5a5a11U) << "addr " << addr;
+
+    EXPECT_EQ(whole.window_moves(), 0U);
+}
+
+TEST_F(MMapTargetTest, ArrayAccesses) {
+    const long pagesize = sysconf(_SC_PAGESIZE);
+    const uint64_t file_len = pagesize * 8;
+
+    ASSERT_EQ(truncate(writable_filename.c_str(), file_len), 0) << strerror(errno);
+
+    MMapTarget target(writable_filename, MapType::Cached);
+    target.set_window_size(pagesize * 2);
+    target.map(0, file_len, Endianness::Little, 4, Endianness::Little, 4, MapMode::ReadWrite);
+
+    // Across the windows, not starting at a window boundary
+    std::vector<uint16_t> out((file_len - 0x100) / 2);
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i] = (uint16_t)(i * 3);
+
+    target.write_array(0x100, out.data(), out.size());
+    target.write_array(0x100, out.data(), 1, Endianness::Big);
+
+    std::vector<uint16_t> in(out.size());
+    target.read_array(0x100, in.data(), in.size());
+    EXPECT_EQ(in[0], 0);
+    EXPECT_TRUE(std::equal(in.begin() + 1, in.end(), out.begin() + 1));
+    EXPECT_GT(target.window_moves(), 4U);
+
+    uint32_t words[2];
+    target.read_array(0x102, words, 2, Endianness::Big);
+    EXPECT_EQ(words[0], 0x03000600U);
+
+    EXPECT_EQ(target.read(0x100, 2, Endianness::Little), 0U);
+    EXPECT_THROW(target.read_array(file_len - 4, words, 2), std::runtime_error);
+}
+
+TEST_F(MMapTargetTest, WindowedMappingPast4GiB) {
+    const long pagesize = sysconf(_SC_PAGESIZE);
+    // Sparse, larger than a 32-bit address space
+    const uint64_t file_len = (uint64_t)UINT32_MAX + 1 + pagesize * 4;
+
+    ASSERT_EQ(truncate(writable_filename.c_str(), file_len), 0) << strerror(errno);
+
+    MMapTarget target(writable_filename);
+    target.set_window_size(pagesize * 2);
+    target.map(0, file_len, Endianness::Little, 4, Endianness::Little, 4, MapMode::ReadWrite);
+
+    EXPECT_EQ(target.read(0, 4, Endianness::Little), 0x7d8c0c39U);
+
+    // Past 4 GiB, and the last element of the range
+    const uint64_t high = (uint64_t)UINT32_MAX + 1 + pagesize;
+    target.write(high, 0x12345678, 4, Endianness::Little);
+    EXPECT_EQ(target.read(high, 4, Endianness::Little), 0x12345678U);
+    target.write(file_len - 8, 0x1122334455667788ULL, 8, Endianness::Little);
+    EXPECT_EQ(target.read(file_len - 8, 8, Endianness::Little), 0x1122334455667788ULL);
+
+    EXPECT_EQ(target.window_len(high, pagesize * 8), (uint64_t)pagesize * 2);
+    EXPECT_THROW(target.read(file_len, 4, Endianness::Little), std::runtime_error);
+
+    target.unmap();
+
+    // The data is in the file
+    int fd = open(writable_filename.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    uint32_t v = 0;
+    EXPECT_EQ(pread(fd, &v, 4, high), 4);
+    EXPECT_EQ(v, 0x12345678U);
+    close(fd);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+
+#include "../librwmem/regs.h"
+#include "../librwmem/nameindex.h"
+
+class RegisterNameIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        regfile = std::make_unique<RegisterFile>(std::string(TEST_DATA_DIR) + "/test.regdb");
+        rfd = regfile->data();
+    }
+
+    std::unique_ptr<RegisterFile> regfile;
+    const RegisterFileData* rfd;
+};
+
+TEST_F(RegisterNameIndexTest, BlockPrefix) {
+    RegisterNameIndex index(rfd);
+
+    auto all = index.blocks_with_prefix("");
+    ASSERT_EQ(all.size(), 3U);
+    EXPECT_STREQ(all[0]->name(rfd), "MEMORY_CTRL");
+    EXPECT_STREQ(all[1]->name(rfd), "SENSOR_A");
+    EXPECT_STREQ(all[2]->name(rfd), "SENSOR_B");
+
+    auto sensors = index.blocks_with_prefix("sensor_");
+    ASSERT_EQ(sensors.size(), 2U);
+    EXPECT_STREQ(sensors[0]->name(rfd), "SENSOR_A");
+    EXPECT_STREQ(sensors[1]->name(rfd), "SENSOR_B");
+
+    EXPECT_TRUE(index.blocks_with_prefix("SENSOR_C").empty());
+    EXPECT_TRUE(index.blocks_with_prefix("ZZZ").empty());
+}
+
+TEST_F(RegisterNameIndexTest, RegisterAndFieldPrefix) {
+    RegisterNameIndex index(rfd);
+
+    const RegisterBlockData* rbd = index.find_block("sensor_a");
+    ASSERT_NE(rbd, nullptr);
+    EXPECT_STREQ(rbd->name(rfd), "SENSOR_A");
+
+    auto regs = index.registers_with_prefix(rbd, "CO");
+    ASSERT_EQ(regs.size(), 3U);
+    EXPECT_STREQ(regs[0]->name(rfd), "CONFIG_REG");
+    EXPECT_STREQ(regs[1]->name(rfd), "CONTROL_REG");
+    EXPECT_STREQ(regs[2]->name(rfd), "COUNTER_REG");
+
+    const RegisterData* rd = index.find_register(rbd, "STATUS_REG");
+    ASSERT_NE(rd, nullptr);
+
+    auto fields = index.fields_with_prefix(rd, "");
+    ASSERT_EQ(fields.size(), 3U);
+    EXPECT_STREQ(fields[0]->name(rfd), "ERROR");
+    EXPECT_STREQ(fields[1]->name(rfd), "MODE");
+    EXPECT_STREQ(fields[2]->name(rfd), "READY");
+
+    EXPECT_EQ(index.find_block("SENSOR"), nullptr);
+    EXPECT_EQ(index.find_register(rbd, "STATUS"), nullptr);
+}
+
+TEST_F(RegisterNameIndexTest, Cache) {
+    std::string cache = "/tmp/rwmem_test_nameindex_" + std::to_string(getpid()) + ".idx";
+
+    RegisterNameIndex index(rfd);
+    EXPECT_FALSE(index.load_cache(cache, 1));
+
+    index.save_cache(cache, 1);
+
+    RegisterNameIndex cached(rfd);
+    EXPECT_FALSE(cached.load_cache(cache, 2));
+    EXPECT_TRUE(cached.load_cache(cache, 1));
+
+    auto blocks = cached.blocks_with_prefix("S");
+    ASSERT_EQ(blocks.size(), 2U);
+    EXPECT_STREQ(blocks[0]->name(rfd), "SENSOR_A");
+
+    unlink(cache.c_str());
+}
@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 #include <cstring>
 #include <fstream>
+#include <stdexcept>
 #include <vector>
 
 #include "../librwmem/regfiledata.h"
+#include "../librwmem/regs.h"
 
 class RegisterFileDataTest : public ::testing::Test {
 protected:
@@ -194,3 +196,90 @@ TEST_F(RegisterFileDataTest, RegisterSharing) {
     EXPECT_EQ(status_a->offset(), 0x00U);
     EXPECT_EQ(status_b->offset(), 0x00U);
 }
+
+TEST_F(RegisterFileDataTest, ValidateAcceptsTestFile) {
+    EXPECT_NO_THROW(rfd->validate(test_data.size()));
+}
+
+TEST_F(RegisterFileDataTest, ValidateRejectsTruncatedFile) {
+    EXPECT_THROW(rfd->validate(sizeof(RegisterFileData) - 1), std::runtime_error);
+
+    // Cut inside the tables
+    EXPECT_THROW(rfd->validate(sizeof(RegisterFileData) + 10), std::runtime_error);
+
+    // Cut inside the string pool, leaving the last string unterminated
+    EXPECT_THROW(rfd->validate(test_data.size() - 1), std::runtime_error);
+}
+
+TEST_F(RegisterFileDataTest, ValidateRejectsBadRegisterIndex) {
+    uint32_t* reg_indices = const_cast<uint32_t*>(rfd->register_indices());
+    reg_indices[0] = htole32(rfd->num_regs());
+
+    EXPECT_THROW(rfd->validate(test_data.size()), std::runtime_error);
+}
+
+TEST_F(RegisterFileDataTest, ValidateRejectsBadFieldIndex) {
+    uint32_t* field_indices = const_cast<uint32_t*>(rfd->field_indices());
+    field_indices[rfd->num_field_indices() - 1] = htole32(0xffffffff);
+
+    EXPECT_THROW(rfd->validate(test_data.size()), std::runtime_error);
+}
+
+TEST_F(RegisterFileDataTest, ValidateRejectsBadCounts) {
+    // num_blocks is the fourth header word
+    uint32_t* header = reinterpret_cast<uint32_t*>(test_data.data());
+    header[3] = htole32(0x10000000);
+
+    EXPECT_THROW(rfd->validate(test_data.size()), std::runtime_error);
+}
+
+TEST_F(RegisterFileDataTest, ValidateRejectsBadStringOffset) {
+    const size_t strings_size = test_data.data() + test_data.size() - reinterpret_cast<const uint8_t*>(rfd->strings());
+
+    // name_offset is the first word of the first block, right after the header
+    uint32_t bad_offset = htole32(strings_size);
+    memcpy(test_data.data() + sizeof(RegisterFileData), &bad_offset, sizeof(bad_offset));
+
+    EXPECT_THROW(rfd->validate(test_data.size()), std::runtime_error);
+}
+
+TEST_F(RegisterFileDataTest, ValidateHeader) {
+    const size_t strings_size = test_data.data() + test_data.size() - reinterpret_cast<const uint8_t*>(rfd->strings());
+
+    EXPECT_EQ(rfd->validate_header(test_data.size()), strings_size);
+    EXPECT_THROW(rfd->validate_header(sizeof(RegisterFileData) + 10), std::runtime_error);
+    EXPECT_THROW(rfd->validate_header(test_data.size() - 1), std::runtime_error);
+
+    // The tables are not checked
+    uint32_t* reg_indices = const_cast<uint32_t*>(rfd->register_indices());
+    reg_indices[0] = htole32(rfd->num_regs());
+
+    EXPECT_NO_THROW(rfd->validate_header(test_data.size()));
+}
+
+TEST_F(RegisterFileDataTest, RegisterFileAccessModes) {
+    for (RegisterFileAccess access : { RegisterFileAccess::Default, RegisterFileAccess::Random,
+                                       RegisterFileAccess::Sequential, RegisterFileAccess::Populate,
+                                       RegisterFileAccess::Hugepage }) {
+        RegisterFile rf(test_regdb_filename, true, access);
+
+        EXPECT_STREQ(rf.name(), "TEST_V3");
+        EXPECT_EQ(rf.size(), test_data.size());
+        EXPECT_NE(rf.find_register_block("SENSOR_B"), nullptr);
+    }
+}
+
+TEST_F(RegisterFileDataTest, RegisterFileRejectsTruncatedFile) {
+    const std::string filename = ::testing::TempDir() + "truncated.regdb";
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(test_data.data()), test_data.size() / 2);
+    file.close();
+
+    EXPECT_THROW(RegisterFile rf(filename), std::runtime_error);
+
+    // Only the header is checked without validation
+    EXPECT_NO_THROW(RegisterFile rf(filename, false));
+
+    std::remove(filename.c_str());
+}
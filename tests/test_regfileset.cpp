@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "../librwmem/regfileset.h"
+
+class RegisterFileSetTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        regfiles.load(std::string(TEST_DATA_DIR) + "/test.regdb");
+        regfiles.load(std::string(TEST_DATA_DIR) + "/test-overlay.regdb");
+    }
+
+    RegisterFileSet regfiles;
+};
+
+TEST_F(RegisterFileSetTest, Blocks) {
+    ASSERT_EQ(regfiles.num_files(), 2U);
+
+    // SENSOR_B of the base file is shadowed by the overlay
+    const auto& blocks = regfiles.blocks();
+    ASSERT_EQ(blocks.size(), 4U);
+    EXPECT_STREQ(blocks[0].rbd->name(blocks[0].rfd), "SENSOR_A");
+    EXPECT_STREQ(blocks[1].rbd->name(blocks[1].rfd), "MEMORY_CTRL");
+    EXPECT_STREQ(blocks[2].rbd->name(blocks[2].rfd), "SENSOR_B");
+    EXPECT_STREQ(blocks[3].rbd->name(blocks[3].rfd), "BOARD_DEV");
+
+    EXPECT_FALSE(regfiles.is_shadowed(0, 0));
+    EXPECT_TRUE(regfiles.is_shadowed(0, 1));
+    EXPECT_FALSE(regfiles.is_shadowed(0, 2));
+    EXPECT_FALSE(regfiles.is_shadowed(1, 0));
+    EXPECT_FALSE(regfiles.is_shadowed(1, 1));
+}
+
+TEST_F(RegisterFileSetTest, FindBlock) {
+    const RegisterBlockRef* rb = regfiles.find_block("sensor_b");
+    ASSERT_NE(rb, nullptr);
+    EXPECT_EQ(rb->rfd, regfiles.file(1).data());
+    EXPECT_EQ(rb->rbd->num_regs(), 1U);
+    EXPECT_STREQ(rb->rbd->register_at(rb->rfd, 0)->name(rb->rfd), "ID_REG");
+
+    rb = regfiles.find_block("MEMORY_CTRL");
+    ASSERT_NE(rb, nullptr);
+    EXPECT_EQ(rb->rfd, regfiles.file(0).data());
+
+    EXPECT_EQ(regfiles.find_block("NOPE"), nullptr);
+}
+
+TEST_F(RegisterFileSetTest, FindRegisterByAddress) {
+    const RegisterBlockRef* rb = nullptr;
+
+    const RegisterData* rd = regfiles.find_register(0x100, &rb);
+    ASSERT_NE(rd, nullptr);
+    EXPECT_STREQ(rd->name(rb->rfd), "ID_REG");
+
+    // Registers of the shadowed block are gone
+    EXPECT_EQ(regfiles.find_register(0x101, &rb), nullptr);
+
+    rd = regfiles.find_register(0x20c, &rb);
+    ASSERT_NE(rd, nullptr);
+    EXPECT_STREQ(rb->rbd->name(rb->rfd), "MEMORY_CTRL");
+    EXPECT_STREQ(rd->name(rb->rfd), "STATUS_REG");
+
+    rd = regfiles.find_register(0x280, &rb);
+    ASSERT_NE(rd, nullptr);
+    EXPECT_STREQ(rd->name(rb->rfd), "CTRL_REG");
+}
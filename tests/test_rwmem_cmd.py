@@ -1,6 +1,7 @@
 #!/usr/bin/env python3
 
 import os
+import random
 import shutil
 import stat
 import subprocess
@@ -10,6 +11,7 @@ import unittest
 RWMEM_CMD_PATH = os.path.dirname(os.path.abspath(__file__)) + '/../build/rwmem/rwmem'
 DATA_BIN_PATH = os.path.dirname(os.path.abspath(__file__)) + '/test.bin'
 TEST_REGDB_PATH = os.path.dirname(os.path.abspath(__file__)) + '/test.regdb'
+TEST_OVERLAY_REGDB_PATH = os.path.dirname(os.path.abspath(__file__)) + '/test-overlay.regdb'
 
 
 class RwmemTestBase(unittest.TestCase):
@@ -55,6 +57,20 @@ class RwmemNumericReadTests(RwmemTestBase):
 
         self.assertOutput(['-d', '24be', '0'], '0x00 = 0x390c8c\n')
 
+    def test_numeric_reads_map_types(self):
+        for map_type in ['uc', 'wc', 'cached']:
+            self.assertOutput(
+                ['--map', map_type, '0x0+0x8'], '0x00 = 0x7d8c0c39\n' + '0x04 = 0x2c344772\n'
+            )
+
+        res = subprocess.run(
+            [self.rwmem_cmd, *self.rwmem_common_opts, '--map', 'wb', '0x0'],
+            capture_output=True,
+            encoding='ASCII',
+            check=False,
+        )
+        self.assertNotEqual(res.returncode, 0, res)
+
     def test_numeric_reads_ranges(self):
         self.assertOutput(
             ['0x0-0x10'],
@@ -119,6 +135,26 @@ class RwmemNumericWriteTests(RwmemTestBase):
             + '0x1c (+0xc) = 0x31c22f34 := 0x00001234 -> 0x00001234\n',
         )
 
+    def test_numeric_writes_ranges_quiet(self):
+        for map_type in ['uc', 'cached']:
+            shutil.copy2(DATA_BIN_PATH, self.tmpfile_name)
+
+            self.assertOutput(['--map', map_type, '-p', 'q', '0x10+0x10=0x1234'], '')
+            self.assertOutput(['--map', map_type, '-p', 'q', '0x10+0x10:31:28=0x5'], '')
+            self.assertOutput(['--map', map_type, '-p', 'q', '-w', 'w', '-d', '8', '0x1+0x2=0x12'], '')
+
+            self.assertOutput(
+                ['0x0+0x20'],
+                '0x00 = 0x7d121239\n'
+                + '0x04 = 0x2c344772\n'
+                + '0x08 = 0x2f0f10d8\n'
+                + '0x0c = 0x650d776f\n'
+                + '0x10 = 0x50001234\n'
+                + '0x14 = 0x50001234\n'
+                + '0x18 = 0x50001234\n'
+                + '0x1c = 0x50001234\n',
+            )
+
 
 class RwmemRegisterDatabaseTests(RwmemTestBase):
     def setUp(self):
@@ -141,6 +177,28 @@ class RwmemRegisterDatabaseTests(RwmemTestBase):
         self.assertIn('SENSOR_B:', res.stdout)
         self.assertIn('MEMORY_CTRL:', res.stdout)
 
+    def test_regdb_list_threads(self):
+        # --threads matches the register patterns in parallel, however small
+        # the register file, with the same output
+        def run(args):
+            res = subprocess.run(
+                [self.rwmem_cmd, 'list', '--regs=' + TEST_REGDB_PATH, *args],
+                capture_output=True,
+                encoding='ASCII',
+                check=False,
+            )
+            self.assertEqual(res.returncode, 0, res)
+            return res
+
+        for patterns in [['*.*'], ['*.*:*'], ['SENS*.*_REG', 'MEMORY_CTRL.*'], ['*.*:E*']]:
+            expected = run(['--threads', '1', *patterns]).stdout
+            self.assertNotIn('threads', run(['-v', '--threads', '1', *patterns]).stderr)
+
+            for threads in ['2', '4']:
+                res = run(['-v', '--threads', threads, *patterns])
+                self.assertIn(f'with {threads} threads', res.stderr)
+                self.assertEqual(res.stdout, expected)
+
     def test_regdb_list_search_sensor_a(self):
         # Test listing with SENSOR_A pattern
         res = subprocess.run(
@@ -190,6 +248,95 @@ class RwmemRegisterDatabaseTests(RwmemTestBase):
         self.assertEqual(res.returncode, 0, res)
         self.assertEqual(res.stdout, 'SENSOR_A.STATUS_REG\n')
 
+    def test_regdb_list_search_fields(self):
+        # Field level matches are listed in block/register/field order
+        res = subprocess.run(
+            [self.rwmem_cmd, 'list', '--regs=' + TEST_REGDB_PATH, 'SENSOR_*.STATUS_REG:*'],
+            capture_output=True,
+            encoding='ASCII',
+            check=False,
+        )
+
+        self.assertEqual(res.returncode, 0, res)
+        expected = (
+            'SENSOR_A.STATUS_REG:MODE\nSENSOR_A.STATUS_REG:ERROR\nSENSOR_A.STATUS_REG:READY\n'
+            + 'SENSOR_B.STATUS_REG:MODE\nSENSOR_B.STATUS_REG:ERROR\nSENSOR_B.STATUS_REG:READY\n'
+        )
+        self.assertEqual(res.stdout, expected)
+
+    def test_regdb_complete(self):
+        def complete(prefix):
+            res = subprocess.run(
+                [self.rwmem_cmd, 'complete', '--regs=' + TEST_REGDB_PATH, prefix],
+                capture_output=True,
+                encoding='ASCII',
+                check=False,
+            )
+            self.assertEqual(res.returncode, 0, res)
+            return res.stdout
+
+        self.assertEqual(complete(''), 'MEMORY_CTRL\nSENSOR_A\nSENSOR_B\n')
+        self.assertEqual(complete('sens'), 'SENSOR_A\nSENSOR_B\n')
+        self.assertEqual(
+            complete('SENSOR_A.CO'),
+            'SENSOR_A.CONFIG_REG\nSENSOR_A.CONTROL_REG\nSENSOR_A.COUNTER_REG\n',
+        )
+        self.assertEqual(
+            complete('SENSOR_A.STATUS_REG:'),
+            'SENSOR_A.STATUS_REG:ERROR\nSENSOR_A.STATUS_REG:MODE\nSENSOR_A.STATUS_REG:READY\n',
+        )
+        self.assertEqual(complete('SENSOR_A.status_reg:m'), 'SENSOR_A.STATUS_REG:MODE\n')
+        self.assertEqual(complete('NOPE.'), '')
+
+    def test_regdb_overlay(self):
+        def run(args):
+            return subprocess.run(
+                [self.rwmem_cmd, *args], capture_output=True, encoding='ASCII', check=False
+            )
+
+        regs = ['-r', TEST_REGDB_PATH, '-r', TEST_OVERLAY_REGDB_PATH]
+
+        # The overlay replaces SENSOR_B and adds BOARD_DEV
+        res = run(['list', *regs, '*.*'])
+        self.assertEqual(res.returncode, 0, res)
+        self.assertEqual(
+            res.stdout,
+            'SENSOR_A.STATUS_REG\n'
+            'SENSOR_A.CONTROL_REG\n'
+            'SENSOR_A.DATA_REG\n'
+            'SENSOR_A.CONFIG_REG\n'
+            'SENSOR_A.COUNTER_REG\n'
+            'SENSOR_A.BIG_REG\n'
+            'SENSOR_A.HUGE_REG\n'
+            'SENSOR_A.GIANT_REG\n'
+            'SENSOR_A.MAX_REG\n'
+            'MEMORY_CTRL.ADDR_REG\n'
+            'MEMORY_CTRL.CONFIG_REG\n'
+            'MEMORY_CTRL.STATUS_REG\n'
+            'MEMORY_CTRL.DATA_LO_REG\n'
+            'MEMORY_CTRL.DATA_HI_REG\n'
+            'SENSOR_B.ID_REG\n'
+            'BOARD_DEV.CTRL_REG\n',
+        )
+
+        res = run(['complete', *regs, ''])
+        self.assertEqual(res.returncode, 0, res)
+        self.assertEqual(res.stdout, 'BOARD_DEV\nMEMORY_CTRL\nSENSOR_A\nSENSOR_B\n')
+
+        res = run(
+            ['mmap', DATA_BIN_PATH, *regs, '-p', 'r', 'SENSOR_B.ID_REG', 'BOARD_DEV.CTRL_REG']
+        )
+        self.assertEqual(res.returncode, 0, res)
+        self.assertEqual(
+            res.stdout,
+            'SENSOR_B.ID_REG                0x100 (+0x0) = 0x6d2533ea\n'
+            'BOARD_DEV.CTRL_REG             0x00000280 (+0x0) = 0x0634fb40\n',
+        )
+
+        # Registers of the shadowed block are not found
+        res = run(['mmap', DATA_BIN_PATH, *regs, 'SENSOR_B.STATUS_REG'])
+        self.assertNotEqual(res.returncode, 0, res)
+
     def test_regdb_byte_register(self):
         # Test 8-bit register access
         self.assertOutput(
@@ -242,6 +389,109 @@ class RwmemRegisterDatabaseTests(RwmemTestBase):
             + '  MAX_DATA                       63:0  = 0x2362b99628c13feb \n',
         )
 
+    def test_regdb_snapshot(self):
+        for opts in [['SENSOR_A'], ['-p', 'r', 'SENSOR_A.*_REG', 'SENSOR_A.STATUS_REG:MODE', '0x10+0x8']]:
+            res = subprocess.run(
+                [self.rwmem_cmd, *self.rwmem_common_opts, *opts],
+                capture_output=True,
+                encoding='ASCII',
+                check=False,
+            )
+            self.assertEqual(res.returncode, 0, res)
+
+            self.assertOutput(['--snapshot', *opts], res.stdout)
+
+    def test_regdb_threads(self):
+        # The output is formatted in parallel, in chunks of an op's accesses
+        ops = ['SENSOR_A', '0x0+0x300', 'SENSOR_A.*_REG', '0x100+0x200', 'SENSOR_A']
+
+        def run(args):
+            res = subprocess.run(
+                [self.rwmem_cmd, *self.rwmem_common_opts, *args],
+                capture_output=True,
+                encoding='ASCII',
+                check=False,
+            )
+            self.assertEqual(res.returncode, 0, res)
+            return res.stdout
+
+        for opts in [[], ['-p', 'r'], ['-f', 'b'], ['--snapshot']]:
+            expected = run(['--threads', '1', *opts, *ops])
+
+            for threads in ['2', '4']:
+                self.assertEqual(run(['--threads', threads, *opts, *ops]), expected)
+
+        # Ops of several 1024 access chunks, on a target larger than test.bin
+        with tempfile.NamedTemporaryFile(suffix='.bin') as tmp:
+            with open(DATA_BIN_PATH, 'rb') as f:
+                tmp.write(f.read())
+            tmp.write(random.Random(3).randbytes(0x4000 - 768))
+            tmp.flush()
+
+            def run_large(args):
+                res = subprocess.run(
+                    [self.rwmem_cmd, 'mmap', tmp.name, '--regs=' + TEST_REGDB_PATH, *args],
+                    capture_output=True,
+                    encoding='ASCII',
+                    check=False,
+                )
+                self.assertEqual(res.returncode, 0, res)
+                return res.stdout
+
+            ops = ['SENSOR_A', '0x4+0x3ff8', 'SENSOR_A.*_REG', '0x100+0x1800']
+
+            for opts in [[], ['-d', '8'], ['--snapshot']]:
+                expected = run_large(['--threads', '1', *opts, *ops])
+                self.assertGreater(expected.count('\n'), 4 * 1024)
+
+                for threads in ['2', '4']:
+                    self.assertEqual(run_large(['--threads', threads, *opts, *ops]), expected)
+
+    def test_write_threads(self):
+        # Writes are printed before they are done, on the executing thread
+        with tempfile.NamedTemporaryFile(suffix='.bin') as tmp:
+            outputs = []
+            for threads in ['1', '4']:
+                shutil.copyfile(DATA_BIN_PATH, tmp.name)
+
+                res = subprocess.run(
+                    [self.rwmem_cmd, 'mmap', tmp.name, '-v', '--threads', threads, '-d', '8', '0x0+0x300=0x5a'],
+                    capture_output=True,
+                    encoding='ASCII',
+                    check=False,
+                )
+                self.assertEqual(res.returncode, 0, res)
+                self.assertNotIn('Formatting with', res.stderr)
+                outputs.append(res.stdout)
+
+            self.assertEqual(outputs[0].count(':= 0x5a'), 0x300)
+            self.assertEqual(outputs[1], outputs[0])
+
+    def test_regdb_latency(self):
+        for by, names in [('reg', ['SENSOR_A.STATUS_REG', 'SENSOR_A.CONFIG_REG']), ('block', ['SENSOR_A'])]:
+            res = subprocess.run(
+                [
+                    self.rwmem_cmd,
+                    *self.rwmem_common_opts,
+                    '-p',
+                    'q',
+                    '--latency',
+                    by,
+                    'SENSOR_A.STATUS_REG',
+                    'SENSOR_A.CONFIG_REG',
+                ],
+                capture_output=True,
+                encoding='ASCII',
+                check=False,
+            )
+            self.assertEqual(res.returncode, 0, res)
+            self.assertEqual(res.stdout, '')
+
+            lines = res.stderr.splitlines()
+            self.assertEqual(lines[0], 'Access latencies, ns:')
+            self.assertEqual([line for line in lines if not line.startswith(' ')][1:], names)
+            self.assertTrue(lines[2].startswith('  read   n '), res)
+
     def test_regdb_field_access(self):
         # Test specific field access
         self.assertOutput(
@@ -257,5 +507,200 @@ class RwmemRegisterDatabaseTests(RwmemTestBase):
         )
 
 
+class RwmemTransferTests(RwmemTestBase):
+    def setUp(self):
+        super().setUp()
+
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.target_name = self.tmpdir.name + '/target.bin'
+        self.file_name = self.tmpdir.name + '/file.bin'
+
+        shutil.copy2(DATA_BIN_PATH, self.target_name)
+
+    def tearDown(self):
+        self.tmpdir.cleanup()
+
+    def run_rwmem(self, opts):
+        return subprocess.run(
+            [self.rwmem_cmd, *opts, '--mmap', self.target_name],
+            capture_output=True,
+            check=False,
+        )
+
+    def test_save(self):
+        res = self.run_rwmem(['save', '0x10+0x20', self.file_name])
+        self.assertEqual(res.returncode, 0, res)
+        self.assertTrue(res.stdout.startswith(b'Saved 0x20 bytes from 0x10 in '), res)
+
+        with open(DATA_BIN_PATH, 'rb') as f:
+            data = f.read()
+
+        with open(self.file_name, 'rb') as f:
+            self.assertEqual(f.read(), data[0x10:0x30])
+
+        # A whole register block, with 8 byte accesses
+        res = self.run_rwmem(['save', '-p', 'q', '-d', '64', '-r', TEST_REGDB_PATH, 'SENSOR_A', self.file_name])
+        self.assertEqual(res.returncode, 0, res)
+        self.assertEqual(res.stdout, b'')
+
+        with open(self.file_name, 'rb') as f:
+            self.assertEqual(f.read(), data[0:0x100])
+
+    def test_save_parallel(self):
+        # Several 4 MiB windows and a partial one, saved by workers of their own
+        data = random.Random(1).randbytes(10 * 1024 * 1024 + 0x100)
+
+        with open(self.target_name, 'wb') as f:
+            f.write(data)
+
+        for opts in [['--threads', '3'], ['--threads', '2', '-d', '64', '--map', 'wc']]:
+            res = self.run_rwmem(['save', '-p', 'q', '--map', 'cached', *opts, '0x80+0xa00080', self.file_name])
+            self.assertEqual(res.returncode, 0, res)
+
+            with open(self.file_name, 'rb') as f:
+                self.assertEqual(f.read(), data[0x80:0xa00100])
+
+        # Past the end of the target
+        res = self.run_rwmem(['save', '--map', 'cached', '--threads', '2', '0x0+0xb00000', self.file_name])
+        self.assertNotEqual(res.returncode, 0, res)
+
+        # A write error on a worker thread is reported like on the main thread
+        res = self.run_rwmem(['save', '--map', 'cached', '--threads', '2', '0x80+0x900000', '/dev/full'])
+        self.assertEqual(res.returncode, 1, res)
+        self.assertIn(b"Failed to write '/dev/full'", res.stderr)
+
+    def test_windowed(self):
+        # The target is mapped 8 KiB at a time
+        data = random.Random(2).randbytes(0x10000)
+
+        with open(self.target_name, 'wb') as f:
+            f.write(data)
+
+        res = self.run_rwmem(['save', '-p', 'q', '--window', '0x2000', '0x10+0xffe0', self.file_name])
+        self.assertEqual(res.returncode, 0, res)
+
+        with open(self.file_name, 'rb') as f:
+            self.assertEqual(f.read(), data[0x10:0xfff0])
+
+        outputs = []
+        for window in ['0', '0x2000']:
+            res = subprocess.run(
+                [self.rwmem_cmd, 'mmap', self.target_name, '--window', window, '-p', 'r', '-d', '64', '0x4+0xfff0'],
+                capture_output=True,
+                encoding='ASCII',
+                check=False,
+            )
+            self.assertEqual(res.returncode, 0, res)
+            outputs.append(res.stdout)
+
+        self.assertEqual(len(outputs[0].splitlines()), 0xfff0 // 8)
+        self.assertEqual(outputs[1], outputs[0])
+
+    def test_file_target(self):
+        # pread and pwrite accesses give the same results as the mapping
+        def rwmem(target, opts):
+            res = subprocess.run([self.rwmem_cmd, target, self.target_name, *opts], capture_output=True, check=False)
+            self.assertEqual(res.returncode, 0, res)
+            return res.stdout
+
+        for opts in [['0x0+0x300'], ['-d', '16be', '0x2+0x2fe'], ['-r', TEST_REGDB_PATH, 'SENSOR_A', 'SENSOR_B.*']]:
+            expected = rwmem('mmap', opts)
+            self.assertEqual(rwmem('file', opts), expected, opts)
+            self.assertEqual(rwmem('file', ['--io-uring', *opts]), expected, opts)
+
+        rwmem('file', ['0xa0:15:8=0x12'])
+        self.assertEqual(rwmem('mmap', ['-p', 'r', '0xa0']), b'0xa0 (+0x0) = 0x24a91222\n')
+
+        data = random.Random(3).randbytes(0x300)
+
+        with open(self.file_name, 'wb') as f:
+            f.write(data)
+
+        res = subprocess.run(
+            [self.rwmem_cmd, 'load', '--file', self.target_name, '--io-uring', '-d', '16', self.file_name, '0x0'],
+            capture_output=True,
+            check=False,
+        )
+        self.assertEqual(res.returncode, 0, res)
+
+        with open(self.target_name, 'rb') as f:
+            self.assertEqual(f.read(), data)
+
+        res = subprocess.run(
+            [self.rwmem_cmd, 'save', '--file', self.target_name, '-p', 'q', '0x100+0x100', self.file_name],
+            capture_output=True,
+            check=False,
+        )
+        self.assertEqual(res.returncode, 0, res)
+
+        with open(self.file_name, 'rb') as f:
+            self.assertEqual(f.read(), data[0x100:0x200])
+
+    def test_load(self):
+        blob = bytes(range(0x13, 0x13 + 0x18))
+
+        with open(self.file_name, 'wb') as f:
+            f.write(blob)
+
+        for opts in [['-d', '8'], ['-d', '32be'], ['-d', '64', '--map', 'cached']]:
+            res = self.run_rwmem(['load', '-p', 'q', *opts, self.file_name, '0x40'])
+            self.assertEqual(res.returncode, 0, res)
+
+            with open(self.target_name, 'rb') as f:
+                data = f.read()
+
+            self.assertEqual(data[0x40:0x58], blob)
+
+        # Not a multiple of the access size, and larger than the range
+        for opts in [['-d', '40', self.file_name, '0x0'], [self.file_name, '0x0+0x10']]:
+            res = self.run_rwmem(['load', *opts])
+            self.assertNotEqual(res.returncode, 0, res)
+
+
+class RwmemBenchTests(RwmemTestBase):
+    def test_bench(self):
+        res = subprocess.run(
+            [self.rwmem_cmd, 'bench', '--mmap', DATA_BIN_PATH, '-d', '32', '0x0+0x100'],
+            capture_output=True,
+            encoding='ASCII',
+            check=False,
+        )
+        self.assertEqual(res.returncode, 0, res)
+
+        lines = res.stdout.splitlines()
+        self.assertTrue(lines[0].startswith('Region 0x0+0x100, uc mapping, CPU '), res)
+        self.assertEqual(lines[3].split()[0], '32')
+        # Writes are measured only with --writes
+        self.assertEqual(lines[3].split()[3:], ['-', '-'])
+        self.assertEqual(lines[4], 'Random read latency, ns:')
+        self.assertEqual(len(lines[6].split()), 6)
+
+        # Only the first window of a windowed mapping is measured
+        with tempfile.NamedTemporaryFile(suffix='.bin') as tmp:
+            tmp.truncate(0x10000)
+
+            res = subprocess.run(
+                [self.rwmem_cmd, 'bench', '--mmap', tmp.name, '--window', '0x2000', '-d', '64', '0x100+0x8000'],
+                capture_output=True,
+                encoding='ASCII',
+                check=False,
+            )
+            self.assertEqual(res.returncode, 0, res)
+
+            lines = res.stdout.splitlines()
+            self.assertTrue(lines[0].startswith('Region 0x100+0x8000, uc mapping, CPU '), res)
+            self.assertEqual(
+                lines[1], 'The region does not fit in the map window, measuring the first 0x1f00 bytes'
+            )
+
+        res = subprocess.run(
+            [self.rwmem_cmd, 'bench', '--mmap', DATA_BIN_PATH, '0x0=1'],
+            capture_output=True,
+            encoding='ASCII',
+            check=False,
+        )
+        self.assertNotEqual(res.returncode, 0, res)
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,445 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+#include "../librwmem/session.h"
+#include "../librwmem/utils.h"
+
+class SessionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Writable copy of test.bin
+        bin_filename = "/tmp/rwmem_test_session_" + std::to_string(getpid()) + ".bin";
+        std::ifstream src(std::string(TEST_DATA_DIR) + "/test.bin", std::ios::binary);
+        std::ofstream dst(bin_filename, std::ios::binary);
+        dst << src.rdbuf();
+        src.close();
+        dst.close();
+
+        opts.mmap_target = bin_filename;
+    }
+
+    void TearDown() override {
+        unlink(bin_filename.c_str());
+    }
+
+    void load_regdb(RwmemSession& session) {
+        session.load_regfile(std::string(TEST_DATA_DIR) + "/test.regdb");
+    }
+
+    std::string bin_filename;
+    RwmemSessionOptions opts;
+};
+
+TEST(ParseU64Test, Bases) {
+    uint64_t v;
+
+    EXPECT_EQ(parse_u64("0", &v), 0);
+    EXPECT_EQ(v, 0U);
+    EXPECT_EQ(parse_u64("1234", &v), 0);
+    EXPECT_EQ(v, 1234U);
+    EXPECT_EQ(parse_u64("0x1234abcd", &v), 0);
+    EXPECT_EQ(v, 0x1234abcdU);
+    EXPECT_EQ(parse_u64("0XFF", &v), 0);
+    EXPECT_EQ(v, 0xffU);
+    EXPECT_EQ(parse_u64("010", &v), 0);
+    EXPECT_EQ(v, 8U);
+    EXPECT_EQ(parse_u64("0xffffffffffffffff", &v), 0);
+    EXPECT_EQ(v, ~0ULL);
+}
+
+TEST(ParseU64Test, Errors) {
+    uint64_t v = 5;
+
+    EXPECT_NE(parse_u64("", &v), 0);
+    EXPECT_NE(parse_u64("0x", &v), 0);
+    EXPECT_NE(parse_u64("12a", &v), 0);
+    EXPECT_NE(parse_u64("08", &v), 0);
+    EXPECT_NE(parse_u64("-1", &v), 0);
+    EXPECT_NE(parse_u64(" 1", &v), 0);
+    EXPECT_NE(parse_u64("0x10000000000000000", &v), 0);
+    EXPECT_EQ(v, 5U);
+}
+
+TEST(ParseOpArgTest, Parts) {
+    RwmemOptsArg arg = parse_op_arg("BLOCK.REG+0x10:FIELD=5");
+    EXPECT_EQ(arg.address, "BLOCK.REG");
+    EXPECT_TRUE(arg.range_is_offset);
+    EXPECT_EQ(arg.range, "0x10");
+    EXPECT_EQ(arg.field, "FIELD");
+    EXPECT_EQ(arg.value, "5");
+
+    arg = parse_op_arg("0x10-0x20");
+    EXPECT_EQ(arg.address, "0x10");
+    EXPECT_FALSE(arg.range_is_offset);
+    EXPECT_EQ(arg.range, "0x20");
+    EXPECT_TRUE(arg.field.empty());
+    EXPECT_TRUE(arg.value.empty());
+}
+
+TEST(ParseOpArgTest, Errors) {
+    EXPECT_THROW(parse_op_arg(""), std::runtime_error);
+    EXPECT_THROW(parse_op_arg("0x10="), std::runtime_error);
+    EXPECT_THROW(parse_op_arg("0x10:"), std::runtime_error);
+    EXPECT_THROW(parse_op_arg("0x10+"), std::runtime_error);
+    EXPECT_THROW(parse_op_arg("+4"), std::runtime_error);
+}
+
+TEST_F(SessionTest, ParseErrors) {
+    RwmemSession session(opts);
+
+    // Symbolic addresses need a register file
+    EXPECT_THROW(session.parse_op("SENSOR_A.STATUS_REG"), std::runtime_error);
+    EXPECT_THROW(session.parse_op("0x10-0x8"), std::runtime_error);
+    EXPECT_THROW(session.parse_op("0x0=0x100000000"), std::runtime_error);
+
+    load_regdb(session);
+
+    EXPECT_THROW(session.parse_op("SENSOR_A.NO_SUCH_REG"), std::runtime_error);
+    EXPECT_THROW(session.parse_op("SENSOR_A.STATUS_REG:NO_SUCH_FIELD"), std::runtime_error);
+    EXPECT_THROW(session.parse_op("SENSOR_A.STATUS_REG=0x100"), std::runtime_error);
+    EXPECT_THROW(session.parse_op("SENSOR_A.STATUS_REG:READY=2"), std::runtime_error);
+}
+
+TEST_F(SessionTest, ParseFields) {
+    RwmemSession session(opts);
+    load_regdb(session);
+
+    RwmemOp op = session.parse_op("SENSOR_A.CONFIG_REG:gain");
+    EXPECT_TRUE(op.custom_field);
+    EXPECT_EQ(op.high, 15U);
+    EXPECT_EQ(op.low, 8U);
+
+    op = session.parse_op("SENSOR_A.CONFIG_REG:23:16");
+    EXPECT_EQ(op.high, 23U);
+    EXPECT_EQ(op.low, 16U);
+
+    op = session.parse_op("SENSOR_A.CONFIG_REG:0x3");
+    EXPECT_EQ(op.high, 3U);
+    EXPECT_EQ(op.low, 3U);
+
+    EXPECT_THROW(session.parse_op("SENSOR_A.CONFIG_REG:24"), std::runtime_error);
+    EXPECT_THROW(session.parse_op("SENSOR_A.CONFIG_REG:7:x"), std::runtime_error);
+}
+
+TEST_F(SessionTest, RegisterLists) {
+    RwmemSession session(opts);
+    load_regdb(session);
+
+    RwmemOp first = session.parse_op("SENSOR_A.*_REG");
+    ASSERT_GT(first.rds.size(), 1U);
+
+    std::vector<const RegisterData*> expected(first.rds.begin(), first.rds.end());
+
+    // Enough ops to need several arena chunks
+    for (int i = 0; i < 1000; ++i) {
+        RwmemOp op = session.parse_op("SENSOR_A.*_REG");
+        ASSERT_EQ(op.rds.size(), expected.size());
+    }
+
+    EXPECT_TRUE(std::equal(first.rds.begin(), first.rds.end(), expected.begin()));
+
+    RwmemOp op = session.parse_op("STATUS_REG");
+    ASSERT_EQ(op.rds.size(), 1U);
+    EXPECT_STREQ(op.rds[0]->name(op.rfd), "STATUS_REG");
+
+    session.clear_ops();
+
+    op = session.parse_op("SENSOR_A.STATUS_REG");
+    ASSERT_EQ(op.rds.size(), 1U);
+    EXPECT_STREQ(op.rds[0]->name(op.rfd), "STATUS_REG");
+}
+
+TEST_F(SessionTest, NumericRead) {
+    RwmemSession session(opts);
+
+    RwmemOpResult res = session.execute(session.parse_op("0x10+0x10"));
+
+    EXPECT_EQ(res.mapping.offset, 0x10U);
+    EXPECT_EQ(res.mapping.length, 0x10U);
+    EXPECT_EQ(res.mapping.mode, MapMode::Read);
+
+    ASSERT_EQ(res.accesses.size(), 4U);
+
+    const uint64_t expected[] = { 0x8ee570d6, 0xaed85103, 0xac6e4f8e, 0x31c22f34 };
+
+    for (size_t i = 0; i < 4; ++i) {
+        const RwmemAccess& a = res.accesses[i];
+        EXPECT_EQ(a.rd, nullptr);
+        EXPECT_EQ(a.op_offset, i * 4);
+        EXPECT_EQ(a.address, 0x10 + i * 4);
+        EXPECT_EQ(a.data_size, 4);
+        EXPECT_TRUE(a.read);
+        EXPECT_FALSE(a.written);
+        EXPECT_EQ(a.old_value, expected[i]);
+        EXPECT_EQ(a.new_value, expected[i]);
+    }
+}
+
+TEST_F(SessionTest, NumericWrite) {
+    RwmemSession session(opts);
+
+    RwmemOpResult res = session.execute(session.parse_op("0xa0:15:8=0x12"));
+
+    ASSERT_EQ(res.accesses.size(), 1U);
+
+    const RwmemAccess& a = res.accesses[0];
+    EXPECT_EQ(a.old_value, 0x24a91022U);
+    EXPECT_TRUE(a.written);
+    EXPECT_EQ(a.written_value, 0x24a91222U);
+    EXPECT_TRUE(a.read_back);
+    EXPECT_EQ(a.new_value, 0x24a91222U);
+
+    res = session.execute(session.parse_op("0xa0"));
+    ASSERT_EQ(res.accesses.size(), 1U);
+    EXPECT_EQ(res.accesses[0].old_value, 0x24a91222U);
+}
+
+TEST_F(SessionTest, WriteOnly) {
+    opts.write_mode = WriteMode::Write;
+    RwmemSession session(opts);
+
+    RwmemOpResult res = session.execute(session.parse_op("0x0=0x1234"));
+
+    ASSERT_EQ(res.accesses.size(), 1U);
+    EXPECT_FALSE(res.accesses[0].read);
+    EXPECT_FALSE(res.accesses[0].read_back);
+    EXPECT_EQ(res.accesses[0].written_value, 0x1234U);
+}
+
+TEST_F(SessionTest, BulkWrite) {
+    class Quiet : public RwmemObserver
+    {
+    public:
+        bool wants_accesses() const override { return false; }
+        void access_begin(const RwmemAccess& access) override { ++accesses; }
+
+        int accesses = 0;
+    };
+
+    for (MapType type : { MapType::Uncached, MapType::Cached }) {
+        for (WriteMode mode : { WriteMode::Write, WriteMode::ReadWrite, WriteMode::ReadWriteRead }) {
+            opts.user_map_type = true;
+            opts.map_type = type;
+            opts.write_mode = mode;
+
+            // Reference result with per-access writes
+            std::vector<uint64_t> expected;
+            {
+                RwmemSession session(opts);
+                session.execute(session.parse_op("0x14+0x40:11:4=0x5a"));
+                for (const RwmemAccess& a : session.execute(session.parse_op("0x0+0x80")).accesses)
+                    expected.push_back(a.old_value);
+            }
+
+            SetUp();
+
+            RwmemSession session(opts);
+            Quiet quiet;
+
+            session.execute(session.parse_op("0x14+0x40:11:4=0x5a"), quiet);
+            EXPECT_EQ(quiet.accesses, 0);
+
+            RwmemOpResult res = session.execute(session.parse_op("0x0+0x80"));
+            ASSERT_EQ(res.accesses.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i)
+                EXPECT_EQ(res.accesses[i].old_value, expected[i]) << "offset " << i * 4;
+
+            SetUp();
+        }
+    }
+}
+
+TEST_F(SessionTest, TimedAccesses) {
+    opts.time_accesses = true;
+    RwmemSession session(opts);
+
+    RwmemOpResult res = session.execute(session.parse_op("0x0+0x100=0x1234"));
+
+    ASSERT_EQ(res.accesses.size(), 0x40U);
+
+    // Every access is timed. The clock is read twice
+    // per access, so the durations are not all zero.
+    uint64_t total = 0;
+    for (const RwmemAccess& a : res.accesses)
+        total += a.read_ns + a.write_ns + a.read_back_ns;
+
+    EXPECT_GT(total, 0U);
+}
+
+TEST_F(SessionTest, Capture) {
+    RwmemSession session(opts);
+    load_regdb(session);
+
+    std::vector<RwmemOp> ops = {
+        session.parse_op("SENSOR_A.*_REG"),
+        session.parse_op("0x10+0x10"),
+        session.parse_op("0x0=0x1234"),
+    };
+
+    RwmemCapture capture = session.capture(ops);
+
+    ASSERT_EQ(capture.ops.size(), ops.size());
+    EXPECT_GT(capture.time_ns, 0U);
+
+    EXPECT_EQ(capture.ops[1].mapping.offset, 0x10U);
+    EXPECT_EQ(capture.ops[1].num_accesses, 4U);
+    EXPECT_EQ(capture.accesses[capture.ops[1].first_access].old_value, 0x8ee570d6U);
+    EXPECT_EQ(capture.ops[2].num_accesses, 1U);
+    EXPECT_EQ(capture.accesses.back().new_value, 0x1234U);
+    EXPECT_EQ(capture.ops[2].first_access + 1, capture.accesses.size());
+
+    class Recorder : public RwmemObserver
+    {
+    public:
+        void op_begin(const RwmemOp& op, const RwmemMapping& mapping) override { events += "o"; }
+        void access_begin(const RwmemAccess& access) override { events += "b"; }
+        void access_write(const RwmemAccess& access) override { events += "w"; }
+        void access_end(const RwmemAccess& access) override { events += "e"; }
+
+        std::string events;
+    };
+
+    Recorder rec;
+    replay_capture(ops, capture, rec);
+
+    std::string expected = "o";
+    for (size_t i = 0; i < capture.ops[0].num_accesses; ++i)
+        expected += "be";
+    expected += "obebebebe" "obwe";
+
+    EXPECT_EQ(rec.events, expected);
+}
+
+TEST_F(SessionTest, SymbolicRead) {
+    RwmemSession session(opts);
+    load_regdb(session);
+
+    RwmemOpResult res = session.execute(session.parse_op("SENSOR_A.CONFIG_REG"));
+
+    ASSERT_EQ(res.accesses.size(), 1U);
+
+    const RwmemAccess& a = res.accesses[0];
+    ASSERT_NE(a.rd, nullptr);
+    EXPECT_STREQ(a.rd->name(a.rfd), "CONFIG_REG");
+    EXPECT_EQ(a.address, 0x04U);
+    EXPECT_EQ(a.data_size, 3);
+    EXPECT_EQ(a.old_value, 0x344772U);
+}
+
+TEST_F(SessionTest, Observer) {
+    class Recorder : public RwmemObserver
+    {
+    public:
+        void op_begin(const RwmemOp& op, const RwmemMapping& mapping) override { events += "o"; }
+        void access_begin(const RwmemAccess& access) override { events += "b"; }
+        void access_write(const RwmemAccess& access) override { events += "w"; }
+        void access_end(const RwmemAccess& access) override { events += "e"; }
+
+        std::string events;
+    };
+
+    RwmemSession session(opts);
+    Recorder rec;
+
+    session.execute(session.parse_op("0x0+8=1"), rec);
+
+    EXPECT_EQ(rec.events, "obwebwe");
+}
+
+TEST_F(SessionTest, RangeTransfers) {
+    RwmemSession session(opts);
+    load_regdb(session);
+
+    // The memory contents, whatever the access size
+    const uint8_t expected[] = { 0xd6, 0x70, 0xe5, 0x8e, 0x03, 0x51, 0xd8, 0xae };
+
+    for (uint8_t d : { 1, 2, 4, 8 }) {
+        opts.data_size = d;
+        RwmemSession s(opts);
+
+        RwmemMapping m = s.map_range(s.parse_op("0x10"), 8, MapMode::ReadWrite);
+        EXPECT_EQ(m.offset, 0x10U);
+        EXPECT_EQ(m.length, 8U);
+
+        uint8_t buf[8];
+        s.read_range(0x10, buf, 8);
+        EXPECT_EQ(memcmp(buf, expected, 8), 0) << "data size " << (int)d;
+
+        const uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        s.write_range(0x10, data, 8);
+        s.read_range(0x10, buf, 8);
+        EXPECT_EQ(memcmp(buf, data, 8), 0) << "data size " << (int)d;
+
+        s.write_range(0x10, expected, 8);
+    }
+
+    // A whole block
+    RwmemMapping m = session.map_range(session.parse_op("SENSOR_A"), 0, MapMode::Read);
+    EXPECT_EQ(m.offset, 0U);
+    EXPECT_EQ(m.length, 0x100U);
+
+    EXPECT_THROW(session.map_range(session.parse_op("SENSOR_A.STATUS_REG"), 0, MapMode::Read), std::runtime_error);
+    EXPECT_THROW(session.map_range(session.parse_op("SENSOR_A"), 0x101, MapMode::Read), std::runtime_error);
+    EXPECT_THROW(session.map_range(session.parse_op("0x0"), 6, MapMode::Read), std::runtime_error);
+}
+
+TEST_F(SessionTest, FileTarget) {
+    RwmemSessionOptions file_opts = opts;
+    file_opts.target_type = TargetType::File;
+    file_opts.file_target = bin_filename;
+
+    // Batched numeric reads give the same accesses as the mmap target
+    for (const char* op_str : { "0x0+0x300", "0x10+0x10", "0x21+8" }) {
+        for (uint8_t d : { 1, 2, 4, 8 }) {
+            file_opts.file_io_uring = d >= 4;
+            opts.data_size = file_opts.data_size = d;
+            opts.data_endianness = file_opts.data_endianness = Endianness::Big;
+
+            RwmemSession mmap_session(opts);
+            RwmemSession file_session(file_opts);
+
+            RwmemOpResult expected = mmap_session.execute(mmap_session.parse_op(op_str));
+            RwmemOpResult res = file_session.execute(file_session.parse_op(op_str));
+
+            ASSERT_EQ(res.accesses.size(), expected.accesses.size()) << op_str << " size " << (int)d;
+            for (size_t i = 0; i < expected.accesses.size(); ++i) {
+                EXPECT_EQ(res.accesses[i].address, expected.accesses[i].address);
+                EXPECT_EQ(res.accesses[i].op_offset, expected.accesses[i].op_offset);
+                EXPECT_TRUE(res.accesses[i].read);
+                EXPECT_EQ(res.accesses[i].old_value, expected.accesses[i].old_value)
+                    << op_str << " size " << (int)d << " offset " << res.accesses[i].op_offset;
+            }
+        }
+    }
+
+    opts.data_size = file_opts.data_size = 4;
+    opts.data_endianness = file_opts.data_endianness = Endianness::Little;
+
+    RwmemSession session(file_opts);
+    load_regdb(session);
+
+    RwmemOpResult res = session.execute(session.parse_op("0xa0:15:8=0x12"));
+    ASSERT_EQ(res.accesses.size(), 1U);
+    EXPECT_EQ(res.accesses[0].old_value, 0x24a91022U);
+    EXPECT_EQ(res.accesses[0].new_value, 0x24a91222U);
+
+    res = session.execute(session.parse_op("SENSOR_A.CONFIG_REG"));
+    ASSERT_EQ(res.accesses.size(), 1U);
+
+    const uint8_t expected[] = { 0xd6, 0x70, 0xe5, 0x8e, 0x03, 0x51, 0xd8, 0xae };
+    const uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t buf[8];
+
+    session.map_range(session.parse_op("0x10"), 8, MapMode::ReadWrite);
+    session.read_range(0x10, buf, 8);
+    EXPECT_EQ(memcmp(buf, expected, 8), 0);
+
+    session.write_range(0x10, data, 8);
+    session.read_range(0x10, buf, 8);
+    EXPECT_EQ(memcmp(buf, data, 8), 0);
+}